@@ -7,19 +7,30 @@
  * All rights reserved. Published under the MIT License in the LICENSE file.
  ******************************************************************************/
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <thread>
+#include <type_traits>
 
 #include <cobs/construction/classic_index.hpp>
 #include <cobs/document_list.hpp>
 #include <cobs/file/classic_index_header.hpp>
+#include <cobs/file/index_bundle_header.hpp>
+#include <cobs/file/tombstones.hpp>
 #include <cobs/kmer.hpp>
 #include <cobs/text_file.hpp>
 #include <cobs/util/calc_signature_size.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
+#include <cobs/util/kmer_count_sketch.hpp>
+#include <cobs/util/kmer_dedup.hpp>
+#include <cobs/util/misc.hpp>
 #include <cobs/util/process_file_batches.hpp>
+#include <cobs/util/rolling_kmer.hpp>
 #include <cobs/util/timer.hpp>
 
 #include <tlx/die.hpp>
@@ -30,54 +41,459 @@
 #include <tlx/string/bitdump.hpp>
 #include <tlx/string/format_iec_units.hpp>
 #include <tlx/string/join_generic.hpp>
+#include <tlx/thread_barrier_mutex.hpp>
 
 namespace cobs {
 
 /******************************************************************************/
 // Construction of classic index from documents
 
+//! set bit in the matrix, the bit index is row * row_size * 8 + doc_index. If
+//! Atomic, other threads may set bits in the same byte concurrently.
+template <bool Atomic = false>
 static inline
-void set_bit(std::vector<uint8_t>& data, const ClassicIndexHeader& cih,
-             uint64_t pos, uint64_t doc_index) {
-    data[cih.row_size() * pos + doc_index / 8] |= 1 << (doc_index % 8);
+void set_bit(uint8_t* data, uint64_t bit) {
+    uint8_t* byte = data + bit / 8;
+    if (Atomic)
+        __atomic_fetch_or(byte, uint8_t(1 << (bit % 8)), __ATOMIC_RELAXED);
+    else
+        *byte |= 1 << (bit % 8);
 }
 
+/*!
+ * Filters applied to the canonical k-mers of a document before hashing them,
+ * which require k-mers fitting into 2-bit words. With min_count > 1, k-mers of
+ * FASTQ documents are counted in a KMerCountSketch and skipped until they
+ * occurred min_count times, which drops most sequencing errors. With dedup,
+ * repeated k-mers are skipped.
+ */
+class KMerFilter
+{
+public:
+    KMerFilter(const ClassicIndexParameters& params,
+               const ClassicIndexHeader& cih)
+        : term_size_(cih.term_size_), min_count_(params.min_count) {
+        if (cih.canonicalize_ != 1 || cih.term_size_ > 32)
+            return;
+        if (params.min_count > 1) {
+            // each thread counts in its own sketch
+            sketch_ = std::make_unique<KMerCountSketch>(
+                params.min_count, sketch_bytes(params));
+        }
+        if (params.dedup)
+            dedup_ = std::make_unique<KMerDedup>();
+    }
+
+    ~KMerFilter() { finish_document(); }
+
+    //! memory of the sketch of one thread
+    static uint64_t sketch_bytes(const ClassicIndexParameters& params) {
+        return params.mem_bytes / std::max(params.num_threads, 1u);
+    }
+
+    //! return this if any filter is used, otherwise nullptr
+    KMerFilter * get() { return sketch_ || dedup_ ? this : nullptr; }
+
+    //! start filtering the terms of a document
+    void start_document(const DocumentEntry& de) {
+        finish_document();
+        counting_ = sketch_ && de.filters_min_count(min_count_);
+        if (counting_) {
+            sketch_->reset(de.num_terms(term_size_));
+            doc_path_ = de.path_;
+        }
+        if (dedup_)
+            dedup_->clear();
+    }
+
+    //! true if the k-mer is to be hashed
+    bool pass(uint64_t word) {
+        if (counting_ && sketch_->add(word) + 1 < min_count_)
+            return false;
+        return !dedup_ || dedup_->insert(word);
+    }
+
+private:
+    //! warn if the sketch was too small for the counted document
+    void finish_document() {
+        if (counting_)
+            sketch_->warn_overloaded(doc_path_);
+        counting_ = false;
+    }
+
+    uint64_t term_size_;
+    unsigned min_count_;
+    //! true if the current document is counted
+    bool counting_ = false;
+    //! path of the counted document
+    std::string doc_path_;
+    std::unique_ptr<KMerCountSketch> sketch_;
+    std::unique_ptr<KMerDedup> dedup_;
+};
+
+//! process one term and call set(row) for each hashed row, K != 0 is the
+//! fixed term size, see dispatch_term_size(). If filter is given, canonical
+//! k-mers which it does not pass are skipped.
+template <uint64_t K, typename SetRow>
 static inline
-void process_term(const tlx::string_view& term, std::vector<uint8_t>& data,
-                  uint64_t doc_index, const std::string& path,
-                  bool* shown_canonicalization_warning,
-                  const ClassicIndexHeader& cih, char* canonicalize_buffer) {
+void process_term(const tlx::string_view& term, const ClassicIndexHeader& cih,
+                  RollingCanonicalKMer<K>& canonicalizer, KMerFilter* filter,
+                  SetRow set_row) {
+    // a constant length lets the compiler specialize the hash function
+    const uint64_t term_size = K != 0 ? K : term.size();
     if (cih.canonicalize_ == 0) {
-        process_hashes(term.data(), term.size(),
+        process_hashes(term.data(), term_size,
                        cih.signature_size_, cih.num_hashes_,
-                       [&](uint64_t hash) {
-                           set_bit(data, cih, hash, doc_index);
-                       });
+                       set_row, cih.block_rows_, cih.hash_scheme_);
     }
     else if (cih.canonicalize_ == 1) {
-        bool good =
-            canonicalize_kmer(term.data(), canonicalize_buffer, term.size());
-
-        if (!good && !*shown_canonicalization_warning) {
-            LOG1 << "WARNING: Invalid DNA base pair (not ACGT) in document: "
-                 << path;
-            *shown_canonicalization_warning = true;
+        tlx::string_view kmer = canonicalizer.canonicalize(term.data());
+        if (filter != nullptr && !filter->pass(canonicalizer.word()))
+            return;
+        if (cih.hash_scheme_ == HashScheme::XXH3_2Bit) {
+            process_word_hashes(canonicalizer.word(), cih.signature_size_,
+                                cih.num_hashes_, set_row, cih.block_rows_);
+            return;
         }
-
-        process_hashes(canonicalize_buffer, term.size(),
+        process_hashes(kmer.data(), term_size,
                        cih.signature_size_, cih.num_hashes_,
-                       [&](uint64_t hash) {
-                           set_bit(data, cih, hash, doc_index);
-                       });
+                       set_row, cih.block_rows_, cih.hash_scheme_);
+    }
+}
+
+//! process all terms of a document and call set(row) for each hashed row,
+//! returns the number of terms. Packed k-mers of .cobs_doc and Cortex files are
+//! hashed as 2-bit words if the hash scheme allows it, skipping their text.
+template <uint64_t K, typename SetRow>
+static inline
+uint64_t process_document(const DocumentEntry& doc,
+                          const ClassicIndexHeader& cih,
+                          RollingCanonicalKMer<K>& canonicalizer,
+                          KMerFilter* filter, SetRow set_row) {
+    uint64_t count = 0;
+    if (cih.hash_scheme_ == HashScheme::XXH3_2Bit && doc.has_packed_terms()) {
+        doc.process_words(
+            cih.term_size_, [&](uint64_t fw) {
+                uint64_t word = canonical_word(fw, cih.term_size_);
+                ++count;
+                if (filter != nullptr && !filter->pass(word))
+                    return;
+                process_word_hashes(word, cih.signature_size_,
+                                    cih.num_hashes_, set_row, cih.block_rows_);
+            });
+        return count;
     }
+    canonicalizer.reset();
+    doc.process_terms(
+        cih.term_size_, [&](const tlx::string_view& term) {
+            process_term<K>(term, cih, canonicalizer, filter, set_row);
+            ++count;
+        });
+    return count;
+}
+
+//! set the bits of all terms of the documents directly in the matrix, returns
+//! the number of terms.
+static uint64_t
+scatter_documents(const std::vector<DocumentEntry>& paths,
+                  uint64_t num_threads, const ClassicIndexParameters& params,
+                  const ClassicIndexHeader& cih, std::vector<uint8_t>& data) {
+    std::atomic<uint64_t> count = 0;
+
+    // split large documents into byte ranges, such that a single huge
+    // document does not leave all but one thread idle.
+    uint64_t total_size = 0;
+    for (const DocumentEntry& de : paths)
+        total_size += de.size_;
+    uint64_t range_size = std::max<uint64_t>(
+        params.split_size,
+        total_size / (4 * std::max<uint64_t>(num_threads, 1)));
+
+    // work items are either all unsplit documents in a group of 8, which fit
+    // into one byte, or a byte range of a split document.
+    struct WorkItem {
+        //! group of 8 documents, or the split document
+        uint64_t index;
+        //! byte range of split document, or zero
+        uint64_t begin, end;
+        //! estimated size, for scheduling large items first
+        uint64_t size;
+    };
+    std::vector<WorkItem> items;
+    // groups in which split documents share bytes with other work items
+    std::vector<uint8_t> group_split((paths.size() + 7) / 8);
+    std::vector<uint8_t> doc_split(paths.size());
+
+    for (uint64_t b = 0; b < group_split.size(); ++b) {
+        uint64_t group_size = 0;
+        for (uint64_t i = 8 * b; i < 8 * (b + 1) && i < paths.size(); ++i) {
+            // counted documents need all their k-mers in one sketch
+            if (!paths[i].splittable() || paths[i].size_ < 2 * range_size ||
+                paths[i].filters_min_count(params.min_count)) {
+                group_size += paths[i].size_;
+                continue;
+            }
+            group_split[b] = doc_split[i] = 1;
+            uint64_t num_ranges = tlx::div_ceil(paths[i].size_, range_size);
+            for (uint64_t r = 0; r < num_ranges; ++r) {
+                items.emplace_back(WorkItem {
+                        i, r * range_size,
+                        r + 1 == num_ranges ? uint64_t(-1) : (r + 1) * range_size,
+                        range_size
+                    });
+            }
+        }
+        items.emplace_back(WorkItem { b, 0, 0, group_size });
+    }
+    // largest first, the threads then steal the remaining items in order
+    std::stable_sort(
+        items.begin(), items.end(),
+        [](const WorkItem& a, const WorkItem& b) { return a.size > b.size; });
+
+    // the terms are random hence only little cache trashing inside a cache
+    // line should occur.
+    const uint64_t row_bits = cih.row_size() * 8;
+
+    auto process_item =
+        [&](const WorkItem& item, auto fixed_term_size, auto atomic) {
+            static constexpr uint64_t K = decltype(fixed_term_size)::value;
+            static constexpr bool Atomic = decltype(atomic)::value;
+            RollingCanonicalKMer<K> canonicalizer(cih.term_size_);
+            KMerFilter filter(params, cih);
+
+            auto process = [&](const tlx::string_view& term, uint64_t doc) {
+                process_term<K>(
+                    term, cih, canonicalizer, filter.get(), [&](uint64_t row) {
+                        set_bit<Atomic>(data.data(), row * row_bits + doc);
+                    });
+            };
+
+            uint64_t local_count = 0;
+            if (item.end != 0) {
+                filter.start_document(paths[item.index]);
+                paths[item.index].process_terms_range(
+                    cih.term_size_, item.begin, item.end,
+                    [&](const tlx::string_view& term) {
+                        process(term, item.index);
+                        ++local_count;
+                    });
+            }
+            else {
+                for (uint64_t i = 8 * item.index;
+                     i < 8 * (item.index + 1) && i < paths.size(); ++i) {
+                    if (doc_split[i]) continue;
+                    filter.start_document(paths[i]);
+                    local_count += process_document<K>(
+                        paths[i], cih, canonicalizer, filter.get(),
+                        [&](uint64_t row) {
+                            set_bit<Atomic>(data.data(), row * row_bits + i);
+                        });
+                }
+            }
+            count += local_count;
+        };
+
+    parallel_for(
+        0, items.size(), num_threads,
+        [&](uint64_t w) {
+            const WorkItem& item = items[w];
+            uint64_t group = item.end != 0 ? item.index / 8 : item.index;
+            dispatch_term_size(
+                cih.term_size_,
+                [&](auto fixed_term_size) {
+                    if (group_split[group])
+                        process_item(item, fixed_term_size, std::true_type());
+                    else
+                        process_item(item, fixed_term_size, std::false_type());
+                });
+        });
+
+    return count;
+}
+
+/*!
+ * Fill the matrix in row-partitioned rounds, returns the number of terms. The
+ * matrix is usually much larger than the caches, such that setting each bit
+ * directly costs a cache and TLB miss. Instead, each thread buffers the bits
+ * of its documents and radix-partitions them into ranges of consecutive rows
+ * of about slice_size bytes. When a buffer is full, or a thread runs out of
+ * documents, all threads meet at a barrier and each row range is applied by
+ * its owner thread from the partitions of all threads. The random writes of a
+ * range hence hit a cache-resident slice, the ranges are swept in order, and
+ * no atomic operations are needed since rows are never shared.
+ */
+static uint64_t
+partition_documents(const std::vector<DocumentEntry>& paths,
+                    uint64_t num_threads, const ClassicIndexParameters& params,
+                    const ClassicIndexHeader& cih, std::vector<uint8_t>& data) {
+    const uint64_t row_size = cih.row_size();
+    const uint64_t row_bits = row_size * 8;
+    const size_t buffer_size = std::max<uint64_t>(params.partition_buffer, 1);
+    const uint64_t slice_rows =
+        std::max<uint64_t>(params.slice_size / row_size, 1);
+    const uint64_t num_ranges = tlx::div_ceil(cih.signature_size_, slice_rows);
+    const unsigned num_workers = std::max<uint64_t>(
+        std::min<uint64_t>(num_threads, paths.size()), 1);
+
+    //! buffered bits of each thread and their row range partition
+    struct Partition {
+        std::vector<uint64_t> bits, sorted;
+        //! start of each row range in sorted
+        std::vector<size_t> begin;
+    };
+    std::vector<Partition> parts(num_workers);
+
+    tlx::ThreadBarrierMutex barrier(num_workers);
+    std::atomic<uint64_t> next_doc { 0 }, count { 0 };
+    std::atomic<unsigned> num_finished { 0 };
+    bool all_finished = false;
+    std::exception_ptr eptr;
+
+    auto exchange = [&](unsigned t) {
+        // counting sort of the own bits by row range
+        Partition& p = parts[t];
+        p.begin.assign(num_ranges + 1, 0);
+        for (const uint64_t& bit : p.bits)
+            ++p.begin[bit / row_bits / slice_rows + 1];
+        for (size_t r = 1; r <= num_ranges; ++r)
+            p.begin[r] += p.begin[r - 1];
+        p.sorted.resize(p.bits.size());
+        std::vector<size_t> pos(p.begin.begin(), p.begin.end() - 1);
+        for (const uint64_t& bit : p.bits)
+            p.sorted[pos[bit / row_bits / slice_rows]++] = bit;
+
+        barrier.wait(
+            [&]() { all_finished = (num_finished == num_workers); });
+
+        // apply the contiguous block of row ranges owned by this thread
+        uint64_t r_begin = num_ranges * t / num_workers;
+        uint64_t r_end = num_ranges * (t + 1) / num_workers;
+        for (uint64_t r = r_begin; r < r_end; ++r) {
+            for (const Partition& q : parts) {
+                for (size_t i = q.begin[r]; i < q.begin[r + 1]; ++i)
+                    set_bit(data.data(), q.sorted[i]);
+            }
+        }
+
+        barrier.wait();
+        p.bits.clear();
+    };
+
+    auto worker = [&](unsigned t) {
+        Partition& p = parts[t];
+        p.bits.reserve(buffer_size);
+        try {
+            dispatch_term_size(
+                cih.term_size_,
+                [&](auto fixed_term_size) {
+                    static constexpr uint64_t K =
+                        decltype(fixed_term_size)::value;
+                    RollingCanonicalKMer<K> canonicalizer(cih.term_size_);
+                    KMerFilter filter(params, cih);
+
+                    uint64_t i, local_count = 0;
+                    while ((i = next_doc++) < paths.size()) {
+                        filter.start_document(paths[i]);
+                        local_count += process_document<K>(
+                            paths[i], cih, canonicalizer, filter.get(),
+                            [&](uint64_t row) {
+                                p.bits.push_back(row * row_bits + i);
+                                if (p.bits.size() >= buffer_size)
+                                    exchange(t);
+                            });
+                    }
+                    count += local_count;
+                });
+        }
+        catch (...) {
+            eptr = std::current_exception();
+        }
+        // keep exchanging until all threads are out of documents
+        ++num_finished;
+        do {
+            exchange(t);
+        } while (!all_finished);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < num_workers; ++t)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (std::thread& t : threads)
+        t.join();
+    if (eptr)
+        std::rethrow_exception(eptr);
+
+    return count;
+}
+
+/*!
+ * Fill the matrix from per-document Bloom filters, returns the number of terms.
+ * Each work item builds the filters of a group of 8 documents, whose column
+ * byte it owns, as contiguous thread-private bitvectors. The random bit writes
+ * hence stay in a much smaller area than the whole matrix. The filters are then
+ * transposed in 8x8 bit blocks: byte r of the 8 filters holds rows 8r to 8r+7
+ * of the group's column.
+ */
+static uint64_t
+transpose_documents(const std::vector<DocumentEntry>& paths,
+                    uint64_t num_threads, const ClassicIndexParameters& params,
+                    const ClassicIndexHeader& cih, std::vector<uint8_t>& data) {
+    std::atomic<uint64_t> count = 0;
+    const uint64_t filter_size = tlx::div_ceil(cih.signature_size_, 8);
+    const uint64_t row_size = cih.row_size();
+
+    parallel_for(
+        0, (paths.size() + 7) / 8, num_threads,
+        [&](uint64_t b) {
+            std::vector<uint8_t> filters(8 * filter_size);
+            uint64_t local_count = 0;
+            dispatch_term_size(
+                cih.term_size_,
+                [&](auto fixed_term_size) {
+                    static constexpr uint64_t K =
+                        decltype(fixed_term_size)::value;
+                    RollingCanonicalKMer<K> canonicalizer(cih.term_size_);
+                    KMerFilter kmer_filter(params, cih);
+
+                    for (uint64_t d = 0; d < 8 && 8 * b + d < paths.size();
+                         ++d) {
+                        uint8_t* filter = filters.data() + d * filter_size;
+                        kmer_filter.start_document(paths[8 * b + d]);
+                        local_count += process_document<K>(
+                            paths[8 * b + d], cih, canonicalizer,
+                            kmer_filter.get(),
+                            [&](uint64_t row) { set_bit(filter, row); });
+                    }
+                });
+
+            for (uint64_t r = 0; r < filter_size; ++r) {
+                uint64_t block = 0;
+                for (uint64_t d = 0; d < 8; ++d)
+                    block |= uint64_t(filters[d * filter_size + r]) << (8 * d);
+                if (block == 0)
+                    continue;
+                block = transpose_bits_8x8(block);
+                // rows past the signature size are zero and skipped
+                for (uint64_t j = 0; j < 8; ++j) {
+                    uint8_t column = static_cast<uint8_t>(block >> (8 * j));
+                    if (column != 0)
+                        data[(8 * r + j) * row_size + b] = column;
+                }
+            }
+            count += local_count;
+        });
+
+    return count;
 }
 
 static inline
 void process_batch(uint64_t batch_num, uint64_t num_batches, uint64_t num_threads,
-                   std::string log_prefix,
+                   const ClassicIndexParameters& params,
                    const std::vector<DocumentEntry>& paths,
                    const fs::path& out_file,
                    ClassicIndexHeader& cih, Timer& t) {
+    const std::string& log_prefix = params.log_prefix;
 
     LOG1 << log_prefix
          << pad_index(batch_num) << '/' << pad_index(num_batches)
@@ -90,32 +506,16 @@ void process_batch(uint64_t batch_num, uint64_t num_batches, uint64_t num_thread
     die_unless(paths.size() <= cih.row_size() * 8);
     std::vector<uint8_t> data(cih.signature_size_* cih.row_size());
 
-    std::atomic<uint64_t> count = 0;
-    t.active("process");
-
-    // parallelize over 8 documents, which fit into one byte, the terms are
-    // random hence only little cache trashing inside a cache line should occur.
-    parallel_for(
-        0, (paths.size() + 7) / 8, num_threads,
-        [&](uint64_t b) {
-            tlx::simple_vector<char> canonicalize_buffer(cih.term_size_);
+    for (uint64_t i = 0; i < paths.size(); ++i)
+        cih.file_names_[i] = paths[i].name_;
 
-            uint64_t local_count = 0;
-            for (uint64_t i = 8 * b; i < 8 * (b + 1) && i < paths.size(); ++i) {
-                cih.file_names_[i] = paths[i].name_;
-                bool shown_canonicalization_warning = false;
-
-                paths[i].process_terms(
-                    cih.term_size_,
-                    [&](const tlx::string_view& term) {
-                        process_term(term, data, i, paths[i].path_,
-                                     &shown_canonicalization_warning,
-                                     cih, canonicalize_buffer.data());
-                        ++local_count;
-                    });
-            }
-            count += local_count;
-        });
+    t.active("process");
+    uint64_t count =
+        params.engine == ClassicEngine::Transpose
+        ? transpose_documents(paths, num_threads, params, cih, data)
+        : params.engine == ClassicEngine::Partition
+        ? partition_documents(paths, num_threads, params, cih, data)
+        : scatter_documents(paths, num_threads, params, cih, data);
 
     t.active("write");
     cih.write_file(out_file, data);
@@ -178,10 +578,12 @@ void classic_construct_from_documents(
             cih.canonicalize_ = params.canonicalize;
             cih.signature_size_ = params.signature_size;
             cih.num_hashes_ = params.num_hashes;
+            cih.block_rows_ = params.block_rows;
+            cih.hash_scheme_ = params.hash_scheme;
             cih.file_names_.resize(paths.size());
             process_batch(batch_num, num_batches,
                           tlx::div_ceil(num_threads, num_batches),
-                          params.log_prefix, paths, out_path, cih, thr_timer);
+                          params, paths, out_path, cih, thr_timer);
 
             t += thr_timer;
         });
@@ -197,8 +599,9 @@ void classic_combine_streams(
     std::vector<uint64_t>& row_bits,
     const fs::path& out_file,
     uint64_t term_size, uint8_t canonicalize, uint64_t signature_size,
-    uint64_t new_row_bits, uint64_t num_hash, uint64_t mem_bytes,
-    Timer& t, const std::vector<std::string>& file_names)
+    uint64_t new_row_bits, uint64_t num_hash, uint64_t block_rows,
+    HashScheme hash_scheme,
+    uint64_t mem_bytes, Timer& t, const std::vector<std::string>& file_names)
 {
     static constexpr bool debug = false;
 
@@ -211,6 +614,8 @@ void classic_combine_streams(
     cih.canonicalize_ = canonicalize;
     cih.signature_size_ = signature_size;
     cih.num_hashes_ = num_hash;
+    cih.block_rows_ = block_rows;
+    cih.hash_scheme_ = hash_scheme;
     cih.file_names_ = file_names;
     serialize_header(ofs, out_file, cih);
 
@@ -452,6 +857,8 @@ bool classic_combine(const fs::path& in_dir, const fs::path& out_dir,
             uint8_t canonicalize = false;
             uint64_t signature_size = 0;
             uint64_t num_hashes = 0;
+            uint64_t block_rows = 0;
+            HashScheme hash_scheme = HashScheme::XXH64;
 
             streams.reserve(files.size());
             row_bits.reserve(files.size());
@@ -470,11 +877,15 @@ bool classic_combine(const fs::path& in_dir, const fs::path& out_dir,
                     canonicalize = cih.canonicalize_;
                     signature_size = cih.signature_size_;
                     num_hashes = cih.num_hashes_;
+                    block_rows = cih.block_rows_;
+                    hash_scheme = cih.hash_scheme_;
                 }
                 die_unequal(cih.term_size_, term_size);
                 die_unequal(cih.canonicalize_, canonicalize);
                 die_unequal(cih.signature_size_, signature_size);
                 die_unequal(cih.num_hashes_, num_hashes);
+                die_unequal(cih.block_rows_, block_rows);
+                die_unless(cih.hash_scheme_ == hash_scheme);
                 // calculate new row length
                 row_bits.emplace_back(cih.row_bits());
                 new_row_bits += cih.row_bits();
@@ -489,7 +900,8 @@ bool classic_combine(const fs::path& in_dir, const fs::path& out_dir,
 
             classic_combine_streams(
                 streams, row_bits, out_path, term_size, canonicalize,
-                signature_size, new_row_bits, num_hashes,
+                signature_size, new_row_bits, num_hashes, block_rows,
+                hash_scheme,
                 mem_bytes / num_threads, thr_timer, file_names);
             streams.clear();
             file_names.clear();
@@ -518,13 +930,50 @@ bool classic_combine(const fs::path& in_dir, const fs::path& out_dir,
 
 /******************************************************************************/
 
+void check_min_count(unsigned min_count, uint8_t canonicalize,
+                     uint64_t term_size) {
+    if (min_count > 255)
+        die("min_count must be at most 255");
+    if (min_count > 1 && (canonicalize != 1 || term_size > 32))
+        die("min_count requires canonical k-mers of at most 32 bases");
+}
+
+void check_hash_scheme(HashScheme hash_scheme, uint8_t canonicalize,
+                       uint64_t term_size) {
+    if (hash_scheme == HashScheme::XXH3_2Bit &&
+        (canonicalize != 1 || term_size > 32))
+        die("hash scheme xxh3-2bit requires canonical k-mers of at most 32 "
+            "bases");
+}
+
 static inline
 uint64_t get_max_file_size(const DocumentList& doc_list,
-                           uint64_t term_size) {
+                           const ClassicIndexParameters& params) {
     static constexpr bool debug = false;
+    const uint64_t term_size = params.term_size;
+    const std::vector<DocumentEntry>& paths = doc_list.list();
+
+    if (params.distinct || params.min_count > 1) {
+        // the file size neither bounds the number of distinct k-mers nor the
+        // number of solid k-mers of FASTQ documents: a small high-coverage
+        // file may have more of them than a large low-coverage one. Hence
+        // count them for all documents.
+        std::vector<uint64_t> doc_terms(paths.size());
+        parallel_for(
+            0, paths.size(), params.num_threads,
+            [&](uint64_t i) {
+                doc_terms[i] = paths[i].num_indexed_terms(
+                    term_size, params.min_count, params.distinct,
+                    params.canonicalize, KMerFilter::sketch_bytes(params));
+            });
+        uint64_t max_terms = 0;
+        for (uint64_t t : doc_terms)
+            max_terms = std::max(max_terms, t);
+        sLOG << "Max Document Size [distinct/min_count]:" << max_terms;
+        return max_terms;
+    }
 
     // sort document by file size (as approximation to the number of kmers)
-    const std::vector<DocumentEntry>& paths = doc_list.list();
     auto it = std::max_element(
         paths.begin(), paths.end(),
         [](const DocumentEntry& p1, const DocumentEntry& p2) {
@@ -557,8 +1006,11 @@ uint64_t get_max_file_size(const DocumentList& doc_list,
         return it->num_terms(term_size);
     }
     else if (it->type_ == FileType::Fastq) {
-        sLOG << "Max Document Size [FastQ]:" << it->num_terms(term_size);
-        return it->num_terms(term_size);
+        uint64_t num_terms = it->num_indexed_terms(
+            term_size, params.min_count, false, params.canonicalize,
+            KMerFilter::sketch_bytes(params));
+        sLOG << "Max Document Size [FastQ]:" << num_terms;
+        return num_terms;
     }
     die("Unknown file type");
 }
@@ -568,12 +1020,20 @@ void classic_construct(
     fs::path tmp_path, ClassicIndexParameters params)
 {
     die_unless(params.num_hashes != 0);
+    check_min_count(params.min_count, params.canonicalize, params.term_size);
+    check_hash_scheme(params.hash_scheme, params.canonicalize,
+                      params.term_size);
 
     // estimate signature size by finding number of elements in the largest file
-    uint64_t max_doc_size = get_max_file_size(filelist, params.term_size);
+    uint64_t max_doc_size =
+        get_max_file_size(filelist, params);
     if (params.signature_size == 0)
         params.signature_size = calc_signature_size(
             max_doc_size, params.num_hashes, params.false_positive_rate);
+    // blocks of the blocked Bloom filter must tile the signature
+    if (params.block_rows > 1)
+        params.signature_size =
+            tlx::round_up(params.signature_size, params.block_rows);
 
     uint64_t docsize_roundup = tlx::round_up(filelist.size(), 8);
 
@@ -582,7 +1042,11 @@ void classic_construct(
          << "  canonicalize: " << unsigned(params.canonicalize) << '\n'
          << "  number of documents: " << filelist.size() << '\n'
          << "  maximum document size: " << max_doc_size << '\n'
+         << "  min_count: " << params.min_count << '\n'
+         << "  distinct: " << unsigned(params.distinct) << '\n'
          << "  num_hashes: " << params.num_hashes << '\n'
+         << "  block_rows: " << params.block_rows << '\n'
+         << "  hash_scheme: " << hash_scheme_name(params.hash_scheme) << '\n'
          << "  false_positive_rate: " << params.false_positive_rate << '\n'
          << "  signature_size: " << params.signature_size
          << " = " << tlx::format_iec_units(params.signature_size) << '\n'
@@ -659,6 +1123,187 @@ void classic_construct(
     }
 }
 
+void classic_append(
+    const fs::path& in_file, const DocumentList& doc_list,
+    const fs::path& out_file, fs::path tmp_path,
+    ClassicIndexParameters params)
+{
+    Timer t;
+
+    // the new documents must use the parameters of the existing index
+    std::ifstream in_stream;
+    ClassicIndexHeader in_header =
+        deserialize_header<ClassicIndexHeader>(in_stream, in_file);
+    params.term_size = in_header.term_size_;
+    params.canonicalize = in_header.canonicalize_;
+    params.num_hashes = in_header.num_hashes_;
+    params.signature_size = in_header.signature_size_;
+    params.block_rows = in_header.block_rows_;
+    params.hash_scheme = in_header.hash_scheme_;
+
+    LOG1 << "Classic Index Append:\n"
+         << "  existing documents: " << in_header.row_bits() << '\n'
+         << "  new documents: " << doc_list.size() << '\n'
+         << "  term_size: " << params.term_size << '\n'
+         << "  canonicalize: " << unsigned(params.canonicalize) << '\n'
+         << "  num_hashes: " << params.num_hashes << '\n'
+         << "  signature_size: " << params.signature_size;
+
+    if (!tlx::ends_with(out_file.string(), ClassicIndexHeader::file_extension)) {
+        die("Error: classic COBS index file must end with "
+            << ClassicIndexHeader::file_extension);
+    }
+    // replacing the input file is allowed, it is only renamed at the end
+    if (fs::exists(out_file) && !fs::equivalent(in_file, out_file)) {
+        if (params.clobber)
+            fs::remove_all(out_file);
+        else
+            die("Output file exists, will not overwrite without --clobber");
+    }
+
+    if (tmp_path.empty()) {
+        tmp_path = out_file.string() + ".tmp";
+    }
+    if (fs::exists(tmp_path)) {
+        if (params.clobber)
+            fs::remove_all(tmp_path);
+        else
+            die("Temporary directory exists, will not delete without --clobber");
+    }
+    fs::create_directories(tmp_path);
+
+    // construct a classic index of only the new documents
+    fs::path append_file =
+        tmp_path / ("append" + ClassicIndexHeader::file_extension);
+    classic_construct(doc_list, append_file, tmp_path / "construct", params);
+
+    // interleave the new columns into the existing rows in one pass
+    std::vector<std::ifstream> streams(2);
+    streams[0] = std::move(in_stream);
+    ClassicIndexHeader append_header =
+        deserialize_header<ClassicIndexHeader>(streams[1], append_file);
+    die_unequal(append_header.signature_size_, in_header.signature_size_);
+    die_unequal(append_header.block_rows_, in_header.block_rows_);
+    die_unless(append_header.hash_scheme_ == in_header.hash_scheme_);
+
+    std::vector<uint64_t> row_bits = {
+        in_header.row_bits(), append_header.row_bits()
+    };
+    std::vector<std::string> file_names = std::move(in_header.file_names_);
+    file_names.insert(file_names.end(),
+                      append_header.file_names_.begin(),
+                      append_header.file_names_.end());
+
+    fs::path combined_file =
+        tmp_path / ("combined" + ClassicIndexHeader::file_extension);
+    classic_combine_streams(
+        streams, row_bits, combined_file,
+        params.term_size, params.canonicalize, params.signature_size,
+        file_names.size(), params.num_hashes, params.block_rows,
+        params.hash_scheme,
+        params.mem_bytes, t, file_names);
+    streams.clear();
+
+    fs::rename(combined_file, out_file);
+
+    if (!params.keep_temporary) {
+        fs::remove_all(tmp_path);
+    }
+
+    t.print("classic_append");
+}
+
+/******************************************************************************/
+// Removal of deleted documents
+
+void classic_purge(const fs::path& in_file, const fs::path& out_file,
+                   uint64_t mem_bytes) {
+    Timer t;
+
+    std::ifstream ifs;
+    ClassicIndexHeader in_header =
+        deserialize_header<ClassicIndexHeader>(ifs, in_file);
+
+    Tombstones tombstones;
+    tombstones.load(in_file, in_header.row_bits());
+
+    // runs of consecutive kept documents: (input column, length)
+    std::vector<std::pair<uint64_t, uint64_t> > runs;
+    ClassicIndexHeader out_header;
+    out_header.term_size_ = in_header.term_size_;
+    out_header.canonicalize_ = in_header.canonicalize_;
+    out_header.signature_size_ = in_header.signature_size_;
+    out_header.num_hashes_ = in_header.num_hashes_;
+    out_header.block_rows_ = in_header.block_rows_;
+    out_header.hash_scheme_ = in_header.hash_scheme_;
+    for (uint64_t i = 0; i < in_header.row_bits(); ++i) {
+        if (tombstones.deleted(i))
+            continue;
+        if (!runs.empty() && runs.back().first + runs.back().second == i)
+            ++runs.back().second;
+        else
+            runs.emplace_back(i, 1);
+        out_header.file_names_.push_back(in_header.file_names_[i]);
+    }
+
+    uint64_t in_row_bytes = in_header.row_size();
+    uint64_t out_row_bytes = out_header.row_size();
+    uint64_t signature_size = in_header.signature_size_;
+    uint64_t batch_size = std::min(
+        signature_size,
+        std::max<uint64_t>(1, mem_bytes / (in_row_bytes + out_row_bytes)));
+
+    LOG1 << "classic_purge()"
+         << " documents=" << in_header.row_bits()
+         << " deleted=" << tombstones.count()
+         << " runs=" << runs.size()
+         << " batch_size=" << batch_size;
+
+    // write to a temporary file, such that in_file may be replaced
+    fs::path tmp_file = out_file.string() + ".tmp";
+    std::ofstream ofs;
+    serialize_header(ofs, tmp_file, out_header);
+
+    std::vector<uint8_t> in_block(in_row_bytes * batch_size);
+    std::vector<uint8_t> out_block(out_row_bytes * batch_size);
+    for (uint64_t row = 0; row < signature_size; row += batch_size) {
+        uint64_t this_batch = std::min(batch_size, signature_size - row);
+
+        t.active("read");
+        ifs.read(reinterpret_cast<char*>(in_block.data()),
+                 in_row_bytes * this_batch);
+        die_unequal(in_row_bytes * this_batch,
+                    static_cast<uint64_t>(ifs.gcount()));
+
+        t.active("copy");
+        std::fill(out_block.begin(), out_block.end(), 0);
+        for (uint64_t k = 0; k < this_batch; ++k) {
+            const uint8_t* in = in_block.data() + k * in_row_bytes;
+            uint8_t* out = out_block.data() + k * out_row_bytes;
+            uint64_t out_pos = 0;
+            for (const auto& run : runs) {
+                copy_bits(in, run.first, out, out_pos, run.second);
+                out_pos += run.second;
+            }
+        }
+
+        t.active("write");
+        ofs.write(reinterpret_cast<const char*>(out_block.data()),
+                  out_row_bytes * this_batch);
+    }
+    ofs.close();
+    ifs.close();
+    t.stop();
+
+    fs::rename(tmp_file, out_file);
+    // the columns of out_file changed, a previous sidecar is invalid
+    fs::remove(Tombstones::sidecar_path(out_file));
+
+    t.print("classic_purge");
+}
+
+/******************************************************************************/
+
 void classic_construct_random(const fs::path& out_file,
                               uint64_t signature_size,
                               uint64_t num_documents, uint64_t document_size,
@@ -685,7 +1330,7 @@ void classic_construct_random(const fs::path& out_file,
     std::mt19937 rng(seed);
     KMerBuffer<31> doc;
 
-    std::vector<char> canonicalize_buffer(term_size);
+    RollingCanonicalKMer<> canonicalizer(term_size);
 
     t.active("generate");
     for (uint64_t i = 0; i < num_documents; ++i) {
@@ -702,15 +1347,15 @@ void classic_construct_random(const fs::path& out_file,
         std::string term;
         term.reserve(32);
 
-        bool shown_canonicalization_warning = false;
-
         // TODO: parallel for over setting of bits of the SAME document
         for (uint64_t j = 0; j < doc.data().size(); j++) {
             doc.data()[j].canonicalize();
             doc.data()[j].to_string(&term);
-            process_term(tlx::string_view(term), data, i, "random",
-                         &shown_canonicalization_warning,
-                         cih, canonicalize_buffer.data());
+            process_term(
+                tlx::string_view(term), cih, canonicalizer, nullptr,
+                [&](uint64_t row) {
+                    set_bit(data.data(), row * cih.row_size() * 8 + i);
+                });
         }
     }
 
@@ -725,6 +1370,50 @@ void classic_construct_random(const fs::path& out_file,
     t.print("classic_construct_random");
 }
 
+/******************************************************************************/
+// Bundling of classic indices
+
+void classic_bundle(const std::vector<fs::path>& in_files,
+                    const fs::path& out_file) {
+    uint64_t alignment = std::max<uint64_t>(gopt_data_alignment, 1);
+
+    // check that all inputs are classic indices and lay out the directory
+    IndexBundleHeader bh;
+    uint64_t pos = IndexBundleHeader::header_size(in_files.size());
+    for (const fs::path& p : in_files) {
+        std::ifstream ifs;
+        deserialize_header<ClassicIndexHeader>(ifs, p, false);
+
+        pos = tlx::round_up(pos, alignment);
+        uint64_t size = fs::file_size(p);
+        bh.members_.push_back(IndexBundleHeader::Member { pos, size });
+        pos += size;
+    }
+
+    if (!out_file.parent_path().empty())
+        fs::create_directories(out_file.parent_path());
+    std::ofstream ofs(out_file.string(), std::ios::out | std::ios::binary);
+    ofs.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+    bh.serialize(ofs);
+
+    std::vector<char> padding;
+    for (size_t i = 0; i < in_files.size(); ++i) {
+        const IndexBundleHeader::Member& m = bh.members_[i];
+        padding.resize(m.offset - ofs.tellp());
+        ofs.write(padding.data(), padding.size());
+
+        std::ifstream ifs(in_files[i].string(),
+                          std::ios::in | std::ios::binary);
+        die_unless(ifs.good());
+        ofs << ifs.rdbuf();
+        die_unequal(uint64_t(ofs.tellp()), m.offset + m.size);
+    }
+
+    LOG1 << "classic_bundle: wrote " << in_files.size()
+         << " indices to " << out_file
+         << " [" << tlx::format_iec_units(pos) << "B]";
+}
+
 } // namespace cobs
 
 /******************************************************************************/
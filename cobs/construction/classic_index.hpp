@@ -23,6 +23,35 @@
  */
 namespace cobs {
 
+/*!
+ * Methods to fill the bit matrix of a batch of documents.
+ */
+enum class ClassicEngine {
+    //! set the bits of each term directly in the shared row-major matrix
+    Scatter,
+    //! build a private Bloom filter per document and transpose groups of 8
+    //! filters in 8x8 bit blocks into the matrix.
+    Transpose,
+    //! buffer the bits per thread, partition them by row range, and let each
+    //! thread apply the ranges it owns into a cache-resident slice.
+    Partition,
+};
+
+//! parse the name of a construction engine: "scatter", "transpose" or
+//! "partition"
+static inline
+ClassicEngine parse_classic_engine(const std::string& name) {
+    if (name == "scatter")
+        return ClassicEngine::Scatter;
+    if (name == "partition")
+        return ClassicEngine::Partition;
+    if (name != "transpose") {
+        die("Unknown engine \"" << name
+            << "\", use scatter, transpose or partition");
+    }
+    return ClassicEngine::Transpose;
+}
+
 /*!
  * Parameters for classic index construction.
  */
@@ -33,6 +62,11 @@ struct ClassicIndexParameters {
     uint8_t canonicalize = 1;
     //! number of hash functions, provided by user
     unsigned num_hashes = 1;
+    //! number of consecutive rows holding all probes of one term (blocked
+    //! Bloom filter), or zero for independent probes.
+    uint64_t block_rows = 0;
+    //! hash functions mapping terms to rows
+    HashScheme hash_scheme = HashScheme::XXH64;
     //! false positive rate, provided by user
     double false_positive_rate = 0.3;
     //! signature size, either provided by user or calculated from
@@ -42,6 +76,27 @@ struct ClassicIndexParameters {
     uint64_t mem_bytes = get_memory_size(80);
     //! number of threads to use
     unsigned num_threads = gopt_threads;
+    //! minimum size of the byte ranges into which large uncompressed FASTA
+    //! and FASTQ documents are split to process them with several threads.
+    uint64_t split_size = 64 * 1024 * 1024;
+    //! method to fill the bit matrix of a batch
+    ClassicEngine engine = ClassicEngine::Scatter;
+    //! size of the row ranges into which the partition engine sorts the bits
+    //! before applying them, such that each range is cache-resident.
+    uint64_t slice_size = 256 * 1024;
+    //! number of bits the partition engine buffers per thread before the
+    //! threads exchange and apply them.
+    uint64_t partition_buffer = 1024 * 1024;
+    //! skip repeated canonical k-mers of a document before hashing them, only
+    //! for term_size <= 32.
+    bool dedup = false;
+    //! index only k-mers of FASTQ documents occurring at least this many times
+    //! (solid k-mers), counted approximately with a KMerCountSketch. One
+    //! indexes all k-mers.
+    unsigned min_count = 1;
+    //! size signatures by the estimated number of distinct k-mers of the
+    //! documents instead of their number of k-mer positions.
+    bool distinct = false;
     //! log prefix (used by compact index construction)
     std::string log_prefix;
     //! clobber erase output directory if it exists, default: false
@@ -63,6 +118,16 @@ void classic_construct(
     const DocumentList& filelist, const fs::path& out_dir,
     fs::path tmp_path, ClassicIndexParameters index_params);
 
+//! check that min_count can be applied, which requires canonical k-mers of
+//! at most 32 bases.
+void check_min_count(unsigned min_count, uint8_t canonicalize,
+                     uint64_t term_size);
+
+//! check that the hash scheme can be applied, xxh3-2bit requires canonical
+//! k-mers of at most 32 bases.
+void check_hash_scheme(HashScheme hash_scheme, uint8_t canonicalize,
+                       uint64_t term_size);
+
 /*!
  * Constructs multiple small indices from document files.
  */
@@ -77,6 +142,33 @@ bool classic_combine(
     const fs::path& in_dir, const fs::path& out_dir, fs::path& result_file,
     uint64_t mem_bytes, uint64_t num_threads, bool keep_temporary);
 
+/*!
+ * Appends documents to an existing classic index. A classic index of the new
+ * documents is constructed using the parameters of the existing one, and its
+ * columns are interleaved into the existing rows in one streaming pass. The
+ * old documents are not hashed again. out_file may be the same as in_file.
+ */
+void classic_append(
+    const fs::path& in_file, const DocumentList& doc_list,
+    const fs::path& out_file, fs::path tmp_path,
+    ClassicIndexParameters index_params);
+
+/*!
+ * Rewrites a classic index without the documents marked as deleted in its
+ * tombstone sidecar file. The remaining columns are copied row by row using
+ * at most mem_bytes of buffer. out_file may be the same as in_file, in which
+ * case the sidecar is removed afterwards.
+ */
+void classic_purge(const fs::path& in_file, const fs::path& out_file,
+                   uint64_t mem_bytes);
+
+/*!
+ * Packs complete classic index files into one index bundle (.cobs_bundle).
+ * The members are placed at multiples of gopt_data_alignment.
+ */
+void classic_bundle(const std::vector<fs::path>& in_files,
+                    const fs::path& out_file);
+
 /*!
  * Constructs a classic index filled with random data.
  */
@@ -11,10 +11,18 @@
 #include <cobs/file/classic_index_header.hpp>
 #include <cobs/file/compact_index_header.hpp>
 #include <cobs/file/kmer_buffer_header.hpp>
+#include <cobs/file/tombstones.hpp>
 #include <cobs/util/calc_signature_size.hpp>
 #include <cobs/util/file.hpp>
+#include <cobs/util/misc.hpp>
+#include <cobs/util/parallel_for.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
+#include <limits>
+#include <numeric>
+#include <tuple>
 
 #include <tlx/die.hpp>
 #include <tlx/math/div_ceil.hpp>
@@ -61,6 +69,8 @@ void compact_combine_into_compact(
 
     uint64_t term_size = 0;
     uint8_t canonicalize = 0;
+    uint64_t block_rows = 0;
+    HashScheme hash_scheme = HashScheme::XXH64;
     std::vector<CompactIndexHeader::parameter> parameters;
     std::vector<std::string> file_names;
 
@@ -75,9 +85,13 @@ void compact_combine_into_compact(
         if (term_size == 0) {
             term_size = h.term_size_;
             canonicalize = h.canonicalize_;
+            block_rows = h.block_rows_;
+            hash_scheme = h.hash_scheme_;
         }
         die_unequal(term_size, h.term_size_);
         die_unequal(canonicalize, h.canonicalize_);
+        die_unequal(block_rows, h.block_rows_);
+        die_unless(hash_scheme == h.hash_scheme_);
 
         LOG1 << i << ": " << h.row_bits() << " documents "
              << tlx::format_iec_units(fs::file_size(paths[i])) << 'B'
@@ -100,6 +114,8 @@ void compact_combine_into_compact(
     h.parameters_ = parameters;
     h.file_names_ = file_names;
     h.page_size_ = page_size;
+    h.block_rows_ = block_rows;
+    h.hash_scheme_ = hash_scheme;
     std::ofstream ofs;
     serialize_header(ofs, out_file, h);
 
@@ -168,36 +184,97 @@ void compact_combine_into_compact(
     t.print("compact_combine_into_compact()");
 }
 
-void compact_construct(DocumentList doc_list, const fs::path& index_file,
-                       fs::path tmp_path, CompactIndexParameters params) {
-    uint64_t iteration = 1;
-
-    // check output file
-    if (!tlx::ends_with(index_file.string(), CompactIndexHeader::file_extension)) {
-        die("Error: classic COBS index file must end with "
-            << CompactIndexHeader::file_extension);
-    }
+//! signature size of a page whose largest document has max_doc_size terms
+static inline
+uint64_t page_signature_size(uint64_t max_doc_size,
+                             const CompactIndexParameters& params) {
+    uint64_t signature_size = calc_signature_size(
+        max_doc_size, params.num_hashes, params.false_positive_rate);
+    if (params.block_rows > 1)
+        signature_size = tlx::round_up(signature_size, params.block_rows);
+    return signature_size;
+}
 
-    // read file list, sort by size
-    doc_list.sort_by_size();
+std::vector<uint64_t> partition_pages(const std::vector<uint64_t>& doc_terms,
+                                      uint64_t page_size) {
+    uint64_t num_docs = doc_terms.size();
+    std::vector<uint64_t> sorted(num_docs);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [&](uint64_t a, uint64_t b) {
+                         return doc_terms[a] < doc_terms[b];
+                     });
+
+    // the smallest documents go into the partial last page
+    uint64_t num_partial = num_docs % (8 * page_size);
+    std::vector<uint64_t> order;
+    order.reserve(num_docs);
+    order.insert(order.end(), sorted.begin() + num_partial, sorted.end());
+    order.insert(order.end(), sorted.begin(), sorted.begin() + num_partial);
+    return order;
+}
 
-    if (params.page_size == 0) {
-        params.page_size = tlx::round_up_to_power_of_two(
-            static_cast<uint64_t>(std::sqrt(doc_list.size() / 8)));
-        params.page_size = std::max<uint64_t>(params.page_size, 8);
-        params.page_size = std::min<uint64_t>(params.page_size, 4096);
+uint64_t compact_index_size(const std::vector<uint64_t>& doc_terms,
+                            uint64_t page_size,
+                            const CompactIndexParameters& params) {
+    uint64_t total_size = 0;
+    for (uint64_t begin = 0; begin < doc_terms.size();
+         begin += 8 * page_size) {
+        uint64_t end = std::min<uint64_t>(
+            begin + 8 * page_size, doc_terms.size());
+        uint64_t max_doc_size = *std::max_element(
+            doc_terms.begin() + begin, doc_terms.begin() + end);
+        total_size += page_size * page_signature_size(max_doc_size, params);
     }
+    return total_size;
+}
 
-    uint64_t num_pages = tlx::div_ceil(doc_list.size(), 8 * params.page_size);
+uint64_t choose_page_size(const std::vector<uint64_t>& doc_terms,
+                          const CompactIndexParameters& params) {
+    struct Candidate {
+        uint64_t page_size, index_size, query_cost;
+    };
+    std::vector<Candidate> candidates;
+    uint64_t min_index_size = std::numeric_limits<uint64_t>::max();
+    for (uint64_t page_size = 8; page_size <= 4096; page_size *= 2) {
+        std::vector<uint64_t> order = partition_pages(doc_terms, page_size);
+        std::vector<uint64_t> terms(order.size());
+        for (uint64_t i = 0; i < order.size(); ++i)
+            terms[i] = doc_terms[order[i]];
+
+        Candidate c;
+        c.page_size = page_size;
+        c.index_size = compact_index_size(terms, page_size, params);
+        c.query_cost = tlx::div_ceil(doc_terms.size(), 8 * page_size) *
+                       std::max(page_size, get_page_size());
+        candidates.push_back(c);
+        min_index_size = std::min(min_index_size, c.index_size);
+
+        LOG1 << "choose_page_size(): page_size " << page_size
+             << " index_size " << c.index_size
+             << " query_cost " << c.query_cost;
+    }
 
-    uint64_t num_threads = params.num_threads;
-    if (num_threads > num_pages) {
-        // use div_floor() instead
-        num_threads = doc_list.size() / (8 * params.page_size);
+    const Candidate* best = nullptr;
+    for (const Candidate& c : candidates) {
+        if (c.index_size > (1.0 + params.page_size_overhead) * min_index_size)
+            continue;
+        if (best == nullptr ||
+            std::tie(c.query_cost, c.index_size) <
+            std::tie(best->query_cost, best->index_size))
+            best = &c;
     }
-    if (num_threads == 0) num_threads = 1;
+    return best->page_size;
+}
 
-    // check output and maybe clobber
+void compact_construct(DocumentList doc_list, const fs::path& index_file,
+                       fs::path tmp_path, CompactIndexParameters params) {
+    uint64_t iteration = 1;
+    check_min_count(params.min_count, params.canonicalize, params.term_size);
+    check_hash_scheme(params.hash_scheme, params.canonicalize,
+                      params.term_size);
+
+    // check output file
     if (!tlx::ends_with(index_file.string(), CompactIndexHeader::file_extension)) {
         die("Error: classic COBS index file must end with "
             << CompactIndexHeader::file_extension);
@@ -230,10 +307,56 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
         }
     }
 
+    // read file list, sort by size
+    doc_list.sort_by_size();
+
+    // number of indexed terms of each document, which are counted only once,
+    // since solid k-mers of FASTQ documents with min_count and distinct k-mer
+    // estimates require a pass over the documents.
+    std::vector<uint64_t> doc_terms(doc_list.size());
+    parallel_for(
+        0, doc_list.size(), params.num_threads,
+        [&](uint64_t i) {
+            doc_terms[i] = doc_list[i].num_indexed_terms(
+                params.term_size, params.min_count, params.distinct,
+                params.canonicalize,
+                params.mem_bytes / std::max(params.num_threads, 1u));
+        });
+
+    if (params.optimize_pages) {
+        if (params.page_size == 0)
+            params.page_size = choose_page_size(doc_terms, params);
+
+        std::vector<uint64_t> order =
+            partition_pages(doc_terms, params.page_size);
+        doc_list.reorder(order);
+        std::vector<uint64_t> terms(order.size());
+        for (uint64_t i = 0; i < order.size(); ++i)
+            terms[i] = doc_terms[order[i]];
+        doc_terms.swap(terms);
+    }
+    else if (params.page_size == 0) {
+        params.page_size = tlx::round_up_to_power_of_two(
+            static_cast<uint64_t>(std::sqrt(doc_list.size() / 8)));
+        params.page_size = std::max<uint64_t>(params.page_size, 8);
+        params.page_size = std::min<uint64_t>(params.page_size, 4096);
+    }
+
+    uint64_t num_pages = tlx::div_ceil(doc_list.size(), 8 * params.page_size);
+
+    uint64_t num_threads = params.num_threads;
+    if (num_threads > num_pages) {
+        // use div_floor() instead
+        num_threads = doc_list.size() / (8 * params.page_size);
+    }
+    if (num_threads == 0) num_threads = 1;
+
     LOG1 << "Compact Index Parameters:\n"
          << "  term_size: " << params.term_size << '\n'
          << "  number of documents: " << doc_list.size() << '\n'
          << "  num_hashes: " << params.num_hashes << '\n'
+         << "  block_rows: " << params.block_rows << '\n'
+         << "  hash_scheme: " << hash_scheme_name(params.hash_scheme) << '\n'
          << "  false_positive_rate: " << params.false_positive_rate << '\n'
          << "  page_size: " << params.page_size << " bytes"
          << " = " << params.page_size * 8 << " documents" << '\n'
@@ -241,25 +364,31 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
          << "  mem_bytes: " << params.mem_bytes
          << " = " << tlx::format_iec_units(params.mem_bytes) << 'B' << '\n'
          << "  num_threads: " << num_threads << '\n'
+         << "  distinct: " << unsigned(params.distinct) << '\n'
+         << "  optimize_pages: " << unsigned(params.optimize_pages) << '\n'
          << "  clobber: " << unsigned(params.clobber) << '\n'
          << "  continue_: " << unsigned(params.continue_) << '\n'
          << "  keep_temporary: " << unsigned(params.keep_temporary);
 
+    auto batch_max_doc_size = [&](uint64_t batch_num) {
+        uint64_t begin = batch_num * 8 * params.page_size;
+        uint64_t end = std::min<uint64_t>(
+            begin + 8 * params.page_size, doc_terms.size());
+        return *std::max_element(
+            doc_terms.begin() + begin, doc_terms.begin() + end);
+    };
+
     uint64_t total_size = 0;
 
     doc_list.process_batches(
         8 * params.page_size,
-        [&](uint64_t /* batch_num */, const std::vector<DocumentEntry>& files,
+        [&](uint64_t batch_num, const std::vector<DocumentEntry>& /* files */,
             fs::path /* out_file */) {
 
-            uint64_t max_doc_size = 0;
-            for (const DocumentEntry& de : files) {
-                max_doc_size = std::max(
-                    max_doc_size, de.num_terms(params.term_size));
-            }
+            uint64_t max_doc_size = batch_max_doc_size(batch_num);
 
-            uint64_t signature_size = calc_signature_size(
-                max_doc_size, params.num_hashes, params.false_positive_rate);
+            uint64_t signature_size =
+                page_signature_size(max_doc_size, params);
 
             total_size += params.page_size * signature_size;
         });
@@ -272,14 +401,10 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
         [&](uint64_t batch_num, const std::vector<DocumentEntry>& files,
             fs::path /* out_file */) {
 
-            uint64_t max_doc_size = 0;
-            for (const DocumentEntry& de : files) {
-                max_doc_size = std::max(
-                    max_doc_size, de.num_terms(params.term_size));
-            }
+            uint64_t max_doc_size = batch_max_doc_size(batch_num);
 
-            uint64_t signature_size = calc_signature_size(
-                max_doc_size, params.num_hashes, params.false_positive_rate);
+            uint64_t signature_size =
+                page_signature_size(max_doc_size, params);
 
             uint64_t docsize_roundup = tlx::round_up(files.size(), 8);
 
@@ -290,6 +415,8 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
             classic_params.term_size = params.term_size;
             classic_params.canonicalize = params.canonicalize;
             classic_params.num_hashes = params.num_hashes;
+            classic_params.block_rows = params.block_rows;
+            classic_params.hash_scheme = params.hash_scheme;
             classic_params.false_positive_rate = params.false_positive_rate;
             classic_params.signature_size = signature_size;
             classic_params.mem_bytes = params.mem_bytes / num_threads;
@@ -299,6 +426,9 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
                 = "[" + pad_index(batch_num, 2)
                   + "/" + pad_index(num_pages, 2) + "] ";
             classic_params.keep_temporary = params.keep_temporary;
+            classic_params.dedup = params.dedup;
+            classic_params.min_count = params.min_count;
+            classic_params.distinct = params.distinct;
 
             LOG1 << "Classic Sub-Index Parameters: "
                  << classic_params.log_prefix << '\n'
@@ -339,6 +469,491 @@ void compact_construct(DocumentList doc_list, const fs::path& index_file,
     }
 }
 
+/******************************************************************************/
+// Merge compact indices
+
+void compact_merge(const std::vector<fs::path>& in_files,
+                   const fs::path& out_file, uint64_t memory) {
+    die_unless(!in_files.empty());
+
+    struct Input {
+        std::ifstream ifs;
+        CompactIndexHeader header;
+        Tombstones tombstones;
+        //! file offset of each page
+        std::vector<uint64_t> page_pos;
+    };
+    std::vector<Input> inputs(in_files.size());
+    // num_hashes of the first page, all pages must match it
+    uint64_t num_hashes = 0;
+
+    for (size_t f = 0; f < in_files.size(); ++f) {
+        Input& in = inputs[f];
+        in.header = deserialize_header<CompactIndexHeader>(in.ifs, in_files[f]);
+        in.tombstones.load(in_files[f], in.header.num_documents());
+
+        const CompactIndexHeader& h = in.header;
+        die_unequal(h.term_size_, inputs[0].header.term_size_);
+        die_unequal(h.canonicalize_, inputs[0].header.canonicalize_);
+        die_unequal(h.page_size_, inputs[0].header.page_size_);
+        die_unequal(h.block_rows_, inputs[0].header.block_rows_);
+        die_unless(h.hash_scheme_ == inputs[0].header.hash_scheme_);
+
+        StreamPos sp = get_stream_pos(in.ifs);
+        uint64_t pos = sp.curr_pos;
+        for (const auto& p : h.parameters_) {
+            if (num_hashes == 0)
+                num_hashes = p.num_hashes;
+            die_unequal(p.num_hashes, num_hashes);
+            in.page_pos.push_back(pos);
+            pos += h.page_size_ * p.signature_size;
+        }
+        die_unequal(pos, sp.end_pos);
+    }
+
+    uint64_t page_size = inputs[0].header.page_size_;
+    uint64_t page_docs = 8 * page_size;
+
+    //! a page of an input placed into an output page
+    struct Part {
+        size_t file;
+        uint64_t page, num_docs;
+    };
+    struct OutPage {
+        CompactIndexHeader::parameter param;
+        std::vector<Part> parts;
+        uint64_t num_docs;
+    };
+
+    // full pages are copied unchanged, partial pages are repacked if they
+    // share the signature parameters and fit into one page.
+    std::vector<OutPage> out_pages, partial_pages;
+    for (size_t f = 0; f < inputs.size(); ++f) {
+        const CompactIndexHeader& h = inputs[f].header;
+        for (uint64_t p = 0; p < h.parameters_.size(); ++p) {
+            uint64_t num_docs =
+                std::min(page_docs, h.num_documents() - p * page_docs);
+            Part part { f, p, num_docs };
+            const auto& param = h.parameters_[p];
+            if (num_docs == page_docs) {
+                out_pages.push_back(OutPage { param, { part }, num_docs });
+                continue;
+            }
+            auto it = std::find_if(
+                partial_pages.begin(), partial_pages.end(),
+                [&](const OutPage& o) {
+                    return o.param.signature_size == param.signature_size &&
+                    o.param.num_hashes == param.num_hashes &&
+                    o.num_docs + num_docs <= page_docs;
+                });
+            if (it != partial_pages.end()) {
+                it->parts.push_back(part);
+                it->num_docs += num_docs;
+            }
+            else {
+                partial_pages.push_back(OutPage { param, { part }, num_docs });
+            }
+        }
+    }
+    // place the fullest partial pages first, all but the last are padded
+    std::stable_sort(partial_pages.begin(), partial_pages.end(),
+                     [](const OutPage& a, const OutPage& b) {
+                         return a.num_docs > b.num_docs;
+                     });
+    out_pages.insert(out_pages.end(),
+                     partial_pages.begin(), partial_pages.end());
+
+    // document names and tombstones in the order of the output pages
+    CompactIndexHeader h(page_size);
+    h.term_size_ = inputs[0].header.term_size_;
+    h.canonicalize_ = inputs[0].header.canonicalize_;
+    h.block_rows_ = inputs[0].header.block_rows_;
+    h.hash_scheme_ = inputs[0].header.hash_scheme_;
+    std::vector<uint8_t> deleted;
+    for (size_t k = 0; k < out_pages.size(); ++k) {
+        const OutPage& o = out_pages[k];
+        h.parameters_.push_back(o.param);
+        for (const Part& part : o.parts) {
+            const Input& in = inputs[part.file];
+            for (uint64_t i = 0; i < part.num_docs; ++i) {
+                uint64_t d = part.page * page_docs + i;
+                h.file_names_.push_back(in.header.file_names_[d]);
+                deleted.push_back(in.tombstones.deleted(d));
+            }
+        }
+        if (k + 1 == out_pages.size())
+            break;
+        h.file_names_.resize(h.file_names_.size() + page_docs - o.num_docs);
+        deleted.resize(h.file_names_.size(), 1);
+    }
+
+    Tombstones tombstones(deleted.size());
+    for (uint64_t i = 0; i < deleted.size(); ++i) {
+        if (deleted[i])
+            tombstones.set_deleted(i);
+    }
+
+    LOG1 << "compact_merge()"
+         << " inputs=" << in_files.size()
+         << " pages=" << out_pages.size()
+         << " partial_pages=" << partial_pages.size()
+         << " documents=" << h.file_names_.size()
+         << " deleted=" << tombstones.count();
+
+    Timer t;
+
+    // write to a temporary file, such that an input may be replaced
+    fs::path tmp_file = out_file.string() + ".tmp";
+    std::ofstream ofs;
+    serialize_header(ofs, tmp_file, h);
+
+    uint64_t batch_size = std::max<uint64_t>(1, memory / 2 / page_size);
+    std::vector<uint8_t> in_block, out_block;
+    for (const OutPage& o : out_pages) {
+        uint64_t signature_size = o.param.signature_size;
+        for (uint64_t row = 0; row < signature_size; row += batch_size) {
+            uint64_t this_batch = std::min(batch_size, signature_size - row);
+            in_block.resize(this_batch * page_size);
+            out_block.assign(this_batch * page_size, 0);
+
+            uint64_t out_pos = 0;
+            for (const Part& part : o.parts) {
+                Input& in = inputs[part.file];
+                t.active("read");
+                in.ifs.seekg(in.page_pos[part.page] + row * page_size);
+                in.ifs.read(reinterpret_cast<char*>(in_block.data()),
+                            this_batch * page_size);
+
+                t.active("repack");
+                if (o.parts.size() == 1) {
+                    // whole page, the padding columns are zero
+                    out_block.swap(in_block);
+                    break;
+                }
+                for (uint64_t k = 0; k < this_batch; ++k) {
+                    copy_bits(in_block.data() + k * page_size, 0,
+                              out_block.data() + k * page_size, out_pos,
+                              part.num_docs);
+                }
+                out_pos += part.num_docs;
+            }
+
+            t.active("write");
+            ofs.write(reinterpret_cast<const char*>(out_block.data()),
+                      this_batch * page_size);
+        }
+    }
+    ofs.close();
+    inputs.clear();
+    t.stop();
+
+    fs::rename(tmp_file, out_file);
+    if (tombstones.count() != 0)
+        tombstones.save(out_file);
+    else
+        fs::remove(Tombstones::sidecar_path(out_file));
+
+    t.print("compact_merge()");
+}
+
+/******************************************************************************/
+// Conversion of classic index by folding
+
+//! estimate the number of distinct terms inserted into a Bloom filter of
+//! signature_size cells with num_ones bits set.
+static inline
+uint64_t estimate_num_terms(uint64_t signature_size, uint64_t num_hashes,
+                            uint64_t num_ones) {
+    if (num_ones >= signature_size)
+        return std::numeric_limits<uint64_t>::max();
+    double s = static_cast<double>(signature_size);
+    double x = static_cast<double>(num_ones);
+    return static_cast<uint64_t>(std::ceil(
+        -s / static_cast<double>(num_hashes) * std::log1p(-x / s)));
+}
+
+//! sorted list of divisors of n
+static inline
+std::vector<uint64_t> divisors(uint64_t n) {
+    std::vector<uint64_t> small, large;
+    for (uint64_t d = 1; d * d <= n; ++d) {
+        if (n % d != 0) continue;
+        small.push_back(d);
+        if (d * d != n)
+            large.push_back(n / d);
+    }
+    small.insert(small.end(), large.rbegin(), large.rend());
+    return small;
+}
+
+void classic_to_compact(const fs::path& in_file, const fs::path& out_file,
+                        CompactIndexParameters params) {
+    if (!tlx::ends_with(out_file.string(), CompactIndexHeader::file_extension)) {
+        die("Error: compact COBS index file must end with "
+            << CompactIndexHeader::file_extension);
+    }
+    if (fs::exists(out_file)) {
+        if (params.clobber)
+            fs::remove_all(out_file);
+        else
+            die("Output file exists, will not overwrite without --clobber");
+    }
+
+    std::ifstream ifs;
+    ClassicIndexHeader in_header =
+        deserialize_header<ClassicIndexHeader>(ifs, in_file);
+    Tombstones in_tombstones;
+    in_tombstones.load(in_file, in_header.row_bits());
+
+    uint64_t num_documents = in_header.row_bits();
+    uint64_t row_size = in_header.row_size();
+    uint64_t signature_size = in_header.signature_size_;
+    uint64_t num_hashes = in_header.num_hashes_;
+    uint64_t data_pos = ifs.tellg();
+
+    if (params.page_size == 0) {
+        params.page_size = tlx::round_up_to_power_of_two(
+            static_cast<uint64_t>(std::sqrt(num_documents / 8)));
+        params.page_size = std::max<uint64_t>(params.page_size, 8);
+        params.page_size = std::min<uint64_t>(params.page_size, 4096);
+    }
+    uint64_t page_size = params.page_size;
+    uint64_t page_docs = 8 * page_size;
+    uint64_t num_pages = tlx::div_ceil(num_documents, page_docs);
+
+    Timer t;
+
+    // count the set bits of each column in one pass over the rows
+    uint64_t batch_size =
+        std::max<uint64_t>(1, params.mem_bytes / 2 / std::max<uint64_t>(row_size, 1));
+    batch_size = std::min(batch_size, signature_size);
+    std::vector<uint8_t> rows(batch_size * row_size);
+    std::vector<uint64_t> popcount(num_documents);
+    for (uint64_t r = 0; r < signature_size; r += batch_size) {
+        uint64_t this_batch = std::min(batch_size, signature_size - r);
+        t.active("read");
+        ifs.read(reinterpret_cast<char*>(rows.data()), this_batch * row_size);
+        t.active("popcount");
+        for (uint64_t k = 0; k < this_batch; ++k) {
+            const uint8_t* row = rows.data() + k * row_size;
+            for (uint64_t d = 0; d < num_documents; ++d)
+                popcount[d] += (row[d / 8] >> (d % 8)) & 1;
+        }
+    }
+    t.stop();
+
+    // sort documents by popcount, as compact_construct() sorts by size
+    std::vector<uint64_t> order(num_documents);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint64_t a, uint64_t b) {
+                         return popcount[a] < popcount[b];
+                     });
+
+    // fold each page to the smallest divisor admitting its largest document,
+    // blocked filters can only be folded to multiples of the block size.
+    std::vector<uint64_t> sizes = divisors(signature_size);
+    uint64_t block_rows = std::max<uint64_t>(in_header.block_rows_, 1);
+    sizes.erase(std::remove_if(sizes.begin(), sizes.end(),
+                               [&](uint64_t d) { return d % block_rows != 0; }),
+                sizes.end());
+    CompactIndexHeader h(page_size);
+    h.term_size_ = in_header.term_size_;
+    h.canonicalize_ = in_header.canonicalize_;
+    h.block_rows_ = in_header.block_rows_;
+    h.hash_scheme_ = in_header.hash_scheme_;
+    for (uint64_t p = 0; p < num_pages; ++p) {
+        uint64_t last = std::min((p + 1) * page_docs, num_documents) - 1;
+        uint64_t num_terms = estimate_num_terms(
+            signature_size, num_hashes, popcount[order[last]]);
+        uint64_t needed = signature_size;
+        if (num_terms != std::numeric_limits<uint64_t>::max()) {
+            needed = calc_signature_size(
+                num_terms, num_hashes, params.false_positive_rate);
+        }
+        uint64_t folded = *std::lower_bound(
+            sizes.begin(), sizes.end(), std::min(needed, signature_size));
+        h.parameters_.push_back({ folded, num_hashes });
+    }
+    Tombstones tombstones(num_documents);
+    for (uint64_t i = 0; i < num_documents; ++i) {
+        h.file_names_.push_back(in_header.file_names_[order[i]]);
+        if (in_tombstones.deleted(order[i]))
+            tombstones.set_deleted(i);
+    }
+
+    std::ofstream ofs;
+    serialize_header(ofs, out_file, h);
+
+    // fold groups of pages whose output fits into half of the memory, each
+    // group requires one pass over the rows.
+    uint64_t out_size = 0;
+    for (uint64_t group_begin = 0; group_begin < num_pages; ) {
+        uint64_t group_end = group_begin, group_size = 0;
+        std::vector<uint64_t> page_offset;
+        while (group_end < num_pages &&
+               (group_end == group_begin ||
+                group_size + h.parameters_[group_end].signature_size * page_size
+                <= params.mem_bytes / 2)) {
+            page_offset.push_back(group_size);
+            group_size += h.parameters_[group_end].signature_size * page_size;
+            ++group_end;
+        }
+        std::vector<uint8_t> out(group_size);
+
+        ifs.seekg(data_pos);
+        for (uint64_t r = 0; r < signature_size; r += batch_size) {
+            uint64_t this_batch = std::min(batch_size, signature_size - r);
+            t.active("read");
+            ifs.read(reinterpret_cast<char*>(rows.data()),
+                     this_batch * row_size);
+            t.active("fold");
+            for (uint64_t k = 0; k < this_batch; ++k) {
+                const uint8_t* row = rows.data() + k * row_size;
+                for (uint64_t p = group_begin; p < group_end; ++p) {
+                    uint8_t* page = out.data() + page_offset[p - group_begin]
+                                    + (r + k) % h.parameters_[p].signature_size
+                                    * page_size;
+                    uint64_t end = std::min((p + 1) * page_docs, num_documents);
+                    for (uint64_t i = p * page_docs; i < end; ++i) {
+                        uint64_t d = order[i], c = i - p * page_docs;
+                        page[c / 8] |= ((row[d / 8] >> (d % 8)) & 1) << (c % 8);
+                    }
+                }
+            }
+        }
+
+        t.active("write");
+        ofs.write(reinterpret_cast<const char*>(out.data()), out.size());
+        t.stop();
+        out_size += group_size;
+        group_begin = group_end;
+    }
+    ofs.close();
+
+    if (tombstones.count() != 0)
+        tombstones.save(out_file);
+    else
+        fs::remove(Tombstones::sidecar_path(out_file));
+
+    LOG1 << "classic_to_compact()"
+         << " documents=" << num_documents
+         << " pages=" << num_pages
+         << " page_size=" << page_size
+         << " classic=" << tlx::format_iec_units(signature_size * row_size)
+         << "B compact=" << tlx::format_iec_units(out_size) << 'B';
+
+    t.print("classic_to_compact()");
+}
+
+/******************************************************************************/
+// Split compact index into shards
+
+std::vector<fs::path> compact_split(
+    const fs::path& in_file, const fs::path& out_dir, uint64_t num_shards,
+    uint64_t memory) {
+    std::ifstream ifs;
+    CompactIndexHeader in_header =
+        deserialize_header<CompactIndexHeader>(ifs, in_file);
+    Tombstones in_tombstones;
+    in_tombstones.load(in_file, in_header.num_documents());
+
+    uint64_t page_size = in_header.page_size_;
+    uint64_t page_docs = 8 * page_size;
+    uint64_t num_pages = in_header.parameters_.size();
+    num_shards = std::max<uint64_t>(1, std::min(num_shards, num_pages));
+
+    // page p begins at byte page_bytes[p] of the data section
+    std::vector<uint64_t> page_bytes(num_pages + 1);
+    for (uint64_t p = 0; p < num_pages; ++p) {
+        page_bytes[p + 1] =
+            page_bytes[p] + page_size * in_header.parameters_[p].signature_size;
+    }
+
+    // cut the page list where the byte count passes multiples of the average
+    std::vector<uint64_t> bounds = { 0 };
+    for (uint64_t s = 1; s < num_shards; ++s) {
+        uint64_t target = page_bytes[num_pages] * s / num_shards;
+        uint64_t p = std::upper_bound(
+            page_bytes.begin(), page_bytes.end(), target) - page_bytes.begin();
+        // leave at least one page for this and each later shard
+        p = std::max(p, bounds.back() + 1);
+        p = std::min(p, num_pages - (num_shards - s));
+        bounds.push_back(p);
+    }
+    bounds.push_back(num_pages);
+
+    LOG1 << "compact_split()"
+         << " pages=" << num_pages
+         << " shards=" << num_shards
+         << " size=" << tlx::format_iec_units(page_bytes[num_pages]) << 'B';
+
+    Timer t;
+    fs::create_directories(out_dir);
+    uint64_t data_pos = ifs.tellg();
+    std::vector<char> buffer(
+        std::max<uint64_t>(page_size, std::min<uint64_t>(
+                               memory, page_bytes[num_pages])));
+
+    std::vector<fs::path> shard_files;
+    for (uint64_t s = 0; s < num_shards; ++s) {
+        uint64_t doc_begin = bounds[s] * page_docs;
+        uint64_t doc_end =
+            std::min(bounds[s + 1] * page_docs, in_header.num_documents());
+
+        CompactIndexHeader h(page_size);
+        h.term_size_ = in_header.term_size_;
+        h.canonicalize_ = in_header.canonicalize_;
+        h.block_rows_ = in_header.block_rows_;
+        h.hash_scheme_ = in_header.hash_scheme_;
+        h.parameters_.assign(in_header.parameters_.begin() + bounds[s],
+                             in_header.parameters_.begin() + bounds[s + 1]);
+        h.file_names_.assign(in_header.file_names_.begin() + doc_begin,
+                             in_header.file_names_.begin() + doc_end);
+
+        fs::path shard_file =
+            out_dir / (in_file.stem().string() + "_" + pad_index(s)
+                       + CompactIndexHeader::file_extension);
+        shard_files.push_back(shard_file);
+
+        std::ofstream ofs;
+        serialize_header(ofs, shard_file, h);
+
+        // the pages of a shard are contiguous in the input
+        uint64_t pos = page_bytes[bounds[s]];
+        uint64_t end = page_bytes[bounds[s + 1]];
+        ifs.seekg(data_pos + pos);
+        while (pos < end) {
+            uint64_t size = std::min<uint64_t>(buffer.size(), end - pos);
+            t.active("read");
+            ifs.read(buffer.data(), size);
+            t.active("write");
+            ofs.write(buffer.data(), size);
+            pos += size;
+        }
+        ofs.close();
+        t.stop();
+
+        Tombstones tombstones(doc_end - doc_begin);
+        for (uint64_t i = doc_begin; i < doc_end; ++i) {
+            if (in_tombstones.deleted(i))
+                tombstones.set_deleted(i - doc_begin);
+        }
+        if (tombstones.count() != 0)
+            tombstones.save(shard_file);
+        else
+            fs::remove(Tombstones::sidecar_path(shard_file));
+
+        LOG1 << "shard " << s << ": pages [" << bounds[s] << ','
+             << bounds[s + 1] << ") documents " << h.file_names_.size()
+             << ' ' << tlx::format_iec_units(end - page_bytes[bounds[s]])
+             << "B : " << shard_file;
+    }
+
+    t.print("compact_split()");
+    return shard_files;
+}
+
 } // namespace cobs
 
 /******************************************************************************/
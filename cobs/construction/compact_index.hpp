@@ -28,6 +28,11 @@ struct CompactIndexParameters {
     uint8_t canonicalize = 1;
     //! number of hash functions, provided by user
     unsigned num_hashes = 1;
+    //! number of consecutive rows holding all probes of one term (blocked
+    //! Bloom filter), or zero for independent probes.
+    uint64_t block_rows = 0;
+    //! hash functions mapping terms to rows
+    HashScheme hash_scheme = HashScheme::XXH64;
     //! false positive rate, provided by user
     double false_positive_rate = 0.3;
     //! page or block size of filters with common fpr
@@ -36,6 +41,22 @@ struct CompactIndexParameters {
     uint64_t mem_bytes = get_memory_size(80);
     //! number of threads to use
     unsigned num_threads = gopt_threads;
+    //! skip repeated canonical k-mers of a document before hashing them, only
+    //! for term_size <= 32.
+    bool dedup = false;
+    //! index only k-mers of FASTQ documents occurring at least this many times
+    //! (solid k-mers). One indexes all k-mers.
+    unsigned min_count = 1;
+    //! size signatures by the estimated number of distinct k-mers of the
+    //! documents instead of their number of k-mer positions.
+    bool distinct = false;
+    //! order documents into pages by partition_pages() such that the index
+    //! size is minimal, and choose page_size by choose_page_size() if it is
+    //! zero.
+    bool optimize_pages = false;
+    //! relative index size above the minimum which choose_page_size() accepts
+    //! for fewer page accesses per query.
+    double page_size_overhead = 0.05;
     //! clobber erase output directory if it exists, default: false
     bool clobber = false;
     //! continue in existing output directory, default: false
@@ -52,12 +73,80 @@ void compact_construct(
     DocumentList doc_list, const fs::path& index_dir,
     fs::path tmp_path, CompactIndexParameters index_params);
 
+/*!
+ * Orders documents with the given numbers of indexed terms into pages of
+ * 8 * page_size documents such that the total index size, the sum of
+ * page_size * signature_size of all pages, is minimal. The signature size of a
+ * page is set by its largest document, all pages but the last are full, and a
+ * page costs the same however many documents it holds. Hence the optimum sorts
+ * the documents, puts the smallest ones into the partial last page, and fills
+ * the full pages in sorted order with the others. Returns the document indices
+ * in page order.
+ */
+std::vector<uint64_t> partition_pages(const std::vector<uint64_t>& doc_terms,
+                                      uint64_t page_size);
+
+//! calculate the size of a compact index of documents with the given numbers
+//! of indexed terms in page order.
+uint64_t compact_index_size(const std::vector<uint64_t>& doc_terms,
+                            uint64_t page_size,
+                            const CompactIndexParameters& params);
+
+/*!
+ * Chooses the page size of a compact index from a query cost model. Each hash
+ * of a query term reads a row of page_size bytes from every page, and each
+ * random access transfers at least one system page, hence a lookup costs
+ * num_pages * max(page_size, system page size) bytes. Among the powers of two
+ * from 8 to 4096, the page size with least lookup cost is chosen whose
+ * optimally partitioned index is at most params.page_size_overhead larger than
+ * the smallest one.
+ */
+uint64_t choose_page_size(const std::vector<uint64_t>& doc_terms,
+                          const CompactIndexParameters& params);
+
 void compact_combine_into_compact(
     const fs::path& in_dir, const fs::path& out_file,
     uint64_t page_size = get_page_size(),
     uint64_t memory = get_memory_size(80),
     bool keep_temporary = false);
 
+/*!
+ * Merges compact indices with equal term_size, canonicalize and page_size into
+ * one compact index without reconstructing it. The full pages of all inputs
+ * are copied unchanged. Partial last pages with equal signature parameters are
+ * repacked into one page where they fit, and partial pages which cannot end
+ * the merged index are padded with empty documents that are marked as deleted
+ * in the tombstone sidecar of out_file. Tombstones of the inputs are carried
+ * over. out_file may be one of the inputs.
+ */
+void compact_merge(const std::vector<fs::path>& in_files,
+                   const fs::path& out_file,
+                   uint64_t memory = get_memory_size(80));
+
+/*!
+ * Converts a classic index into a compact index without reading the documents
+ * again. A column of a classic index is a Bloom filter of signature_size bits,
+ * which can be folded to any divisor of signature_size by OR-ing the rows with
+ * equal remainder, since (h % s) % d = h % d. The number of terms of each
+ * document is estimated from the popcount of its column, the documents are
+ * sorted by it and grouped into pages, and each page is folded to the
+ * smallest divisor which keeps the false positive rate of params. Only
+ * page_size, false_positive_rate, mem_bytes and clobber of params are used.
+ */
+void classic_to_compact(const fs::path& in_file, const fs::path& out_file,
+                        CompactIndexParameters params);
+
+/*!
+ * Splits a compact index into num_shards compact indices along page
+ * boundaries, each holding a contiguous range of pages of about equal size in
+ * bytes. Each shard is a self-contained index, the shards can be queried
+ * together as multiple index files with the same results as the input. The
+ * shards are written to out_dir and their paths are returned.
+ */
+std::vector<fs::path> compact_split(
+    const fs::path& in_file, const fs::path& out_dir, uint64_t num_shards,
+    uint64_t memory = get_memory_size(80));
+
 } // namespace cobs
 
 #endif // !COBS_CONSTRUCTION_COMPACT_INDEX_HEADER
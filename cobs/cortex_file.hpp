@@ -105,7 +105,7 @@ public:
     template <typename Callback>
     void process_terms(uint64_t term_size, Callback callback) {
         std::string kmer(kmer_size_, 0);
-        static const uint64_t kmer_packed_size = (kmer_size_ + 3) / 4;
+        const uint64_t kmer_packed_size = (kmer_size_ + 3) / 4;
 
         // bytes per k-mer from 64-bit words per k-mer (<W>)
         uint64_t bytes_per_kmer = sizeof(uint64_t) * num_words_per_kmer_;
@@ -127,19 +127,7 @@ public:
             // skip color information
             is_.ignore(5 * num_colors_);
 
-            // from KMer::to_string()
-            kmer.clear();
-            for (uint64_t i = 0; i < kmer_packed_size; ++i) {
-                if (TLX_UNLIKELY(i == 0 && kmer_size_ % 4 != 0)) {
-                    // fragment of last k-mer
-                    kmer += kmer_byte_to_base_pairs[
-                        kmer_data[kmer_packed_size - 1 - i]] + (4 - kmer_size_ % 4);
-                }
-                else {
-                    kmer += kmer_byte_to_base_pairs[
-                        kmer_data[kmer_packed_size - 1 - i]];
-                }
-            }
+            kmer_unpack(kmer_data.data(), kmer_size_, &kmer[0]);
 
             for (uint64_t i = 0; i + term_size <= kmer_size_; ++i) {
                 callback(tlx::string_view(kmer.data() + i, term_size));
@@ -147,6 +135,46 @@ public:
         }
     }
 
+    //! process the forward 2-bit words of all terms with term_size <= 32,
+    //! extracted from the packed k-mers without unpacking them to text. The
+    //! words have the layout of RollingCanonicalKMer::word().
+    template <typename Callback>
+    void process_words(uint64_t term_size, Callback callback) {
+        die_unless(term_size != 0 && term_size <= 32);
+        const uint64_t kmer_packed_size = (kmer_size_ + 3) / 4;
+        const uint64_t mask = term_size >= 32 ? ~uint64_t(0)
+                              : (uint64_t(1) << (2 * term_size)) - 1;
+
+        uint64_t bytes_per_kmer = sizeof(uint64_t) * num_words_per_kmer_;
+        die_unless(bytes_per_kmer >= kmer_packed_size);
+
+        std::vector<uint8_t> kmer_data(bytes_per_kmer);
+
+        is_.clear();
+        is_.seekg(pos_data_begin_);
+
+        uint64_t r = num_kmers();
+        while (r != 0) {
+            --r;
+            if (!is_.good())
+                die("corrupted .ctx file");
+
+            is_.read(reinterpret_cast<char*>(kmer_data.data()), bytes_per_kmer);
+            is_.ignore(5 * num_colors_);
+
+            // roll over the bases from the first, which is in the high bits
+            // of the last byte, and emit each complete term
+            uint64_t word = 0;
+            for (uint64_t j = 0; j < kmer_size_; ++j) {
+                uint64_t p = kmer_size_ - 1 - j;
+                uint64_t base = (kmer_data[p / 4] >> (2 * (p % 4))) & 3;
+                word = ((word << 2) | base) & mask;
+                if (j + 1 >= term_size)
+                    callback(word);
+            }
+        }
+    }
+
     //! version number
     uint32_t version_;
     //! kmer size (<kmer_size>)
@@ -17,7 +17,10 @@
 #include <cobs/text_file.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
+#include <cobs/util/hyperloglog.hpp>
 #include <cobs/util/parallel_for.hpp>
+#include <cobs/util/rolling_kmer.hpp>
+#include <cobs/util/serialization.hpp>
 
 #include <algorithm>
 #include <fstream>
@@ -26,6 +29,8 @@
 #include <tlx/logger.hpp>
 #include <tlx/string/ends_with.hpp>
 
+#include <xxhash.h>
+
 namespace cobs {
 
 /******************************************************************************/
@@ -110,6 +115,107 @@ struct DocumentEntry {
         }
     }
 
+    //! true if only k-mers occurring at least min_count times are indexed,
+    //! which is done for FASTQ read sets.
+    bool filters_min_count(unsigned min_count) const {
+        return min_count > 1 && type_ == FileType::Fastq;
+    }
+
+    //! calculate number of terms in file which are indexed with min_count,
+    //! the distinct solid k-mers if filtered by filters_min_count(). If
+    //! distinct is set, repeated terms are counted once using
+    //! num_distinct_terms(). sketch_bytes limits the memory of the counts.
+    uint64_t num_indexed_terms(
+        uint64_t k, unsigned min_count, bool distinct, uint8_t canonicalize,
+        uint64_t sketch_bytes = KMerCountSketch::default_max_bytes) const {
+        if (filters_min_count(min_count)) {
+            FastqFile fastq(path_);
+            return fastq.num_solid_terms(k, min_count, sketch_bytes);
+        }
+        if (distinct)
+            return num_distinct_terms(k, canonicalize);
+        return num_terms(k);
+    }
+
+    //! return path of the cache file of the distinct terms estimate
+    std::string distinct_cache_path() const {
+        return path_ + ".cobs_hll";
+    }
+
+    //! estimate the number of distinct terms, canonicalized as in the index,
+    //! using a HyperLogLog sketch. Cortex and cobs_doc documents already are
+    //! sets of k-mers. The estimates of single file documents are cached next
+    //! to them, together with the file size, k and canonicalize.
+    uint64_t num_distinct_terms(uint64_t k, uint8_t canonicalize) const {
+        if (type_ == FileType::Cortex || type_ == FileType::KMerBuffer)
+            return num_terms(k);
+
+        bool use_cache = !gopt_disable_cache && type_ != FileType::FastaMulti;
+        uint64_t file_size = fs::file_size(path_);
+        uint64_t estimate;
+        if (use_cache &&
+            read_distinct_cache(k, canonicalize, file_size, estimate))
+            return estimate;
+
+        // the sketch may slightly overestimate, but never exceed the count
+        estimate = std::min(
+            compute_distinct_terms(k, canonicalize), num_terms(k));
+
+        if (use_cache) {
+            std::string path = distinct_cache_path();
+            std::ofstream os(path + ".tmp", std::ios::out | std::ios::binary);
+            stream_put(os, file_size, k, canonicalize, estimate);
+            os.close();
+            fs::rename(path + ".tmp", path);
+        }
+        return estimate;
+    }
+
+    //! read cached estimate of num_distinct_terms(), returns false if it is
+    //! missing or was computed for other parameters or file contents.
+    bool read_distinct_cache(uint64_t k, uint8_t canonicalize,
+                             uint64_t file_size, uint64_t& estimate) const {
+        std::ifstream is(distinct_cache_path(),
+                         std::ios::in | std::ios::binary);
+        if (!is.good()) return false;
+        uint64_t cache_file_size, cache_k;
+        uint8_t cache_canonicalize;
+        stream_get(is, cache_file_size, cache_k, cache_canonicalize, estimate);
+        return is.good() && cache_file_size == file_size && cache_k == k &&
+               cache_canonicalize == canonicalize;
+    }
+
+    //! run a HyperLogLog sketch over all terms of the document
+    uint64_t compute_distinct_terms(uint64_t k, uint8_t canonicalize) const {
+        HyperLogLog hll;
+        if (canonicalize == 1 && k <= 32) {
+            // hash the 2-bit words of the canonical k-mers
+            dispatch_term_size(
+                k, [&](auto fixed_term_size) {
+                    static constexpr uint64_t K =
+                        decltype(fixed_term_size)::value;
+                    RollingCanonicalKMer<K> canonicalizer(k);
+                    process_terms(
+                        k, [&](const tlx::string_view& term) {
+                            canonicalizer.canonicalize(term.data());
+                            hll.add(HyperLogLog::hash_word(
+                                        canonicalizer.word()));
+                        });
+                });
+        }
+        else {
+            RollingCanonicalKMer<> canonicalizer(k);
+            process_terms(
+                k, [&](const tlx::string_view& term) {
+                    tlx::string_view t = term;
+                    if (canonicalize == 1)
+                        t = canonicalizer.canonicalize(term.data());
+                    hll.add(XXH64(t.data(), t.size(), 0));
+                });
+        }
+        return hll.estimate();
+    }
+
     //! process terms
     template <typename Callback>
     void process_terms(uint64_t term_size, Callback callback) const {
@@ -151,6 +257,60 @@ struct DocumentEntry {
             die("DocumentEntry: unknown file type");
         }
     }
+
+    //! true if the document stores packed k-mers, of which process_words()
+    //! yields the 2-bit words without unpacking them to text.
+    bool has_packed_terms() const {
+        return type_ == FileType::Cortex || type_ == FileType::KMerBuffer;
+    }
+
+    //! process the forward 2-bit words of all terms with term_size <= 32 of a
+    //! document with has_packed_terms(), in the order of process_terms().
+    template <typename Callback>
+    void process_words(uint64_t term_size, Callback callback) const {
+        if (type_ == FileType::Cortex) {
+            CortexFile ctx(path_);
+            ctx.process_words(term_size, callback);
+        }
+        else if (type_ == FileType::KMerBuffer) {
+            die_unequal(term_size, 31u);
+            KMerBuffer<31> doc;
+            KMerBufferHeader dh;
+            doc.deserialize(path_, dh);
+
+            for (uint64_t j = 0; j < doc.data().size(); j++)
+                callback(doc.data()[j].word());
+        }
+        else {
+            die("DocumentEntry: document type has no packed terms");
+        }
+    }
+
+    //! true if byte ranges of the document can be processed independently
+    //! using process_terms_range(), which requires an uncompressed FASTA or
+    //! FASTQ file.
+    bool splittable() const {
+        return (type_ == FileType::Fasta || type_ == FileType::Fastq) &&
+               !tlx::ends_with(path_, ".gz");
+    }
+
+    //! process terms of the byte range [begin,end) of a splittable document,
+    //! consecutive ranges produce all terms exactly once.
+    template <typename Callback>
+    void process_terms_range(uint64_t term_size, uint64_t begin, uint64_t end,
+                             Callback callback) const {
+        if (type_ == FileType::Fasta) {
+            FastaFile::process_terms_range(
+                path_, begin, end, term_size, callback);
+        }
+        else if (type_ == FileType::Fastq) {
+            FastqFile::process_terms_range(
+                path_, begin, end, term_size, callback);
+        }
+        else {
+            die("DocumentEntry: document type is not splittable");
+        }
+    }
 };
 
 /*!
@@ -222,6 +382,10 @@ public:
         else if (tlx::ends_with(spath, ".cobs_doc")) {
             return FileType::KMerBuffer;
         }
+        else if (tlx::ends_with(spath, ".mfasta.gz")) {
+            // before .fasta.gz, which is a suffix
+            return FileType::FastaMulti;
+        }
         else if (tlx::ends_with(spath, ".fa") ||
                  tlx::ends_with(spath, ".fa.gz") ||
                  tlx::ends_with(spath, ".fasta") ||
@@ -434,6 +598,15 @@ public:
                   });
     }
 
+    //! reorder documents such that the i-th is the order[i]-th before
+    void reorder(const std::vector<uint64_t>& order) {
+        DocumentEntryList list;
+        list.reserve(order.size());
+        for (uint64_t i : order)
+            list.push_back(list_.at(i));
+        list_ = std::move(list);
+    }
+
     //! process each file
     void process_each(void (*func)(const DocumentEntry&)) const {
         for (uint64_t i = 0; i < list_.size(); i++) {
@@ -16,12 +16,12 @@
 #include <cobs/settings.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
-#include <cobs/util/zip_stream.hpp>
+#include <cobs/util/line_reader.hpp>
+#include <cobs/util/parallel_gzip.hpp>
 
 #include <tlx/container/string_view.hpp>
 #include <tlx/die.hpp>
 #include <tlx/logger.hpp>
-#include <tlx/string/appendline.hpp>
 #include <tlx/string/ends_with.hpp>
 
 #include <map>
@@ -59,20 +59,19 @@ public:
         LOGC(!gopt_disable_cache)
             << "FastaFile: computing index for " << path_;
 
-        std::string line;
+        LineReader reader(is);
+        tlx::string_view line;
         uint64_t sequence_size = 0;
         sequence_count_ = 0;
         size_ = 0;
 
-        std::getline(is, line);
-        if (is.eof()) return;
-        die_unless(is.good());
+        if (!reader.next(line)) return;
 
         if (line.size() == 0 || (line[0] != '>' && line[0] != ';'))
             die("FastaFile: file does not start with > or ; - " << path_);
         size_ += line.size() + 1;
 
-        while (std::getline(is, line)) {
+        while (reader.next(line)) {
             size_ += line.size() + 1;
             if (line.size() == 0 || line[0] == '>' || line[0] == ';') {
                 // comment or empty line restart the term buffer
@@ -97,7 +96,8 @@ public:
         is_.seekg(0);
 
         if (tlx::ends_with(path_, ".gz")) {
-            zip_istream zis(is_);
+            GzipReaderScope gzip_reader;
+            ParallelGzipIstream zis(is_, gzip_threads());
             return compute_index(zis);
         }
         else {
@@ -156,31 +156,71 @@ public:
 
     template <typename Callback>
     void process_terms(std::istream& is, uint64_t term_size, Callback callback) {
-        std::string line;
-        uint64_t pos = 0;
+        // lines are collected into a term buffer, such that consecutive terms
+        // of a sequence lie in one buffer and can be canonicalized rolling.
+        LineReader reader(is);
+        TermBuffer terms(term_size);
+        tlx::string_view line;
 
-        while (tlx::appendline(is, line)) {
-            if (line.size() == pos || line[pos] == '>' || line[pos] == ';') {
+        while (reader.next(line)) {
+            if (line.size() == 0 || line[0] == '>' || line[0] == ';') {
                 // comment or empty line restart the term buffer
-                line.clear();
+                terms.finish(callback);
                 continue;
             }
+            terms.append(line.data(), line.size(), callback);
+        }
+        terms.finish(callback);
+    }
 
-            // process terms continued on next line
-            for (uint64_t i = 0; i + term_size <= line.size(); ++i) {
-                callback(tlx::string_view(line.data() + i, term_size));
-            }
-            if (line.size() > term_size - 1) {
-                std::copy(line.data() + line.size() - (term_size - 1),
-                          line.data() + line.size(),
-                          line.data());
-                line.resize(term_size - 1);
-                pos = line.size();
-            }
-            else {
-                pos = 0;
+    /*!
+     * Process the terms of all lines starting in the byte range [begin,end) of
+     * an uncompressed FASTA file. Terms starting in the range are completed
+     * using up to term_size - 1 bases after it, such that consecutive ranges
+     * produce all terms of the file exactly once.
+     */
+    template <typename Callback>
+    static void process_terms_range(
+        const std::string& path, uint64_t begin, uint64_t end,
+        uint64_t term_size, Callback callback) {
+        std::ifstream is(path, std::ios::in | std::ios::binary);
+        die_unless(is.good());
+
+        LineReader reader(is);
+        TermBuffer terms(term_size);
+        tlx::string_view line;
+
+        // skip the line continuing from before the range
+        uint64_t pos = 0;
+        if (begin != 0) {
+            is.seekg(begin - 1);
+            if (!reader.next(line)) return;
+            pos = begin + line.size();
+        }
+
+        auto is_break = [&]() {
+                            return line.size() == 0 ||
+                                   line[0] == '>' || line[0] == ';';
+                        };
+
+        while (pos < end && reader.next(line)) {
+            pos += line.size() + 1;
+            if (is_break()) {
+                // comment or empty line restart the term buffer
+                terms.finish(callback);
+                continue;
             }
+            terms.append(line.data(), line.size(), callback);
+        }
+
+        // complete the terms overlapping the end of the range
+        uint64_t rest = term_size - 1;
+        while (rest != 0 && reader.next(line) && !is_break()) {
+            size_t n = std::min<uint64_t>(rest, line.size());
+            terms.append(line.data(), n, callback);
+            rest -= n;
         }
+        terms.finish(callback);
     }
 
     template <typename Callback>
@@ -190,7 +230,8 @@ public:
         die_unless(is_.good());
 
         if (tlx::ends_with(path_, ".gz")) {
-            zip_istream zis(is_);
+            GzipReaderScope gzip_reader;
+            ParallelGzipIstream zis(is_, gzip_threads());
             return process_terms(zis, term_size, callback);
         }
         else {
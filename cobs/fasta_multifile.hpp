@@ -10,6 +10,7 @@
 #define COBS_FASTA_MULTIFILE_HEADER
 
 #include <cstring>
+#include <limits>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -17,13 +18,17 @@
 #include <cobs/settings.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
+#include <cobs/util/gzip_index.hpp>
+#include <cobs/util/line_reader.hpp>
 #include <cobs/util/serialization.hpp>
 #include <cobs/util/thread_object_array.hpp>
+#include <cobs/util/zip_stream.hpp>
 
 #include <tlx/container/lru_cache.hpp>
 #include <tlx/container/string_view.hpp>
 #include <tlx/die.hpp>
 #include <tlx/logger.hpp>
+#include <tlx/string/ends_with.hpp>
 
 namespace cobs {
 
@@ -34,33 +39,42 @@ public:
     FastaSubfile(std::string path, std::string name,
                  std::istream::pos_type pos_begin,
                  uint64_t size,
-                 const ThreadObjectArrayPtr<std::ifstream>& ifstream_array)
+                 const ThreadObjectArrayPtr<std::ifstream>& ifstream_array,
+                 const std::shared_ptr<const GzipIndex>& gzip_index = nullptr)
         : path_(path), name_(name), pos_begin_(pos_begin), size_(size),
-          ifstream_array_(ifstream_array) { }
+          ifstream_array_(ifstream_array), gzip_index_(gzip_index) { }
 
     template <typename Callback>
     void process_terms(uint64_t term_size, Callback callback) {
         auto is = ifstream_array_->get(path_);
 
         is->clear();
+        if (gzip_index_) {
+            // inflate from the access point before pos_begin_
+            GzipIndexIstream zis(*is, *gzip_index_, pos_begin());
+            return process_terms(zis, term_size, callback);
+        }
+
         is->seekg(pos_begin_);
         die_unless(is->good());
+        process_terms(*is, term_size, callback);
+    }
 
-        std::string data, line;
-
-        while (std::getline(*is, line)) {
-            if (line[0] == '>' || line[0] == ';')
+    template <typename Callback>
+    void process_terms(std::istream& is, uint64_t term_size,
+                       Callback callback) {
+        // lines are collected into a term buffer, such that consecutive terms
+        // of a sequence lie in one buffer and can be canonicalized rolling.
+        LineReader reader(is);
+        TermBuffer terms(term_size);
+        tlx::string_view line;
+
+        while (reader.next(line)) {
+            if (line.size() != 0 && (line[0] == '>' || line[0] == ';'))
                 break;
-
-            data += line;
-            if (data.empty())
-                continue;
-
-            for (uint64_t i = 0; i + term_size <= data.size(); ++i) {
-                callback(tlx::string_view(data.data() + i, term_size));
-            }
-            data.erase(0, data.size() - term_size + 1);
+            terms.append(line.data(), line.size(), callback);
         }
+        terms.finish(callback);
     }
 
     //! Returns name_
@@ -83,6 +97,8 @@ private:
     uint64_t size_;
     //! file handle thread array
     ThreadObjectArrayPtr<std::ifstream> ifstream_array_;
+    //! access points into a gzip compressed file, or nullptr
+    std::shared_ptr<const GzipIndex> gzip_index_;
 };
 
 using FastaSubfileList = std::vector<FastaSubfile>;
@@ -116,10 +132,18 @@ class FastaMultifile
 public:
     FastaMultifile(const fs::path &path, bool use_cache = true) : FastaMultifile(path.string(), use_cache) {}
     FastaMultifile(std::string path, bool use_cache = true) {
-        std::ifstream is(path);
+        std::ifstream is(path, std::ios::in | std::ios::binary);
         die_unless(is.good());
 
-        char first = is.get();
+        bool gzip = tlx::ends_with(path, ".gz");
+        char first;
+        if (gzip) {
+            zip_istream zis(is);
+            first = zis.get();
+        }
+        else {
+            first = is.get();
+        }
         if (first != '>' && first != ';')
             die("FastaMultifile: file does not start with > or ; - " << path);
 
@@ -142,54 +166,85 @@ public:
         }
     }
 
-    //! read complete FASTA file for sub-documents
+    //! read complete FASTA file for sub-documents, gzip compressed files are
+    //! indexed for random access at the same time.
     void compute_index(std::string path, std::ifstream& is) {
         LOGC(!gopt_disable_cache)
             << "FastaMultifile: computing index for " << path;
 
         is.clear();
         is.seekg(0);
+
+        if (tlx::ends_with(path, ".gz")) {
+            auto gzip_index = std::make_shared<GzipIndex>();
+            gzip_index->identify(is, fs::file_size(path));
+            is.seekg(0);
+            gzip_index_ = gzip_index;
+            GzipIndexIstream zis(is, *gzip_index);
+            return compute_index(path, zis);
+        }
+        else {
+            return compute_index(path, static_cast<std::istream&>(is));
+        }
+    }
+
+    //! read complete FASTA stream for sub-documents
+    void compute_index(std::string path, std::istream& is) {
         index_ = std::make_shared<FastaSubfileList>();
 
-        std::string line;
+        // position in the uncompressed stream after the current line
+        uint64_t pos = 0;
+        LineReader reader(is);
+        tlx::string_view line;
+        bool good = true;
+        auto getline = [&]() -> bool {
+                           if (!reader.next(line)) {
+                               line = tlx::string_view();
+                               return (good = false);
+                           }
+                           pos += line.size() + 1;
+                           return true;
+                       };
+
         // read first line
-        std::getline(is, line);
+        getline();
 
         do {
             if (line.size() == 0 || line[0] == ';') {
                 // ; comment header
-                std::getline(is, line);
+                getline();
             }
             else if (line[0] == '>') {
                 // > document header
-                std::string name = line;
-                std::istream::pos_type pos_begin = is.tellg();
+                std::string name = line.to_string();
+                uint64_t pos_begin = pos;
                 uint64_t size = 0;
 
                 if (name.size() > 16)
                     name.resize(16);
 
-                while (std::getline(is, line)) {
-                    if (line[0] == '>' || line[0] == ';')
+                while (getline()) {
+                    if (line.size() != 0 && (line[0] == '>' || line[0] == ';'))
                         break;
 
                     size += line.size();
                 }
                 index_->emplace_back(
                     FastaSubfile(path, name, pos_begin, size,
-                                 ifstream_array_));
+                                 ifstream_array_, gzip_index_));
                 // next line is already read
             }
             else if (line[0] == '\r') {
                 // skip newline
-                std::getline(is, line);
+                getline();
             }
             else {
-                std::cout << "fasta: invalid line " << line << std::endl;
-                std::getline(is, line);
+                std::cout << "fasta: invalid line " << line.to_string()
+                          << std::endl;
+                getline();
             }
         }
-        while (is.good());
+        while (good);
     }
 
     //! return index cache file path
@@ -197,7 +252,7 @@ public:
         return path + ".cobs_cache";
     }
 
-    //! write cache file
+    //! write cache file, and gzip index file for compressed files
     void write_cache_file(std::string path) {
         std::ofstream os(cache_path(path) + ".tmp");
         stream_put_pod(os, index_->size());
@@ -209,12 +264,32 @@ public:
         fs::rename(cache_path(path) + ".tmp",
                    cache_path(path));
         LOG1 << "FastaMultifile: saved index as " << cache_path(path);
+
+        if (gzip_index_)
+            gzip_index_->write_file(path + GzipIndex::file_extension);
+    }
+
+    //! read gzip index file, or build it if it is missing or stale
+    void read_gzip_index(std::string path) {
+        auto gzip_index = std::make_shared<GzipIndex>();
+        std::ifstream is(path, std::ios::in | std::ios::binary);
+        gzip_index->identify(is, fs::file_size(path));
+        if (!gzip_index->read_file(path + GzipIndex::file_extension)) {
+            LOG1 << "FastaMultifile: computing gzip index for " << path;
+            is.seekg(0);
+            GzipIndexIstream zis(is, *gzip_index);
+            zis.ignore(std::numeric_limits<std::streamsize>::max());
+            gzip_index->write_file(path + GzipIndex::file_extension);
+        }
+        gzip_index_ = gzip_index;
     }
 
     //! read cache file
     bool read_cache_file(std::string path) {
         std::ifstream is(cache_path(path));
         if (!is.good()) return false;
+        if (tlx::ends_with(path, ".gz"))
+            read_gzip_index(path);
         uint64_t list_size;
         stream_get_pod(is, list_size);
         LOG1 << "FastaMultifile: loading index " << cache_path(path)
@@ -230,7 +305,7 @@ public:
             std::getline(is, name, '\0');
 
             index_->emplace_back(path, name, pos_begin, size,
-                                 ifstream_array_);
+                                 ifstream_array_, gzip_index_);
         }
         return is.good() && (is.get() == EOF);
     }
@@ -260,6 +335,8 @@ public:
 private:
     //! file stream array
     ThreadObjectArrayPtr<std::ifstream> ifstream_array_;
+    //! access points into a gzip compressed file, or nullptr
+    std::shared_ptr<const GzipIndex> gzip_index_;
     //! global index cache
     static FastaIndexCache cache_;
     //! file handle LRU
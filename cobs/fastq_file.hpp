@@ -16,7 +16,10 @@
 #include <cobs/settings.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
-#include <cobs/util/zip_stream.hpp>
+#include <cobs/util/kmer_count_sketch.hpp>
+#include <cobs/util/line_reader.hpp>
+#include <cobs/util/parallel_gzip.hpp>
+#include <cobs/util/rolling_kmer.hpp>
 
 #include <tlx/container/string_view.hpp>
 #include <tlx/die.hpp>
@@ -58,12 +61,13 @@ public:
         LOGC(!gopt_disable_cache)
             << "FastqFile: computing index for " << path_;
 
-        std::string line;
+        LineReader reader(is);
+        tlx::string_view line;
         sequence_count_ = 0;
         size_ = 0;
 
         uint64_t line_num = 0;
-        while (std::getline(is, line)) {
+        while (reader.next(line)) {
             size_ += line.size() + 1;
 
             if (line_num % 4 == 0) {
@@ -97,7 +101,8 @@ public:
         is_.seekg(0);
 
         if (tlx::ends_with(path_, ".gz")) {
-            zip_istream zis(is_);
+            GzipReaderScope gzip_reader;
+            ParallelGzipIstream zis(is_, gzip_threads());
             return compute_index(zis);
         }
         else {
@@ -154,12 +159,36 @@ public:
         return total;
     }
 
+    //! return number of distinct canonical q-grams occurring at least
+    //! min_count times, as estimated by KMerCountSketch using at most
+    //! sketch_bytes. Requires q <= 32.
+    uint64_t num_solid_terms(
+        uint64_t q, unsigned min_count,
+        uint64_t sketch_bytes = KMerCountSketch::default_max_bytes) {
+        die_unless(q <= 32);
+        KMerCountSketch sketch(min_count, sketch_bytes);
+        sketch.reset(num_terms(q));
+        RollingCanonicalKMer<> canonicalizer(q);
+        uint64_t count = 0;
+        process_terms(
+            q, [&](const tlx::string_view& term) {
+                canonicalizer.canonicalize(term.data());
+                // count each k-mer when its estimate reaches min_count
+                if (sketch.add(canonicalizer.word()) + 1 == min_count)
+                    ++count;
+            });
+        sketch.warn_overloaded(path_);
+        return count;
+    }
+
     template <typename Callback>
     void process_terms(std::istream& is, uint64_t term_size, Callback callback) {
-        std::string line;
+        // reads are single lines, terms are passed directly from the buffer
+        LineReader reader(is);
+        tlx::string_view line;
 
         uint64_t line_num = 0;
-        while (std::getline(is, line)) {
+        while (reader.next(line)) {
             if (line_num % 4 == 0) {
                 if (line.size() == 0 || line[0] != '@') {
                     die("FastqFile: line " << line_num <<
@@ -185,6 +214,79 @@ public:
         }
     }
 
+    /*!
+     * Process the terms of all reads whose header line starts in the byte
+     * range [begin,end) of an uncompressed FASTQ file. Since quality lines may
+     * also start with @, the first record is found by checking that the line
+     * after next starts with +.
+     */
+    template <typename Callback>
+    static void process_terms_range(
+        const std::string& path, uint64_t begin, uint64_t end,
+        uint64_t term_size, Callback callback) {
+        std::ifstream is(path, std::ios::in | std::ios::binary);
+        die_unless(is.good());
+
+        LineReader reader(is);
+        tlx::string_view line;
+
+        // skip the line continuing from before the range
+        uint64_t pos = 0;
+        if (begin != 0) {
+            is.seekg(begin - 1);
+            if (!reader.next(line)) return;
+            pos = begin + line.size();
+        }
+
+        auto process_read =
+            [&](const char* data, size_t size) {
+                for (uint64_t i = 0; i + term_size <= size; ++i) {
+                    callback(tlx::string_view(data + i, term_size));
+                }
+            };
+
+        // synchronize on a record: keep the last three lines and positions
+        std::string window[3];
+        uint64_t window_pos[3];
+        size_t num_lines = 0;
+        while (true) {
+            if (num_lines >= 3 && window[num_lines % 3].size() != 0 &&
+                window[num_lines % 3][0] == '@' &&
+                window[(num_lines + 2) % 3].size() != 0 &&
+                window[(num_lines + 2) % 3][0] == '+')
+                break;
+            if (!reader.next(line)) return;
+            window[num_lines % 3] = line.to_string();
+            window_pos[num_lines % 3] = pos;
+            pos += line.size() + 1;
+            ++num_lines;
+        }
+        if (window_pos[num_lines % 3] >= end)
+            return;
+
+        // sequence of the first record, then skip its quality line
+        const std::string& seq = window[(num_lines + 1) % 3];
+        process_read(seq.data(), seq.size());
+        if (!reader.next(line)) return;
+        pos += line.size() + 1;
+
+        uint64_t line_num = 0;
+        while (pos < end || line_num % 4 != 0) {
+            if (!reader.next(line)) return;
+            pos += line.size() + 1;
+            if (line_num % 4 == 0) {
+                if (line.size() == 0 || line[0] != '@') {
+                    die("FastqFile: line at " << pos - line.size() - 1 <<
+                        " does not start with @ - " << path);
+                }
+            }
+            else if (line_num % 4 == 1) {
+                process_read(line.data(), line.size());
+            }
+            ++line_num;
+        }
+    }
+
     template <typename Callback>
     void process_terms(uint64_t term_size, Callback callback) {
         is_.clear();
@@ -192,7 +294,8 @@ public:
         die_unless(is_.good());
 
         if (tlx::ends_with(path_, ".gz")) {
-            zip_istream zis(is_);
+            GzipReaderScope gzip_reader;
+            ParallelGzipIstream zis(is_, gzip_threads());
             return process_terms(zis, term_size, callback);
         }
         else {
@@ -12,41 +12,102 @@
 namespace cobs {
 
 const std::string ClassicIndexHeader::magic_word = "CLASSIC_INDEX";
-const uint32_t ClassicIndexHeader::version = 1;
+const uint32_t ClassicIndexHeader::version = 5;
 const std::string ClassicIndexHeader::file_extension = ".cobs_classic";
 
 uint64_t ClassicIndexHeader::row_bits() const {
-    return file_names_.size();
+    return file_names_.empty() ? num_lazy_names_ : file_names_.size();
 }
 
 uint64_t ClassicIndexHeader::row_size() const {
-    return (file_names_.size() + 7) / 8;
+    return (row_bits() + 7) / 8;
+}
+
+uint64_t ClassicIndexHeader::padding_size(uint64_t header_pos) const {
+    if (data_alignment_ <= 1)
+        return 0;
+    return (data_alignment_ -
+            ((header_pos + magic_word.size()) % data_alignment_))
+           % data_alignment_;
 }
 
 void ClassicIndexHeader::serialize(std::ostream& os) const {
-    serialize_magic_begin(os, magic_word, version);
+    std::streamsize header_pos = serialize_magic_begin(os, magic_word, version);
 
     stream_put(os, term_size_, canonicalize_,
-               (uint32_t)file_names_.size(), signature_size_, num_hashes_);
-    for (const auto& file_name : file_names_) {
-        os << file_name << std::endl;
-    }
+               (uint32_t)file_names_.size(), signature_size_, num_hashes_,
+               data_alignment_, block_rows_,
+               static_cast<uint8_t>(hash_scheme_));
+    header_pos += sizeof(term_size_) + sizeof(canonicalize_)
+                  + sizeof(uint32_t) + sizeof(signature_size_)
+                  + sizeof(num_hashes_) + sizeof(data_alignment_)
+                  + sizeof(block_rows_) + sizeof(uint8_t);
+    header_pos += DocumentNameTable::serialize(os, file_names_);
+
+    std::vector<char> padding(padding_size(header_pos));
+    os.write(padding.data(), padding.size());
 
     serialize_magic_end(os, magic_word);
 }
 
-void ClassicIndexHeader::deserialize(std::istream& is) {
+void ClassicIndexHeader::deserialize(
+    std::istream& is, bool load_file_names) {
     std::streamsize nb_of_bytes_read = 0;
-    nb_of_bytes_read += deserialize_magic_begin(is, magic_word, version);
+    uint32_t file_version;
+    nb_of_bytes_read += deserialize_magic_begin(
+        is, magic_word, 1, version, file_version);
 
     uint32_t file_names_size;
     nb_of_bytes_read += stream_get(is, term_size_, canonicalize_,
                file_names_size, signature_size_, num_hashes_);
-    file_names_.resize(file_names_size);
-    for (auto& file_name : file_names_) {
-        std::getline(is, file_name);
-        nb_of_bytes_read += file_name.size() + 1;
+    data_alignment_ = 1;
+    if (file_version >= 3) {
+        nb_of_bytes_read += stream_get(is, data_alignment_);
+        assert_throw<FileIOException>(
+            data_alignment_ != 0, "invalid data alignment");
+    }
+    block_rows_ = 0;
+    if (file_version >= 4) {
+        nb_of_bytes_read += stream_get(is, block_rows_);
+        assert_throw<FileIOException>(
+            block_rows_ <= 1 || signature_size_ % block_rows_ == 0,
+            "signature size is not a multiple of the block rows");
     }
+    hash_scheme_ = HashScheme::XXH64;
+    if (file_version >= 5) {
+        uint8_t hash_scheme;
+        nb_of_bytes_read += stream_get(is, hash_scheme);
+        assert_throw<FileIOException>(
+            valid_hash_scheme(hash_scheme), "unknown hash scheme");
+        hash_scheme_ = static_cast<HashScheme>(hash_scheme);
+    }
+    file_names_.clear();
+    name_table_pos_ = 0;
+    num_lazy_names_ = 0;
+    if (file_version == 1) {
+        // version 1: newline separated list of names
+        file_names_.resize(file_names_size);
+        for (auto& file_name : file_names_) {
+            std::getline(is, file_name);
+            nb_of_bytes_read += file_name.size() + 1;
+        }
+    }
+    else {
+        name_table_pos_ = nb_of_bytes_read;
+        if (load_file_names) {
+            nb_of_bytes_read += DocumentNameTable::deserialize(
+                is, file_names_size, file_names_);
+        }
+        else {
+            nb_of_bytes_read += DocumentNameTable::skip(is, file_names_size);
+            num_lazy_names_ = file_names_size;
+        }
+    }
+
+    // skip padding before the data section
+    std::streamsize padding = padding_size(nb_of_bytes_read);
+    is.seekg(padding, std::ios::cur);
+    nb_of_bytes_read += padding;
 
     nb_of_bytes_read += deserialize_magic_end(is, magic_word);
     header_size_ = nb_of_bytes_read;
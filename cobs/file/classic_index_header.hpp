@@ -9,7 +9,10 @@
 #ifndef COBS_FILE_CLASSIC_INDEX_HEADER_HEADER
 #define COBS_FILE_CLASSIC_INDEX_HEADER_HEADER
 
+#include <cobs/file/document_name_table.hpp>
 #include <cobs/file/header.hpp>
+#include <cobs/settings.hpp>
+#include <cobs/util/misc.hpp>
 
 namespace cobs {
 
@@ -28,9 +31,25 @@ public:
     std::vector<std::string> file_names_;
     //! header size in bytes
     std::streamsize header_size_;
+    //! position of the document name table relative to the header start, or
+    //! zero if the file has no name table (version 1).
+    uint64_t name_table_pos_ = 0;
+    //! number of documents if deserialize() did not load the file_names_.
+    uint64_t num_lazy_names_ = 0;
+    //! alignment of the bit matrix relative to the header start (version >=
+    //! 3), usually 4 KiB or 2 MiB for huge pages. Version 1/2 files have 1.
+    uint64_t data_alignment_ = gopt_data_alignment;
+    //! number of consecutive rows holding all probes of one term (blocked
+    //! Bloom filter, version >= 4), or zero for independent probes. The
+    //! signature size is a multiple of it, see block_hashes().
+    uint64_t block_rows_ = 0;
+    //! hash functions mapping terms to rows (version >= 5), older files use
+    //! XXH64.
+    HashScheme hash_scheme_ = HashScheme::XXH64;
 
 public:
     static const std::string magic_word;
+    //! version written by serialize(), versions 1 and up are readable
     static const uint32_t version;
     static const std::string file_extension;
 
@@ -41,8 +60,14 @@ public:
     //! number of bytes in a row, number of documents rounded up to bytes.
     uint64_t row_size() const;
 
+    //! padding needed after header_pos bytes to align the data section
+    uint64_t padding_size(uint64_t header_pos) const;
+
     void serialize(std::ostream& os) const;
-    void deserialize(std::istream& is);
+    //! deserialize header. If load_file_names is false and the header
+    //! contains a document name table, the names are skipped and can later be
+    //! resolved via name_table_pos_ using a DocumentNameTable.
+    void deserialize(std::istream& is, bool load_file_names = true);
 
     void write_file(std::ostream& os, const std::vector<uint8_t>& data);
     void write_file(const fs::path& p, const std::vector<uint8_t>& data);
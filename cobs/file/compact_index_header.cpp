@@ -8,17 +8,33 @@
 
 #include <cobs/file/compact_index_header.hpp>
 
+#include <algorithm>
+#include <numeric>
+
 namespace cobs {
 
 const std::string CompactIndexHeader::magic_word = "COMPACT_INDEX";
-const uint32_t CompactIndexHeader::version = 1;
+const uint32_t CompactIndexHeader::version = 6;
 const std::string CompactIndexHeader::file_extension = ".cobs_compact";
 
 CompactIndexHeader::CompactIndexHeader(uint64_t page_size)
     : page_size_(page_size) { }
 
-uint64_t CompactIndexHeader::padding_size(uint64_t curr_stream_pos) const {
-    return (page_size_ - ((curr_stream_pos + CompactIndexHeader::magic_word.size()) % page_size_)) % page_size_;
+uint64_t CompactIndexHeader::num_documents() const {
+    return file_names_.empty() ? num_lazy_names_ : file_names_.size();
+}
+
+uint64_t CompactIndexHeader::alignment(uint32_t file_version) const {
+    // versions before 6 also aligned the data to page_size_
+    if (file_version < 6)
+        return std::lcm(page_size_, data_alignment_);
+    return std::max<uint64_t>(data_alignment_, 1);
+}
+
+uint64_t CompactIndexHeader::padding_size(uint64_t curr_stream_pos,
+                                          uint32_t file_version) const {
+    uint64_t align = alignment(file_version);
+    return (align - ((curr_stream_pos + CompactIndexHeader::magic_word.size()) % align)) % align;
 }
 
 void CompactIndexHeader::serialize(std::ostream& os) const {
@@ -26,40 +42,80 @@ void CompactIndexHeader::serialize(std::ostream& os) const {
 
     stream_put(os, term_size_, canonicalize_,
                (uint32_t)parameters_.size(), (uint32_t)file_names_.size(),
-               page_size_);
+               page_size_, data_alignment_, block_rows_,
+               static_cast<uint8_t>(hash_scheme_));
     os.flush();
     for (const auto& p : parameters_) {
         cobs::stream_put(os, p.signature_size, p.num_hashes);
     }
-    for (const auto& file_name : file_names_) {
-        os << file_name << std::endl;
-    }
+    DocumentNameTable::serialize(os, file_names_);
 
-    std::vector<char> padding(padding_size(os.tellp()));
+    std::vector<char> padding(padding_size(os.tellp(), version));
     os.write(padding.data(), padding.size());
 
     serialize_magic_end(os, magic_word);
 }
 
-void CompactIndexHeader::deserialize(std::istream& is) {
-    deserialize_magic_begin(is, magic_word, version);
+void CompactIndexHeader::deserialize(
+    std::istream& is, bool load_file_names) {
+    uint32_t file_version;
+    deserialize_magic_begin(is, magic_word, 1, version, file_version);
 
     uint32_t parameters_size;
     uint32_t file_names_size;
     stream_get(is, term_size_, canonicalize_,
                parameters_size, file_names_size, page_size_);
+    assert_throw<FileIOException>(page_size_ != 0, "invalid page size");
+    data_alignment_ = 1;
+    if (file_version >= 3) {
+        stream_get(is, data_alignment_);
+        assert_throw<FileIOException>(
+            data_alignment_ != 0, "invalid data alignment");
+    }
+    block_rows_ = 0;
+    if (file_version >= 4) {
+        stream_get(is, block_rows_);
+    }
+    hash_scheme_ = HashScheme::XXH64;
+    if (file_version >= 5) {
+        uint8_t hash_scheme;
+        stream_get(is, hash_scheme);
+        assert_throw<FileIOException>(
+            valid_hash_scheme(hash_scheme), "unknown hash scheme");
+        hash_scheme_ = static_cast<HashScheme>(hash_scheme);
+    }
     parameters_.resize(parameters_size);
     for (auto& p : parameters_) {
         stream_get(is, p.signature_size, p.num_hashes);
+        assert_throw<FileIOException>(
+            block_rows_ <= 1 || p.signature_size % block_rows_ == 0,
+            "signature size is not a multiple of the block rows");
     }
 
-    file_names_.resize(file_names_size);
-    for (auto& file_name : file_names_) {
-        std::getline(is, file_name);
+    file_names_.clear();
+    name_table_pos_ = 0;
+    num_lazy_names_ = 0;
+    if (file_version == 1) {
+        // version 1: newline separated list of names
+        file_names_.resize(file_names_size);
+        for (auto& file_name : file_names_) {
+            std::getline(is, file_name);
+        }
+    }
+    else {
+        name_table_pos_ = is.tellg();
+        if (load_file_names) {
+            DocumentNameTable::deserialize(is, file_names_size, file_names_);
+        }
+        else {
+            DocumentNameTable::skip(is, file_names_size);
+            num_lazy_names_ = file_names_size;
+        }
     }
 
     StreamPos sp = get_stream_pos(is);
-    is.seekg(sp.curr_pos + padding_size(sp.curr_pos), std::ios::beg);
+    is.seekg(sp.curr_pos + padding_size(sp.curr_pos, file_version),
+             std::ios::beg);
 
     deserialize_magic_end(is, magic_word);
 }
@@ -9,7 +9,10 @@
 #ifndef COBS_FILE_COMPACT_INDEX_HEADER_HEADER
 #define COBS_FILE_COMPACT_INDEX_HEADER_HEADER
 
+#include <cobs/file/document_name_table.hpp>
 #include <cobs/file/header.hpp>
+#include <cobs/settings.hpp>
+#include <cobs/util/misc.hpp>
 
 namespace cobs {
 
@@ -31,18 +34,45 @@ public:
     std::vector<std::string> file_names_;
     //! size of each subindex in bytes
     uint64_t page_size_;
+    //! position of the document name table in the stream, or zero if the file
+    //! has no name table (version 1).
+    uint64_t name_table_pos_ = 0;
+    //! number of documents if deserialize() did not load the file_names_.
+    uint64_t num_lazy_names_ = 0;
+    //! alignment of the data section (version >= 3), usually 4 KiB or 2 MiB
+    //! for huge pages. Before version 6, the data was additionally aligned to
+    //! page_size_.
+    uint64_t data_alignment_ = gopt_data_alignment;
+    //! number of consecutive rows holding all probes of one term (blocked
+    //! Bloom filter, version >= 4), or zero for independent probes. All
+    //! signature sizes are multiples of it, see block_hashes().
+    uint64_t block_rows_ = 0;
+    //! hash functions mapping terms to rows (version >= 5), older files use
+    //! XXH64.
+    HashScheme hash_scheme_ = HashScheme::XXH64;
 
-    uint64_t padding_size(uint64_t curr_stream_pos) const;
+    //! alignment of the data section in a file of the given version:
+    //! data_alignment_, or lcm(page_size_, data_alignment_) before version 6.
+    uint64_t alignment(uint32_t file_version) const;
+    uint64_t padding_size(uint64_t curr_stream_pos,
+                          uint32_t file_version) const;
 
 public:
     static const std::string magic_word;
+    //! version written by serialize(), versions 1 and up are readable
     static const uint32_t version;
     static const std::string file_extension;
 
     explicit CompactIndexHeader(uint64_t page_size = 4096);
 
     void serialize(std::ostream& os) const;
-    void deserialize(std::istream& is);
+    //! deserialize header. If load_file_names is false and the header
+    //! contains a document name table, the names are skipped and can later be
+    //! resolved via name_table_pos_ using a DocumentNameTable.
+    void deserialize(std::istream& is, bool load_file_names = true);
+
+    //! number of documents, also if file_names_ were not loaded.
+    uint64_t num_documents() const;
 
     void read_file(std::istream& is, std::vector<std::vector<uint8_t> >& data);
     void read_file(const fs::path& p, std::vector<std::vector<uint8_t> >& data);
@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * cobs/file/document_name_table.cpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/file/document_name_table.hpp>
+#include <cobs/file/file_io_exception.hpp>
+#include <cobs/util/error_handling.hpp>
+#include <cobs/util/serialization.hpp>
+
+namespace cobs {
+
+std::streamsize DocumentNameTable::serialize(
+    std::ostream& os, const std::vector<std::string>& file_names) {
+    uint64_t names_size = 0;
+    for (const auto& file_name : file_names)
+        names_size += file_name.size() + 1;
+    stream_put(os, names_size);
+
+    uint64_t offset = 0;
+    for (const auto& file_name : file_names) {
+        stream_put(os, offset);
+        offset += file_name.size() + 1;
+    }
+    for (const auto& file_name : file_names) {
+        os.write(file_name.c_str(), file_name.size() + 1);
+    }
+    return sizeof(uint64_t) * (1 + file_names.size()) + names_size;
+}
+
+std::streamsize DocumentNameTable::deserialize(
+    std::istream& is, uint64_t num_documents,
+    std::vector<std::string>& file_names) {
+    uint64_t names_size;
+    std::streamsize nb_of_bytes_read = stream_get(is, names_size);
+
+    std::vector<uint64_t> offsets(num_documents);
+    is.read(reinterpret_cast<char*>(offsets.data()),
+            num_documents * sizeof(uint64_t));
+    nb_of_bytes_read += is.gcount();
+
+    std::vector<char> names(names_size);
+    is.read(names.data(), names_size);
+    nb_of_bytes_read += is.gcount();
+    assert_throw<FileIOException>(is.good(), "input filestream broken");
+    assert_throw<FileIOException>(
+        names_size == 0 || names.back() == 0, "invalid document name table");
+
+    file_names.resize(num_documents);
+    for (uint64_t i = 0; i < num_documents; ++i) {
+        assert_throw<FileIOException>(
+            offsets[i] < names_size, "invalid document name table");
+        file_names[i] = names.data() + offsets[i];
+    }
+    return nb_of_bytes_read;
+}
+
+std::streamsize DocumentNameTable::skip(
+    std::istream& is, uint64_t num_documents) {
+    uint64_t names_size;
+    std::streamsize nb_of_bytes_read = stream_get(is, names_size);
+    std::streamsize skip = num_documents * sizeof(uint64_t) + names_size;
+    is.seekg(skip, std::ios::cur);
+    assert_throw<FileIOException>(is.good(), "input filestream broken");
+    return nb_of_bytes_read + skip;
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * cobs/file/document_name_table.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_FILE_DOCUMENT_NAME_TABLE_HEADER
+#define COBS_FILE_DOCUMENT_NAME_TABLE_HEADER
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Offset-indexed table of document names stored in index headers since
+ * version 2. The on-disk layout is
+ *
+ *   uint64_t names_size;             // bytes in the names area
+ *   uint64_t offsets[num_documents]; // offset of name i in the names area
+ *   char names[names_size];          // '\0'-terminated document names
+ *
+ * The table can be used in place, e.g. from a memory mapping of the index
+ * file, such that a name is only touched when it is requested.
+ */
+class DocumentNameTable
+{
+public:
+    DocumentNameTable() = default;
+
+    //! attach to a name table starting at data, which is usually inside a
+    //! memory mapping. The memory must outlive the DocumentNameTable.
+    DocumentNameTable(const uint8_t* data, uint64_t num_documents)
+        : offsets_(data + sizeof(uint64_t)),
+          names_(reinterpret_cast<const char*>(
+                     offsets_ + num_documents * sizeof(uint64_t))),
+          size_(num_documents) { }
+
+    //! number of document names
+    uint64_t size() const { return size_; }
+
+    //! true if attached to a name table
+    bool valid() const { return offsets_ != nullptr; }
+
+    //! return '\0'-terminated name of document i
+    const char* operator [] (uint64_t i) const {
+        // the table need not be aligned in the file
+        uint64_t offset;
+        std::memcpy(&offset, offsets_ + i * sizeof(uint64_t), sizeof(offset));
+        return names_ + offset;
+    }
+
+    //! write name table for the given file names, returns bytes written
+    static std::streamsize serialize(
+        std::ostream& os, const std::vector<std::string>& file_names);
+
+    //! read name table with num_documents entries into file_names, returns
+    //! bytes read
+    static std::streamsize deserialize(
+        std::istream& is, uint64_t num_documents,
+        std::vector<std::string>& file_names);
+
+    //! skip over name table with num_documents entries, returns bytes skipped
+    static std::streamsize skip(std::istream& is, uint64_t num_documents);
+
+private:
+    //! pointer to the offsets array
+    const uint8_t* offsets_ = nullptr;
+    //! pointer to the names area
+    const char* names_ = nullptr;
+    //! number of documents
+    uint64_t size_ = 0;
+};
+
+} // namespace cobs
+
+#endif // !COBS_FILE_DOCUMENT_NAME_TABLE_HEADER
+
+/******************************************************************************/
@@ -30,11 +30,12 @@ std::streamsize check_magic_word(std::istream& is, const std::string& magic_word
 }
 
 static inline
-void serialize_magic_begin(
+std::streamsize serialize_magic_begin(
     std::ostream& os, const std::string& magic_word, const uint32_t& version) {
     os << "COBS:";
     os << magic_word;
     stream_put(os, version);
+    return 5 + magic_word.size() + sizeof(version);
 }
 
 static inline
@@ -55,6 +56,22 @@ std::streamsize deserialize_magic_begin(
     return nb_of_bytes_read;
 }
 
+//! read magic word and accept any version in [min_version, max_version], which
+//! is returned in version.
+static inline
+std::streamsize deserialize_magic_begin(
+    std::istream& is, const std::string& magic_word,
+    uint32_t min_version, uint32_t max_version, uint32_t& version) {
+    std::streamsize nb_of_bytes_read = 0;
+    nb_of_bytes_read += check_magic_word(is, "COBS:");
+    nb_of_bytes_read += check_magic_word(is, magic_word);
+    nb_of_bytes_read += stream_get(is, version);
+    assert_throw<FileIOException>(
+        version >= min_version && version <= max_version,
+        "invalid file version");
+    return nb_of_bytes_read;
+}
+
 static inline
 std::streamsize deserialize_magic_end(
     std::istream& is, const std::string& magic_word) {
@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * cobs/file/index_bundle_header.cpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/file/index_bundle_header.hpp>
+
+namespace cobs {
+
+const std::string IndexBundleHeader::magic_word = "INDEX_BUNDLE";
+const uint32_t IndexBundleHeader::version = 1;
+const std::string IndexBundleHeader::file_extension = ".cobs_bundle";
+
+uint64_t IndexBundleHeader::header_size(uint64_t num_members) {
+    return 5 + magic_word.size() + sizeof(version) + sizeof(uint64_t)
+           + num_members * 2 * sizeof(uint64_t) + magic_word.size();
+}
+
+void IndexBundleHeader::serialize(std::ostream& os) const {
+    serialize_magic_begin(os, magic_word, version);
+    stream_put(os, (uint64_t)members_.size());
+    for (const Member& m : members_)
+        stream_put(os, m.offset, m.size);
+    serialize_magic_end(os, magic_word);
+}
+
+void IndexBundleHeader::deserialize(std::istream& is) {
+    deserialize_magic_begin(is, magic_word, version);
+    uint64_t num_members;
+    stream_get(is, num_members);
+    members_.resize(num_members);
+    uint64_t end = header_size(num_members);
+    for (Member& m : members_) {
+        stream_get(is, m.offset, m.size);
+        assert_throw<FileIOException>(
+            m.offset >= end, "invalid index bundle directory");
+        end = m.offset + m.size;
+    }
+    deserialize_magic_end(is, magic_word);
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * cobs/file/index_bundle_header.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_FILE_INDEX_BUNDLE_HEADER_HEADER
+#define COBS_FILE_INDEX_BUNDLE_HEADER_HEADER
+
+#include <cobs/file/header.hpp>
+
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Header of an index bundle: a container of many complete classic index files
+ * which are stored verbatim after a directory table. The bundle is opened with
+ * a single memory mapping, and each member becomes an index file backed by it.
+ * Members are placed at multiples of the data alignment, such that their bit
+ * matrices keep their alignment.
+ */
+class IndexBundleHeader
+{
+public:
+    struct Member {
+        //! absolute position of the embedded index file in the bundle
+        uint64_t offset;
+        //! size of the embedded index file
+        uint64_t size;
+    };
+
+    //! directory of embedded index files
+    std::vector<Member> members_;
+
+public:
+    static const std::string magic_word;
+    static const uint32_t version;
+    static const std::string file_extension;
+
+    IndexBundleHeader() = default;
+
+    //! size of the serialized header with num_members entries
+    static uint64_t header_size(uint64_t num_members);
+
+    void serialize(std::ostream& os) const;
+    void deserialize(std::istream& is);
+};
+
+} // namespace cobs
+
+#endif // !COBS_FILE_INDEX_BUNDLE_HEADER_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * cobs/file/tombstones.cpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/file/tombstones.hpp>
+#include <cobs/util/file.hpp>
+
+#include <fstream>
+
+#include <tlx/die.hpp>
+#include <tlx/logger.hpp>
+#include <tlx/math/popcount.hpp>
+
+namespace cobs {
+
+const std::string Tombstones::magic_word = "TOMBSTONES";
+const uint32_t Tombstones::version = 2;
+const std::string Tombstones::file_extension = ".cobs_tombstones";
+
+void Tombstones::set_deleted(uint64_t i, bool deleted) {
+    die_unless(i < num_documents_);
+    if (deleted)
+        bitmap_[i / 8] |= uint8_t(1) << (i % 8);
+    else
+        bitmap_[i / 8] &= ~(uint8_t(1) << (i % 8));
+}
+
+uint64_t Tombstones::count() const {
+    return tlx::popcount(bitmap_.data(), bitmap_.size());
+}
+
+uint64_t Tombstones::index_checksum(const fs::path& index_path) {
+    std::ifstream is(index_path.string(), std::ios::in | std::ios::binary);
+    return head_tail_checksum(is, fs::file_size(index_path));
+}
+
+bool Tombstones::load(const fs::path& index_path, uint64_t num_documents) {
+    fs::path path = sidecar_path(index_path);
+    std::ifstream is(path.string(), std::ios::in | std::ios::binary);
+    if (!is.good())
+        return false;
+
+    is.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+    uint32_t file_version;
+    deserialize_magic_begin(is, magic_word, 1, version, file_version);
+    // version 1 did not record the index file, it cannot be verified
+    uint64_t index_size = 0, checksum = 0;
+    if (file_version >= 2) {
+        stream_get(is, index_size);
+        stream_get(is, checksum);
+    }
+    stream_get(is, num_documents_);
+    bitmap_.resize((num_documents_ + 7) / 8);
+    is.read(reinterpret_cast<char*>(bitmap_.data()), bitmap_.size());
+    deserialize_magic_end(is, magic_word);
+
+    if (file_version < 2 || num_documents_ != num_documents ||
+        index_size != fs::file_size(index_path) ||
+        checksum != index_checksum(index_path)) {
+        LOG1 << "Tombstones: ignoring " << path
+             << ", which does not match the index " << index_path;
+        *this = Tombstones(num_documents);
+        return false;
+    }
+    return true;
+}
+
+void Tombstones::save(const fs::path& index_path) const {
+    uint64_t index_size = fs::file_size(index_path);
+    uint64_t checksum = index_checksum(index_path);
+
+    fs::path path = sidecar_path(index_path);
+    std::string tmp_path = path.string() + ".tmp";
+    {
+        std::ofstream os(tmp_path, std::ios::out | std::ios::binary);
+        os.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+        serialize_magic_begin(os, magic_word, version);
+        stream_put(os, index_size);
+        stream_put(os, checksum);
+        stream_put(os, num_documents_);
+        os.write(reinterpret_cast<const char*>(bitmap_.data()), bitmap_.size());
+        serialize_magic_end(os, magic_word);
+    }
+    fs::rename(tmp_path, path);
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * cobs/file/tombstones.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_FILE_TOMBSTONES_HEADER
+#define COBS_FILE_TOMBSTONES_HEADER
+
+#include <cobs/file/header.hpp>
+#include <cobs/util/fs.hpp>
+
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Bitmap of deleted documents of an index, stored in a sidecar file next to
+ * the index file. Bit i of byte i / 8 marks document i, which is the same
+ * layout as the columns of the index rows. The deleted documents are masked
+ * at query time until the index is rewritten without them.
+ *
+ * The sidecar records the number of documents, the size and a checksum of the
+ * index file, such that a sidecar left behind by a rebuilt, appended or
+ * replaced index is ignored instead of deleting the wrong documents.
+ */
+class Tombstones
+{
+public:
+    static const std::string magic_word;
+    static const uint32_t version;
+    static const std::string file_extension;
+
+    explicit Tombstones(uint64_t num_documents = 0)
+        : num_documents_(num_documents),
+          bitmap_((num_documents + 7) / 8) { }
+
+    //! path of the tombstone sidecar file of an index file
+    static fs::path sidecar_path(const fs::path& index_path) {
+        return index_path.string() + file_extension;
+    }
+
+    //! number of documents covered by the bitmap
+    uint64_t num_documents() const { return num_documents_; }
+
+    //! bitmap of deleted documents
+    const std::vector<uint8_t>& bitmap() const { return bitmap_; }
+
+    //! true if document i is deleted
+    bool deleted(uint64_t i) const {
+        return i < num_documents_ && ((bitmap_[i / 8] >> (i % 8)) & 1);
+    }
+
+    //! mark document i as deleted
+    void set_deleted(uint64_t i, bool deleted = true);
+
+    //! number of deleted documents
+    uint64_t count() const;
+
+    //! load the sidecar of an index file with num_documents documents,
+    //! returns false if it does not exist or belongs to a different index,
+    //! which is logged as warning.
+    bool load(const fs::path& index_path, uint64_t num_documents);
+    //! save the sidecar of an index file, atomically replacing it.
+    void save(const fs::path& index_path) const;
+
+    //! checksum of the first and last 64 KiB of an index file
+    static uint64_t index_checksum(const fs::path& index_path);
+
+private:
+    //! number of documents
+    uint64_t num_documents_;
+    //! deletion bitmap
+    std::vector<uint8_t> bitmap_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_FILE_TOMBSTONES_HEADER
+
+/******************************************************************************/
@@ -12,25 +12,84 @@
 
 #include <array>
 #include <cassert>
+#include <cstring>
 #include <ostream>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
 
 #include <cobs/util/misc.hpp>
 #include <cobs/util/query.hpp>
+#include <cobs/util/rolling_kmer.hpp>
 
 #include <tlx/define/likely.hpp>
 
 namespace cobs {
 
+extern const char* kmer_byte_to_base_pairs[256];
+extern uint8_t kmer_mirror_pairs[256];
+
+/*!
+ * Pack kmer_size characters into the 2-bit layout of KMer: byte 0 holds the
+ * last four bases, the last byte holds the first bases padded with A in front,
+ * and each byte holds its first base in the high bits. Characters are mapped
+ * using table lookups, four bases per byte. Throws std::out_of_range for
+ * characters other than ACGT.
+ */
 static inline
-uint32_t chars_to_int(char c1, char c2, char c3, char c4) {
-    return uint32_t(0) | (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
+void kmer_pack(const char* chars, uint64_t kmer_size, uint8_t* data) {
+    const uint8_t* code = rolling_base_code;
+    const uint8_t* invalid = rolling_base_invalid;
+    const uint8_t* first = reinterpret_cast<const uint8_t*>(chars);
+    const uint8_t* c = first + kmer_size;
+    uint8_t any_invalid = 0;
+    uint64_t b = 0;
+    for ( ; b < kmer_size / 4; ++b) {
+        c -= 4;
+        data[b] = (code[c[0]] << 6) | (code[c[1]] << 4)
+                  | (code[c[2]] << 2) | code[c[3]];
+        any_invalid |= invalid[c[0]] | invalid[c[1]]
+                       | invalid[c[2]] | invalid[c[3]];
+    }
+    if (kmer_size % 4 != 0) {
+        uint8_t x = 0;
+        for (const uint8_t* p = first; p != c; ++p) {
+            x = (x << 2) | code[*p];
+            any_invalid |= invalid[*p];
+        }
+        data[b] = x;
+    }
+    if (TLX_UNLIKELY(any_invalid))
+        throw std::out_of_range("KMer: invalid base pair");
 }
 
-extern const char* kmer_byte_to_base_pairs[256];
-extern const std::unordered_map<uint64_t, uint8_t> kmer_bps_to_uint8_t;
-extern uint8_t kmer_mirror_pairs[256];
+//! Unpack a k-mer in the 2-bit layout of KMer into out[0, kmer_size), copying
+//! four characters per byte from a table.
+static inline
+void kmer_unpack(const uint8_t* data, uint64_t kmer_size, char* out) {
+    uint64_t b = (kmer_size + 3) / 4, rest = kmer_size % 4;
+    if (rest != 0) {
+        --b;
+        std::memcpy(out, kmer_byte_to_base_pairs[data[b]] + (4 - rest), rest);
+        out += rest;
+    }
+    while (b != 0) {
+        --b;
+        std::memcpy(out, kmer_byte_to_base_pairs[data[b]], 4);
+        out += 4;
+    }
+}
+
+//! Forward 2-bit word of a k-mer with kmer_size <= 32 in the layout of KMer,
+//! with the first base in the highest bits like RollingCanonicalKMer::word().
+static inline
+uint64_t kmer_word(const uint8_t* data, uint64_t kmer_size) {
+    uint64_t word = 0;
+    for (uint64_t b = (kmer_size + 3) / 4; b != 0; --b)
+        word = (word << 8) | data[b - 1];
+    if (kmer_size < 32)
+        word &= (uint64_t(1) << (2 * kmer_size)) - 1;
+    return word;
+}
 
 template <uint64_t N>
 class KMer : public std::array<uint8_t, (N + 3) / 4>
@@ -52,69 +111,33 @@ public:
     }
 
     void init(const char* chars) {
-        for (int64_t i = N - 4; i >= -3; i -= 4) {
-            if (i >= 0) {
-                data()[(N - (i + 4)) / 4] =
-                    kmer_bps_to_uint8_t.at(*((uint32_t*)(chars + i)));
-            }
-            else {
-                char c2 = i < -1 ? 'A' : chars[i + 1];
-                char c3 = i < -2 ? 'A' : chars[i + 2];
-                data()[size - 1] = kmer_bps_to_uint8_t.at(
-                    chars_to_int(chars[i + 3], c3, c2, 'A'));
-            }
-        }
+        kmer_pack(chars, N, data());
     }
 
     std::string string() const {
-        std::string result;
-        result.reserve(N);
-        for (uint64_t i = 0; i < size; ++i) {
-            if (TLX_UNLIKELY(i == 0 && N % 4 != 0)) {
-                result += kmer_byte_to_base_pairs[
-                    data()[size - 1 - i]] + (4 - N % 4);
-            }
-            else {
-                result += kmer_byte_to_base_pairs[
-                    data()[size - 1 - i]];
-            }
-        }
+        std::string result(N, 0);
+        kmer_unpack(data(), N, &result[0]);
         return result;
     }
 
     std::string& to_string(std::string* out) const {
-        out->clear();
-        for (uint64_t i = 0; i < size; ++i) {
-            if (TLX_UNLIKELY(i == 0 && N % 4 != 0)) {
-                *out += kmer_byte_to_base_pairs[
-                    data()[size - 1 - i]] + (4 - N % 4);
-            }
-            else {
-                *out += kmer_byte_to_base_pairs[
-                    data()[size - 1 - i]];
-            }
-        }
+        out->resize(N);
+        kmer_unpack(data(), N, &(*out)[0]);
         return *out;
     }
 
+    //! forward 2-bit word of the k-mer, see kmer_word()
+    uint64_t word() const {
+        static_assert(N <= 32, "2-bit words hold at most 32 bases");
+        return kmer_word(data(), N);
+    }
+
     void print(std::ostream& ostream) const {
         ostream << string();
     }
 
     static void init(const char* chars, char* kmer_data, uint32_t kmer_size) {
-        int64_t kmer_size_int = kmer_size;
-        for (int64_t i = kmer_size_int - 4; i >= -3; i -= 4) {
-            if (i >= 0) {
-                kmer_data[(kmer_size_int - (i + 4)) / 4] =
-                    kmer_bps_to_uint8_t.at(*((uint32_t*)(chars + i)));
-            }
-            else {
-                char c2 = i < -1 ? 'A' : chars[i + 1];
-                char c3 = i < -2 ? 'A' : chars[i + 2];
-                kmer_data[data_size(kmer_size) - 1] =
-                    kmer_bps_to_uint8_t.at(chars_to_int(chars[i + 3], c3, c2, 'A'));
-            }
-        }
+        kmer_pack(chars, kmer_size, reinterpret_cast<uint8_t*>(kmer_data));
     }
 
     static uint32_t data_size(uint32_t kmer_size) {
@@ -141,7 +164,7 @@ public:
     uint8_t at(uint64_t index) const {
         assert(index < N);
         // skip unused bits at the end
-        index += (4 - N % 4);
+        index += (4 - N % 4) % 4;
         return (data()[size - 1 - index / 4] >> (6 - 2 * (index % 4))) & 0x3;
     }
 
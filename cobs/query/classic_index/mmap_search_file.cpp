@@ -7,27 +7,118 @@
  ******************************************************************************/
 
 #include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/settings.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/fs.hpp>
 #include <cobs/util/query.hpp>
+
+#include <algorithm>
 #include <cstring>
 
+#include <tlx/logger.hpp>
+#include <tlx/math/round_up.hpp>
+
 namespace cobs {
 
 ClassicIndexMMapSearchFile::ClassicIndexMMapSearchFile(const fs::path& path)
-    : ClassicIndexSearchFile(path) {
-    handle_ = initialize_mmap(path);
-    data_ = handle_.data + stream_pos_.curr_pos;
+    : ClassicIndexSearchFile(path, /* lazy_names */ true) {
+    // a partitioned index is copied to the nodes from the page cache
+    plan_numa_columns();
+    handle_ = share_mmap(initialize_mmap(
+                             path, gopt_load_complete_index &&
+                             numa_columns_.empty()));
+    data_ = handle_->data + stream_pos_.curr_pos;
+    attach_name_table(handle_->data);
+    partition_numa();
 }
 
 ClassicIndexMMapSearchFile::ClassicIndexMMapSearchFile(std::ifstream &ifs, int64_t index_file_size)
     : ClassicIndexSearchFile(ifs, index_file_size) {
-    handle_ = initialize_stream(ifs, stream_pos_.size());
-    data_ = handle_.data;
+    handle_ = share_mmap(initialize_stream(ifs, stream_pos_.size()));
+    data_ = handle_->data;
 }
 
-ClassicIndexMMapSearchFile::~ClassicIndexMMapSearchFile() {
-    destroy_mmap(handle_);
+ClassicIndexMMapSearchFile::ClassicIndexMMapSearchFile(
+    const fs::path& path, const ClassicIndexHeader& header,
+    const StreamPos& stream_pos)
+    : ClassicIndexSearchFile(header, stream_pos) {
+    plan_numa_columns();
+    handle_ = share_mmap(initialize_mmap(
+                             path, gopt_load_complete_index &&
+                             numa_columns_.empty()));
+    die_unequal(handle_->size, stream_pos_.end_pos);
+    data_ = handle_->data + stream_pos_.curr_pos;
+    attach_name_table(handle_->data);
+    partition_numa();
+}
+
+ClassicIndexMMapSearchFile::ClassicIndexMMapSearchFile(
+    std::shared_ptr<MMapHandle> handle, const ClassicIndexHeader& header,
+    uint64_t offset, uint64_t size)
+    : ClassicIndexSearchFile(
+          header, StreamPos { offset + header.header_size_, offset + size }),
+      handle_(std::move(handle)) {
+    die_unless(stream_pos_.end_pos <= handle_->size);
+    die_unless(stream_pos_.curr_pos
+               + header_.signature_size_ * header_.row_size()
+               <= stream_pos_.end_pos);
+    data_ = handle_->data + stream_pos_.curr_pos;
+    // bundle members are small and share one loaded mapping, they are
+    // searched by a single thread and hence not partitioned.
+    attach_name_table(handle_->data + offset);
+}
+
+void ClassicIndexMMapSearchFile::plan_numa_columns() {
+    numa_columns_.clear();
+    if (!numa_partition_index())
+        return;
+
+    // split each row into column blocks at multiples of 16 bytes, which is
+    // the size of a score batch of ClassicSearch.
+    uint64_t row_size = header_.row_size();
+    uint64_t num_nodes = numa_num_nodes();
+    for (uint64_t n = 0; n < num_nodes; ++n) {
+        uint64_t c = std::min(tlx::round_up(row_size * n / num_nodes, 16),
+                              row_size);
+        if (numa_columns_.empty() || c != numa_columns_.back())
+            numa_columns_.push_back(c);
+    }
+    numa_columns_.push_back(row_size);
+    if (numa_columns_.size() <= 2)
+        numa_columns_.clear();
+}
+
+void ClassicIndexMMapSearchFile::partition_numa() {
+    static constexpr bool debug = false;
+
+    if (numa_columns_.empty())
+        return;
+
+    uint64_t row_size = header_.row_size();
+    uint64_t signature_size = header_.signature_size_;
+    std::vector<uint64_t> sizes;
+    for (uint64_t n = 0; n + 1 < numa_columns_.size(); ++n) {
+        sizes.push_back(
+            (numa_columns_[n + 1] - numa_columns_[n]) * signature_size);
+    }
+
+    numa_blocks_.allocate(
+        sizes, [&](unsigned node, uint8_t* block) {
+            uint64_t begin = numa_columns_[node];
+            uint64_t width = numa_columns_[node + 1] - begin;
+            for (uint64_t r = 0; r < signature_size; ++r) {
+                std::copy(data_ + r * row_size + begin,
+                          data_ + r * row_size + begin + width,
+                          block + r * width);
+            }
+        });
+
+    numa_bounds_.clear();
+    for (uint64_t c : numa_columns_)
+        numa_bounds_.push_back(8 * c);
+
+    LOG << "ClassicIndexMMapSearchFile: partitioned over "
+        << numa_blocks_.size() << " NUMA nodes at " << numa_columns_;
 }
 
 void ClassicIndexMMapSearchFile::read_from_disk(
@@ -35,6 +126,22 @@ void ClassicIndexMMapSearchFile::read_from_disk(
     uint64_t begin, uint64_t size, uint64_t buffer_size)
 {
     die_unless(begin + size <= header_.row_size());
+    if (!numa_columns_.empty()) {
+        // find column block, score batches do not cross blocks
+        uint64_t n = std::upper_bound(
+            numa_columns_.begin(), numa_columns_.end(), begin)
+                     - numa_columns_.begin() - 1;
+        uint64_t block_begin = numa_columns_[n];
+        uint64_t width = numa_columns_[n + 1] - block_begin;
+        die_unless(begin + size <= block_begin + width);
+        for (uint64_t i = 0; i < hashes.size(); i++) {
+            auto data_8 =
+                numa_blocks_[n] + (begin - block_begin)
+                + (hashes[i] % header_.signature_size_) * width;
+            std::copy(data_8, data_8 + size, rows + i * buffer_size);
+        }
+        return;
+    }
     for (uint64_t i = 0; i < hashes.size(); i++) {
         auto data_8 =
             data_ + begin
@@ -10,14 +10,25 @@
 #define COBS_QUERY_CLASSIC_INDEX_MMAP_SEARCH_FILE_HEADER
 
 #include <cobs/query/classic_index/search_file.hpp>
+#include <cobs/util/numa.hpp>
 
 namespace cobs {
 
 class ClassicIndexMMapSearchFile : public ClassicIndexSearchFile
 {
 private:
-    MMapHandle handle_;
+    //! memory mapping, which may be shared with other index files
+    std::shared_ptr<MMapHandle> handle_;
     uint8_t* data_;
+    //! column blocks of the matrix on each NUMA node, if partitioned
+    NumaBlocks numa_blocks_;
+    //! byte offsets of the column blocks in a row, plus row_size()
+    std::vector<uint64_t> numa_columns_;
+
+    //! determine column blocks if the index is partitioned across NUMA nodes
+    void plan_numa_columns();
+    //! copy the matrix into the column blocks on each NUMA node
+    void partition_numa();
 
 protected:
     void read_from_disk(const std::vector<uint64_t>& hashes, uint8_t* rows,
@@ -26,7 +37,15 @@ protected:
 public:
     explicit ClassicIndexMMapSearchFile(const fs::path& path);
     explicit ClassicIndexMMapSearchFile(std::ifstream &ifs, int64_t index_file_size);
-    ~ClassicIndexMMapSearchFile();
+    //! open index file with a cached header, e.g. from an IndexManifest
+    ClassicIndexMMapSearchFile(const fs::path& path,
+                               const ClassicIndexHeader& header,
+                               const StreamPos& stream_pos);
+    //! use an index embedded at offset in a shared memory mapping, e.g. a
+    //! member of an index bundle. The header's names need not be loaded.
+    ClassicIndexMMapSearchFile(std::shared_ptr<MMapHandle> handle,
+                               const ClassicIndexHeader& header,
+                               uint64_t offset, uint64_t size);
 };
 
 } // namespace cobs
@@ -12,9 +12,10 @@
 
 namespace cobs {
 
-ClassicIndexSearchFile::ClassicIndexSearchFile(const fs::path& path) {
+ClassicIndexSearchFile::ClassicIndexSearchFile(
+    const fs::path& path, bool lazy_names) {
     std::ifstream ifs;
-    header_ = deserialize_header<ClassicIndexHeader>(ifs, path);
+    header_ = deserialize_header<ClassicIndexHeader>(ifs, path, !lazy_names);
     stream_pos_ = get_stream_pos(ifs);
 }
 
@@ -22,7 +23,18 @@ ClassicIndexSearchFile::ClassicIndexSearchFile(std::ifstream &ifs, int64_t index
     header_ = deserialize_header<ClassicIndexHeader>(ifs);
     stream_pos_ = StreamPos { (uint64_t) header_.header_size_, (uint64_t) index_file_size};
 }
+ClassicIndexSearchFile::ClassicIndexSearchFile(
+    const ClassicIndexHeader& header, const StreamPos& stream_pos)
+    : header_(header) {
+    stream_pos_ = stream_pos;
+}
 
+void ClassicIndexSearchFile::attach_name_table(const uint8_t* header_begin) {
+    if (!header_.file_names_.empty() || header_.name_table_pos_ == 0)
+        return;
+    name_table_ = DocumentNameTable(
+        header_begin + header_.name_table_pos_, header_.num_lazy_names_);
+}
 
 uint64_t ClassicIndexSearchFile::counts_size() const {
     return 8 * header_.row_size();
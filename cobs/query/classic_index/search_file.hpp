@@ -17,23 +17,41 @@ namespace cobs {
 class ClassicIndexSearchFile : public IndexSearchFile
 {
 protected:
-    explicit ClassicIndexSearchFile(const fs::path& path);
+    //! open index file, if lazy_names is true the document names are not
+    //! loaded and must be attached via attach_name_table().
+    explicit ClassicIndexSearchFile(const fs::path& path,
+                                    bool lazy_names = false);
     explicit ClassicIndexSearchFile(std::ifstream &ifs, int64_t index_file_size);
+    //! construct from a previously read header without touching the file
+    ClassicIndexSearchFile(const ClassicIndexHeader& header,
+                           const StreamPos& stream_pos);
 
     uint32_t term_size() const final { return header_.term_size_; }
     uint8_t canonicalize() const final { return header_.canonicalize_; }
     uint64_t num_hashes() const final { return header_.num_hashes_; }
+    uint64_t block_rows() const final { return header_.block_rows_; }
+    HashScheme hash_scheme() const final { return header_.hash_scheme_; }
     uint64_t row_size() const final { return header_.row_size(); }
     uint64_t page_size() const final { return 1; }
     uint64_t counts_size() const final;
-    const std::vector<std::string>& file_names() const override {
-        return header_.file_names_;
+    uint64_t num_documents() const final { return header_.row_bits(); }
+    const char* doc_name(uint64_t i) const final {
+        return name_table_.valid()
+               ? name_table_[i] : header_.file_names_[i].c_str();
     }
 
+    //! attach name table of a lazily opened header to the file's memory
+    void attach_name_table(const uint8_t* header_begin);
+
     ClassicIndexHeader header_;
+    //! document name table inside the memory mapping, if names are lazy
+    DocumentNameTable name_table_;
 
 public:
     virtual ~ClassicIndexSearchFile() = default;
+
+    //! header of the index file, file names may not be loaded
+    const ClassicIndexHeader& header() const { return header_; }
 };
 
 } // namespace cobs
@@ -13,16 +13,22 @@
 #include <cobs/kmer.hpp>
 #include <cobs/query/classic_index/mmap_search_file.hpp>
 #include <cobs/query/compact_index/mmap_search_file.hpp>
+#include <cobs/query/index_manifest.hpp>
 #include <cobs/settings.hpp>
 #include <cobs/util/file.hpp>
 #include <cobs/util/misc.hpp>
+#include <cobs/util/numa.hpp>
 #include <cobs/util/parallel_for.hpp>
 #include <cobs/util/query.hpp>
+#include <cobs/util/rolling_kmer.hpp>
 #include <cobs/util/timer.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <map>
 #include <numeric>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <tlx/logger.hpp>
@@ -49,28 +55,20 @@ ClassicSearch::ClassicSearch(std::vector<std::shared_ptr<IndexSearchFile> > indi
     : index_files_(std::move(indices)) { }
 
 ClassicSearch::ClassicSearch(std::string path)
-{
-    if (file_has_header<ClassicIndexHeader>(path)) {
-        index_files_.emplace_back(
-            std::make_shared<ClassicIndexMMapSearchFile>(path));
-    }
-    else if (file_has_header<CompactIndexHeader>(path)) {
-        index_files_.emplace_back(
-            std::make_shared<CompactIndexMMapSearchFile>(path));
-    }
-    else {
-        die("Could not open index path \"" << path << "\"");
-    }
-}
+    : index_files_(open_index_files(std::vector<fs::path>{ path })) { }
 
+//! compute hashes of all terms of the query, K != 0 is the fixed term size.
+template <uint64_t K>
 static inline
 void create_hashes(
     std::vector<uint64_t>& hashes, const std::string& query,
-    char* canonicalize_buffer,
     const std::shared_ptr<IndexSearchFile>& index_file)
 {
-    uint32_t term_size = index_file->term_size();
+    // a constant length lets the compiler specialize the hash function
+    const uint64_t term_size = K != 0 ? K : index_file->term_size();
     uint64_t num_hashes = index_file->num_hashes();
+    uint64_t block_rows = index_file->block_rows();
+    HashScheme hash_scheme = index_file->hash_scheme();
     uint8_t canonicalize = index_file->canonicalize();
 
     uint64_t num_terms = query.size() - term_size + 1;
@@ -80,25 +78,25 @@ void create_hashes(
 
     if (canonicalize == 0) {
         for (uint64_t i = 0; i < num_terms; i++) {
-            for (uint64_t j = 0; j < num_hashes; j++) {
-                hashes[i * num_hashes + j] = XXH64(query_8 + i, term_size, j);
-            }
+            compute_hashes(&hashes[i * num_hashes], query_8 + i, term_size,
+                           num_hashes, hash_scheme);
+            block_hashes(&hashes[i * num_hashes], num_hashes, block_rows);
         }
     }
     else if (canonicalize == 1) {
+        RollingCanonicalKMer<K> canonicalizer(term_size);
         for (uint64_t i = 0; i < num_terms; i++) {
-            bool good =
-                canonicalize_kmer(query_8 + i, canonicalize_buffer, term_size);
-
-            if (!good) {
-                die("Invalid DNA base pair in query string. "
-                    "Only ACGT are allowed.");
+            tlx::string_view kmer = canonicalizer.canonicalize(query_8 + i);
+            if (hash_scheme == HashScheme::XXH3_2Bit) {
+                uint64_t word = word_to_little_endian(canonicalizer.word());
+                compute_hashes(&hashes[i * num_hashes], &word, sizeof(word),
+                               num_hashes, hash_scheme);
             }
-
-            for (uint64_t j = 0; j < num_hashes; j++) {
-                hashes[i * num_hashes + j] = XXH64(
-                    canonicalize_buffer, term_size, j);
+            else {
+                compute_hashes(&hashes[i * num_hashes], kmer.data(), term_size,
+                               num_hashes, hash_scheme);
             }
+            block_hashes(&hashes[i * num_hashes], num_hashes, block_rows);
         }
     }
     else {
@@ -124,8 +122,8 @@ void counts_to_result(
             sum_doc_counts.back());
 
         uint64_t count_threshold = 0;
-        for (uint64_t j = 0; j < index_file->file_names().size(); ++j) {
-            if (scores[j] >= thresholds[0]) {
+        for (uint64_t j = 0; j < index_file->num_documents(); ++j) {
+            if (scores[j] >= thresholds[0] && !index_file->is_deleted(j)) {
                 sorted_indices[count_threshold++] =
                     std::make_pair(scores[j], j);
             }
@@ -151,7 +149,7 @@ void counts_to_result(
             uint64_t document_id = sorted_indices[i].second;
 
             result[i] = SearchResult(
-                index_file->file_names()[document_id].c_str(),
+                index_file->doc_name(document_id),
                 sorted_indices[i].first);
         }
     }
@@ -159,15 +157,16 @@ void counts_to_result(
     {
         // uninitialized index vector
         tlx::simple_vector<
-            std::pair<Score, std::pair<uint16_t, uint32_t> >
+            std::pair<Score, std::pair<uint32_t, uint32_t> >
             > sorted_indices(sum_doc_counts.back());
 
         uint64_t count_threshold = 0;
         for (uint64_t k = 0; k < index_files.size(); ++k) {
-            for (uint64_t i = 0; i < index_files[k]->file_names().size(); ++i) {
+            for (uint64_t i = 0; i < index_files[k]->num_documents(); ++i) {
                 uint64_t index = sum_doc_counts[k] + i;
 
-                if (scores[index] >= thresholds[k]) {
+                if (scores[index] >= thresholds[k] &&
+                    !index_files[k]->is_deleted(i)) {
                     sorted_indices[count_threshold++] =
                         std::make_pair(scores[index], std::make_pair(k, i));
                 }
@@ -195,7 +194,7 @@ void counts_to_result(
             uint64_t document_id = sorted_indices[i].second.second;
 
             result[i] = SearchResult(
-                index_files[index_id]->file_names()[document_id].c_str(),
+                index_files[index_id]->doc_name(document_id),
                 sorted_indices[i].first);
         }
     }
@@ -306,12 +305,20 @@ void aggregate_rows(
     }
 }
 
+//! number of scores processed per batch of an index file
+static inline
+uint64_t score_batch_size(const IndexSearchFile& index_file) {
+    uint64_t score_batch_size = 128;
+    score_batch_size = std::max(score_batch_size, 8 * index_file.page_size());
+    return std::min(score_batch_size, index_file.counts_size());
+}
+
 template <typename Score>
 void search_index_file(
     uint64_t file_num, const std::shared_ptr<IndexSearchFile>& index_file,
-    const std::string& query, Score* score_list,
-    uint64_t& total_hashes, const std::vector<uint64_t>& sum_doc_counts,
-    Timer& timer)
+    const std::string& query, const std::vector<uint64_t>& hashes,
+    Score* score_list, const std::vector<uint64_t>& sum_doc_counts,
+    uint64_t num_threads, Timer& timer)
 {
     static constexpr bool debug = false;
 
@@ -326,18 +333,7 @@ void search_index_file(
                     std::numeric_limits<Score>::max() + term_size - 1)
                 + " characters");
 
-    timer.active("hashes");
-    std::vector<uint64_t> hashes;
-
-    tlx::simple_vector<char> canonicalize_buffer(term_size);
-    create_hashes(hashes, query, canonicalize_buffer.data(), index_file);
-
-    total_hashes += hashes.size();
-    timer.stop();
-
-    uint64_t score_batch_size = 128;
-    score_batch_size = std::max(score_batch_size, 8 * page_size);
-    score_batch_size = std::min(score_batch_size, score_total_size);
+    uint64_t score_batch_size = cobs::score_batch_size(*index_file);
     uint64_t score_batch_num = tlx::div_ceil(score_total_size, score_batch_size);
     Score* score_start = score_list + sum_doc_counts[file_num];
 
@@ -352,8 +348,9 @@ void search_index_file(
         << " score_batch_num=" << score_batch_num
         << " hashes.size=" << hashes.size();
 
-    parallel_for(
-        0, score_batch_num, gopt_threads,
+    const std::vector<uint8_t>& tombstones = index_file->tombstones();
+
+    auto process_batch =
         [&](uint64_t b) {
             Timer thr_timer;
             uint64_t score_begin = b * score_batch_size;
@@ -369,6 +366,14 @@ void search_index_file(
             die_unless(score_begin % 8 == 0);
             score_begin = tlx::div_ceil(score_begin, 8);
             score_size = tlx::div_ceil(score_size, 8);
+
+            // skip batches of only deleted documents, their scores stay zero
+            if (!tombstones.empty() &&
+                std::all_of(tombstones.begin() + score_begin,
+                            tombstones.begin() + score_begin + score_size,
+                            [](uint8_t t) { return t == 0xFF; })) {
+                return;
+            }
             uint64_t score_buffer_size = tlx::round_up(score_size, 8);
 
             // rows array: interleaved as
@@ -397,6 +402,72 @@ void search_index_file(
             deallocate_aligned(rows);
 
             timer += thr_timer;
+        };
+
+    const std::vector<uint64_t>& numa_bounds = index_file->numa_bounds();
+    if (numa_bounds.size() <= 2 || num_threads <= 1) {
+        parallel_for(0, score_batch_num, num_threads, process_batch);
+        return;
+    }
+
+    // the index is partitioned across NUMA nodes by score range: pin each
+    // worker to a node, process the batches held by it, then help the others.
+    uint64_t num_nodes = numa_bounds.size() - 1;
+    std::vector<std::atomic<uint64_t> > next_batch(num_nodes);
+    std::vector<uint64_t> end_batch(num_nodes);
+    for (uint64_t n = 0; n < num_nodes; ++n) {
+        next_batch[n] = tlx::div_ceil(numa_bounds[n], score_batch_size);
+        end_batch[n] = tlx::div_ceil(numa_bounds[n + 1], score_batch_size);
+    }
+
+    parallel_for(
+        0, num_threads, num_threads,
+        [&](uint64_t t) {
+            uint64_t node = t % num_nodes;
+            numa_pin_thread(node);
+            for (uint64_t i = 0; i < num_nodes; ++i) {
+                uint64_t n = (node + i) % num_nodes, b;
+                while ((b = next_batch[n]++) < end_batch[n])
+                    process_batch(b);
+            }
+            numa_pin_thread(-1);
+        });
+}
+
+//! search all index files. Large files are split into score batches which are
+//! processed in parallel. Files fitting into a single batch, e.g. the members
+//! of an index bundle, are instead processed in parallel with one thread each.
+template <typename Score>
+void search_index_files(
+    const std::vector<std::shared_ptr<IndexSearchFile> >& index_files,
+    const std::string& query,
+    const std::vector<std::vector<uint64_t> >& hashes,
+    const std::vector<uint64_t>& hash_group,
+    Score* score_list, const std::vector<uint64_t>& sum_doc_counts,
+    Timer& timer)
+{
+    std::vector<uint64_t> small_files;
+    for (uint64_t file_num = 0; file_num < index_files.size(); ++file_num)
+    {
+        const IndexSearchFile& index_file = *index_files[file_num];
+        if (index_file.counts_size() <= score_batch_size(index_file)) {
+            small_files.push_back(file_num);
+            continue;
+        }
+        search_index_file(
+            file_num, index_files[file_num], query,
+            hashes[hash_group[file_num]], score_list, sum_doc_counts,
+            gopt_threads, timer);
+    }
+
+    parallel_for(
+        0, small_files.size(), gopt_threads,
+        [&](uint64_t i) {
+            uint64_t file_num = small_files[i];
+            search_index_file(
+                file_num, index_files[file_num], query,
+                hashes[hash_group[file_num]], score_list, sum_doc_counts,
+                /* num_threads */ 1, timer);
         });
 }
 
@@ -439,7 +510,42 @@ void ClassicSearch::search(
         << " sum_doc_counts=" << sum_doc_counts
         << " total_documents=" << total_documents;
 
+    // the hashes do not depend on the signature size, hence they are computed
+    // only once for each distinct (term_size, canonicalize, num_hashes,
+    // block_rows, hash_scheme) and shared by all index files with these
+    // parameters.
+    timer_.active("hashes");
+    std::vector<std::vector<uint64_t> > hashes;
+    std::vector<uint64_t> hash_group(index_files_.size());
+    std::map<std::tuple<uint32_t, uint8_t, uint64_t, uint64_t, HashScheme>,
+             uint64_t> hash_groups;
     uint64_t total_hashes = 0;
+    for (uint64_t i = 0; i < index_files_.size(); ++i) {
+        const std::shared_ptr<IndexSearchFile>& index_file = index_files_[i];
+        auto key = std::make_tuple(index_file->term_size(),
+                                   index_file->canonicalize(),
+                                   index_file->num_hashes(),
+                                   index_file->block_rows(),
+                                   index_file->hash_scheme());
+        auto it = hash_groups.find(key);
+        if (it == hash_groups.end()) {
+            it = hash_groups.emplace(key, hashes.size()).first;
+            hashes.emplace_back();
+            dispatch_term_size(
+                index_file->term_size(),
+                [&](auto fixed_term_size) {
+                    create_hashes<decltype(fixed_term_size)::value>(
+                        hashes.back(), query, index_file);
+                });
+        }
+        hash_group[i] = it->second;
+        total_hashes += hashes[it->second].size();
+    }
+    timer_.stop();
+
+    LOG << "ClassicSearch::search()"
+        << " hash_groups=" << hash_groups.size()
+        << " total_hashes=" << total_hashes;
 
     std::vector<uint64_t> thresholds(index_files_.size());
     for (uint64_t i = 0; i < index_files_.size(); ++i) {
@@ -455,13 +561,8 @@ void ClassicSearch::search(
     {
         uint8_t* score_list = allocate_aligned<uint8_t>(total_documents, 16);
 
-        for (uint64_t file_num = 0; file_num < index_files_.size(); ++file_num)
-        {
-            search_index_file(
-                file_num, index_files_[file_num],
-                query, score_list,
-                total_hashes, sum_doc_counts, timer_);
-        }
+        search_index_files(index_files_, query, hashes, hash_group,
+                           score_list, sum_doc_counts, timer_);
 
         counts_to_result(index_files_, score_list, result, thresholds,
                          num_results, total_hashes, sum_doc_counts);
@@ -471,13 +572,8 @@ void ClassicSearch::search(
     {
         uint16_t* score_list = allocate_aligned<uint16_t>(total_documents, 16);
 
-        for (uint64_t file_num = 0; file_num < index_files_.size(); ++file_num)
-        {
-            search_index_file(
-                file_num, index_files_[file_num],
-                query, score_list,
-                total_hashes, sum_doc_counts, timer_);
-        }
+        search_index_files(index_files_, query, hashes, hash_group,
+                           score_list, sum_doc_counts, timer_);
 
         counts_to_result(index_files_, score_list, result, thresholds,
                          num_results, total_hashes, sum_doc_counts);
@@ -487,13 +583,8 @@ void ClassicSearch::search(
     {
         uint32_t* score_list = allocate_aligned<uint32_t>(total_documents, 16);
 
-        for (uint64_t file_num = 0; file_num < index_files_.size(); ++file_num)
-        {
-            search_index_file(
-                file_num, index_files_[file_num],
-                query, score_list,
-                total_hashes, sum_doc_counts, timer_);
-        }
+        search_index_files(index_files_, query, hashes, hash_group,
+                           score_list, sum_doc_counts, timer_);
 
         counts_to_result(index_files_, score_list, result, thresholds,
                          num_results, total_hashes, sum_doc_counts);
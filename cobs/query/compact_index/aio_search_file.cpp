@@ -28,6 +28,9 @@ CompactIndexAioSearchFile::CompactIndexAioSearchFile(const fs::path& path)
     assert_exit(header_.page_size_ % cobs::get_page_size() == 0,
                 "page size needs to be divisible by 4096 "
                 "so the index can be opened with O_DIRECT");
+    assert_exit(stream_pos_.curr_pos % cobs::get_page_size() == 0,
+                "index data is not aligned to 4096 bytes, rebuild the index "
+                "with a newer version to open it with O_DIRECT");
 
     m_offsets.resize(header_.parameters_.size());
     m_offsets[0] = stream_pos_.curr_pos;
@@ -7,24 +7,107 @@
  ******************************************************************************/
 
 #include <cobs/query/compact_index/mmap_search_file.hpp>
+#include <cobs/settings.hpp>
 #include <cobs/util/query.hpp>
 
+#include <algorithm>
+
 #include <tlx/logger.hpp>
 #include <tlx/math/div_ceil.hpp>
 
 namespace cobs {
 
 CompactIndexMMapSearchFile::CompactIndexMMapSearchFile(const fs::path& path)
-    : CompactIndexSearchFile(path)
+    : CompactIndexSearchFile(path, /* lazy_names */ true)
 {
+    init_mmap(path);
+}
+
+CompactIndexMMapSearchFile::CompactIndexMMapSearchFile(
+    const fs::path& path, const CompactIndexHeader& header,
+    const StreamPos& stream_pos)
+    : CompactIndexSearchFile(header, stream_pos)
+{
+    init_mmap(path);
+    die_unequal(handle_.size, stream_pos_.end_pos);
+}
+
+void CompactIndexMMapSearchFile::init_mmap(const fs::path& path) {
+    // a partitioned index is copied to the nodes from the page cache
+    std::vector<uint64_t> numa_pages = plan_numa_pages();
     data_.resize(header_.parameters_.size());
-    handle_ = initialize_mmap(path);
+    handle_ = initialize_mmap(
+        path, gopt_load_complete_index && numa_pages.empty());
+    attach_name_table(handle_.data);
     data_[0] = handle_.data + stream_pos_.curr_pos;
     for (uint64_t i = 1; i < header_.parameters_.size(); i++) {
         data_[i] =
             data_[i - 1]
             + header_.page_size_ * header_.parameters_[i - 1].signature_size;
     }
+    partition_numa(numa_pages);
+}
+
+std::vector<uint64_t> CompactIndexMMapSearchFile::plan_numa_pages() const {
+    std::vector<uint64_t> numa_pages;
+    if (!numa_partition_index())
+        return numa_pages;
+
+    // split pages into contiguous ranges of about equal size in bytes
+    uint64_t num_pages = header_.parameters_.size();
+    uint64_t total_size = 0;
+    for (const auto& p : header_.parameters_)
+        total_size += header_.page_size_ * p.signature_size;
+
+    uint64_t num_nodes = numa_num_nodes();
+    uint64_t size = 0;
+    numa_pages.push_back(0);
+    for (uint64_t i = 0; i < num_pages; ++i) {
+        if (size >= total_size * numa_pages.size() / num_nodes)
+            numa_pages.push_back(i);
+        size += header_.page_size_ * header_.parameters_[i].signature_size;
+    }
+    numa_pages.push_back(num_pages);
+    numa_pages.erase(std::unique(numa_pages.begin(), numa_pages.end()),
+                     numa_pages.end());
+    if (numa_pages.size() <= 2)
+        numa_pages.clear();
+    return numa_pages;
+}
+
+void CompactIndexMMapSearchFile::partition_numa(
+    const std::vector<uint64_t>& numa_pages) {
+    static constexpr bool debug = false;
+
+    if (numa_pages.empty())
+        return;
+
+    std::vector<uint64_t> sizes;
+    for (uint64_t n = 0; n + 1 < numa_pages.size(); ++n) {
+        uint64_t last = numa_pages[n + 1] - 1;
+        sizes.push_back(
+            data_[last]
+            + header_.page_size_ * header_.parameters_[last].signature_size
+            - data_[numa_pages[n]]);
+    }
+
+    numa_blocks_.allocate(
+        sizes, [&](unsigned node, uint8_t* block) {
+            uint8_t* begin = data_[numa_pages[node]];
+            std::copy(begin, begin + sizes[node], block);
+        });
+
+    numa_bounds_.clear();
+    for (uint64_t n = 0; n + 1 < numa_pages.size(); ++n) {
+        uint8_t* begin = data_[numa_pages[n]];
+        for (uint64_t p = numa_pages[n]; p < numa_pages[n + 1]; ++p)
+            data_[p] = numa_blocks_[n] + (data_[p] - begin);
+        numa_bounds_.push_back(8 * header_.page_size_ * numa_pages[n]);
+    }
+    numa_bounds_.push_back(counts_size());
+
+    LOG << "CompactIndexMMapSearchFile: partitioned over "
+        << numa_blocks_.size() << " NUMA nodes at pages " << numa_pages;
 }
 
 CompactIndexMMapSearchFile::~CompactIndexMMapSearchFile() {
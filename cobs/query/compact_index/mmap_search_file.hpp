@@ -10,6 +10,7 @@
 #define COBS_QUERY_COMPACT_INDEX_MMAP_SEARCH_FILE_HEADER
 
 #include <cobs/query/compact_index/search_file.hpp>
+#include <cobs/util/numa.hpp>
 
 namespace cobs {
 
@@ -18,6 +19,15 @@ class CompactIndexMMapSearchFile : public CompactIndexSearchFile
 private:
     MMapHandle handle_;
     std::vector<uint8_t*> data_;
+    //! page ranges on each NUMA node, if partitioned
+    NumaBlocks numa_blocks_;
+
+    //! map file and calculate page pointers
+    void init_mmap(const fs::path& path);
+    //! determine page ranges if the index is partitioned across NUMA nodes
+    std::vector<uint64_t> plan_numa_pages() const;
+    //! copy the page ranges to each NUMA node and redirect page pointers
+    void partition_numa(const std::vector<uint64_t>& numa_pages);
 
 protected:
     void read_from_disk(const std::vector<uint64_t>& hashes, uint8_t* rows,
@@ -25,6 +35,10 @@ protected:
 
 public:
     explicit CompactIndexMMapSearchFile(const fs::path& path);
+    //! open index file with a cached header, e.g. from an IndexManifest
+    CompactIndexMMapSearchFile(const fs::path& path,
+                               const CompactIndexHeader& header,
+                               const StreamPos& stream_pos);
     ~CompactIndexMMapSearchFile();
 };
 
@@ -14,11 +14,22 @@
 
 namespace cobs {
 
-CompactIndexSearchFile::CompactIndexSearchFile(const fs::path& path) {
+CompactIndexSearchFile::CompactIndexSearchFile(
+    const fs::path& path, bool lazy_names) {
     std::ifstream ifs;
-    header_ = deserialize_header<CompactIndexHeader>(ifs, path);
+    header_ = deserialize_header<CompactIndexHeader>(ifs, path, !lazy_names);
     stream_pos_ = get_stream_pos(ifs);
+    init_parameters();
+}
+
+CompactIndexSearchFile::CompactIndexSearchFile(
+    const CompactIndexHeader& header, const StreamPos& stream_pos)
+    : header_(header) {
+    stream_pos_ = stream_pos;
+    init_parameters();
+}
 
+void CompactIndexSearchFile::init_parameters() {
     // todo assertions that all the data in the Header is correct
     row_size_ = header_.page_size_ * header_.parameters_.size();
     num_hashes_ = header_.parameters_[0].num_hashes;
@@ -27,6 +38,13 @@ CompactIndexSearchFile::CompactIndexSearchFile(const fs::path& path) {
     }
 }
 
+void CompactIndexSearchFile::attach_name_table(const uint8_t* header_begin) {
+    if (!header_.file_names_.empty() || header_.name_table_pos_ == 0)
+        return;
+    name_table_ = DocumentNameTable(
+        header_begin + header_.name_table_pos_, header_.num_lazy_names_);
+}
+
 uint64_t CompactIndexSearchFile::counts_size() const {
     return 8 * header_.parameters_.size() * header_.page_size_;
 }
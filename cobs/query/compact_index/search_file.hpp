@@ -19,23 +19,43 @@ class CompactIndexSearchFile : public IndexSearchFile
 protected:
     uint64_t num_hashes_;
     uint64_t row_size_;
-    explicit CompactIndexSearchFile(const fs::path& path);
+    //! open index file, if lazy_names is true the document names are not
+    //! loaded and must be attached via attach_name_table().
+    explicit CompactIndexSearchFile(const fs::path& path,
+                                    bool lazy_names = false);
+    //! construct from a previously read header without touching the file
+    CompactIndexSearchFile(const CompactIndexHeader& header,
+                           const StreamPos& stream_pos);
+    //! check parameters and calculate row size
+    void init_parameters();
 
     uint32_t term_size() const final { return header_.term_size_; }
     uint8_t canonicalize() const final { return header_.canonicalize_; }
     uint64_t num_hashes() const final { return num_hashes_; }
+    uint64_t block_rows() const final { return header_.block_rows_; }
+    HashScheme hash_scheme() const final { return header_.hash_scheme_; }
     uint64_t page_size() const final { return header_.page_size_; }
     uint64_t row_size() const final { return row_size_; }
     uint64_t counts_size() const final;
 
-    const std::vector<std::string>& file_names() const final {
-        return header_.file_names_;
+    uint64_t num_documents() const final { return header_.num_documents(); }
+    const char* doc_name(uint64_t i) const final {
+        return name_table_.valid()
+               ? name_table_[i] : header_.file_names_[i].c_str();
     }
 
+    //! attach name table of a lazily opened header to the file's memory
+    void attach_name_table(const uint8_t* header_begin);
+
     CompactIndexHeader header_;
+    //! document name table inside the memory mapping, if names are lazy
+    DocumentNameTable name_table_;
 
 public:
     virtual ~CompactIndexSearchFile() = default;
+
+    //! header of the index file, file names may not be loaded
+    const CompactIndexHeader& header() const { return header_; }
 };
 
 } // namespace cobs
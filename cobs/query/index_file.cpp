@@ -0,0 +1,35 @@
+/*******************************************************************************
+ * cobs/query/index_file.cpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/query/index_file.hpp>
+
+#include <tlx/die.hpp>
+#include <tlx/math/div_ceil.hpp>
+
+namespace cobs {
+
+void IndexSearchFile::set_tombstones(const Tombstones& tombstones) {
+    // documents appended after deleting are covered by a shorter bitmap
+    die_unless(tombstones.num_documents() <= num_documents());
+    if (tombstones.count() == 0) {
+        tombstones_.clear();
+        return;
+    }
+
+    // padding documents are deleted, such that batches of only padding or
+    // deleted documents can be skipped entirely.
+    tombstones_.assign(tlx::div_ceil(counts_size(), 8), 0);
+    for (uint64_t i = 0; i < tombstones_.size() * 8; ++i) {
+        if (i >= num_documents() || tombstones.deleted(i))
+            tombstones_[i / 8] |= uint8_t(1) << (i % 8);
+    }
+}
+
+} // namespace cobs
+
+/******************************************************************************/
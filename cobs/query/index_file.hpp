@@ -10,6 +10,8 @@
 #ifndef COBS_QUERY_INDEX_FILE_HEADER
 #define COBS_QUERY_INDEX_FILE_HEADER
 
+#include <cobs/file/tombstones.hpp>
+#include <cobs/util/misc.hpp>
 #include <cobs/util/query.hpp>
 
 #include <immintrin.h>
@@ -30,8 +32,39 @@ public:
     virtual uint64_t row_size() const = 0;
     virtual uint64_t page_size() const = 0;
     virtual uint64_t num_hashes() const = 0;
+    //! rows per block of a blocked Bloom filter, zero if probes are
+    //! independent, see block_hashes().
+    virtual uint64_t block_rows() const = 0;
+    //! hash functions mapping terms to rows
+    virtual HashScheme hash_scheme() const = 0;
     virtual uint64_t counts_size() const = 0;
-    virtual const std::vector<std::string>& file_names() const = 0;
+    //! number of documents in the index
+    virtual uint64_t num_documents() const = 0;
+    //! '\0'-terminated name of document i. Names are resolved lazily from the
+    //! index file if possible, the pointer is valid while the file is open.
+    virtual const char* doc_name(uint64_t i) const = 0;
+
+    //! score positions at which the columns held by each NUMA node begin,
+    //! followed by counts_size(), if the index is partitioned across nodes.
+    const std::vector<uint64_t>& numa_bounds() const { return numa_bounds_; }
+
+    //! attach deleted documents, which are masked in query results.
+    void set_tombstones(const Tombstones& tombstones);
+
+    //! deletion bitmap over the score range, with all padding bits set, or
+    //! empty if no documents are deleted.
+    const std::vector<uint8_t>& tombstones() const { return tombstones_; }
+
+    //! true if document i is deleted
+    bool is_deleted(uint64_t i) const {
+        return !tombstones_.empty() && ((tombstones_[i / 8] >> (i % 8)) & 1);
+    }
+
+protected:
+    //! NUMA partition of score range, empty if not partitioned
+    std::vector<uint64_t> numa_bounds_;
+    //! deletion bitmap, see tombstones()
+    std::vector<uint8_t> tombstones_;
 };
 
 } // namespace cobs
@@ -0,0 +1,341 @@
+/*******************************************************************************
+ * cobs/query/index_manifest.cpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/query/compact_index/mmap_search_file.hpp>
+#include <cobs/query/index_manifest.hpp>
+#include <cobs/settings.hpp>
+#include <cobs/util/file.hpp>
+#include <cobs/util/parallel_for.hpp>
+
+#include <sys/stat.h>
+
+#include <tlx/die.hpp>
+#include <tlx/logger.hpp>
+
+namespace cobs {
+
+IndexFileType identify_index_file(const fs::path& path) {
+    std::ifstream is(path.string(), std::ios::in | std::ios::binary);
+    if (!is.good())
+        return IndexFileType::Unknown;
+
+    // read enough for the longest magic word, bundles have a shorter one
+    std::string magic(5 + ClassicIndexHeader::magic_word.size(), 0);
+    is.read(&magic[0], magic.size());
+    magic.resize(is.gcount());
+    if (magic.compare(0, 5, "COBS:") != 0)
+        return IndexFileType::Unknown;
+
+    auto matches = [&](const std::string& magic_word) {
+        return magic.compare(5, magic_word.size(), magic_word) == 0;
+    };
+    if (matches(ClassicIndexHeader::magic_word))
+        return IndexFileType::Classic;
+    if (matches(CompactIndexHeader::magic_word))
+        return IndexFileType::Compact;
+    if (matches(IndexBundleHeader::magic_word))
+        return IndexFileType::Bundle;
+    return IndexFileType::Unknown;
+}
+
+/******************************************************************************/
+
+const std::string IndexManifest::magic_word = "INDEX_MANIFEST";
+const uint32_t IndexManifest::version = 3;
+const std::string IndexManifest::file_extension = ".cobs_manifest";
+
+//! read file size and modification time, returns false if file is missing
+static inline
+bool stat_index_file(const std::string& path, uint64_t& size, uint64_t& mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+bool IndexManifest::load(const fs::path& path) {
+    std::ifstream is(path.string(), std::ios::in | std::ios::binary);
+    if (!is.good())
+        return false;
+
+    try {
+        is.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+        deserialize_magic_begin(is, magic_word, version);
+
+        uint64_t num_entries;
+        stream_get(is, num_entries);
+        for (uint64_t i = 0; i < num_entries; ++i) {
+            std::string index_path;
+            std::getline(is, index_path, '\0');
+
+            Entry e;
+            uint8_t type, hash_scheme;
+            stream_get(is, e.file_size, e.mtime, type, e.data_pos);
+            e.type = static_cast<IndexFileType>(type);
+
+            if (e.type == IndexFileType::Classic) {
+                ClassicIndexHeader& h = e.classic;
+                stream_get(is, h.term_size_, h.canonicalize_,
+                           h.signature_size_, h.num_hashes_,
+                           h.num_lazy_names_, h.name_table_pos_,
+                           h.data_alignment_, h.block_rows_, hash_scheme);
+                h.hash_scheme_ = static_cast<HashScheme>(hash_scheme);
+                h.header_size_ = e.data_pos;
+            }
+            else if (e.type == IndexFileType::Compact) {
+                CompactIndexHeader& h = e.compact;
+                uint64_t num_parameters;
+                stream_get(is, h.term_size_, h.canonicalize_, h.page_size_,
+                           h.num_lazy_names_, h.name_table_pos_,
+                           h.data_alignment_, h.block_rows_, hash_scheme,
+                           num_parameters);
+                h.hash_scheme_ = static_cast<HashScheme>(hash_scheme);
+                h.parameters_.resize(num_parameters);
+                for (auto& p : h.parameters_)
+                    stream_get(is, p.signature_size, p.num_hashes);
+            }
+            else {
+                die("IndexManifest: invalid entry type");
+            }
+            // drop entries of an unknown scheme, opening the index file then
+            // reads and rejects its header
+            if (!valid_hash_scheme(hash_scheme)) {
+                LOG1 << "IndexManifest: ignoring entry " << index_path
+                     << " with invalid hash scheme " << unsigned(hash_scheme);
+                continue;
+            }
+            entries_[index_path] = std::move(e);
+        }
+
+        deserialize_magic_end(is, magic_word);
+    }
+    catch (std::exception& e) {
+        LOG1 << "IndexManifest: could not read " << path << ": " << e.what();
+        entries_.clear();
+        return false;
+    }
+
+    LOG1 << "IndexManifest: loaded " << path
+         << " [" << entries_.size() << " index files]";
+    dirty_ = false;
+    return true;
+}
+
+void IndexManifest::save(const fs::path& path) const {
+    std::string tmp_path = path.string() + ".tmp";
+    {
+        std::ofstream os(tmp_path, std::ios::out | std::ios::binary);
+        os.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+        serialize_magic_begin(os, magic_word, version);
+
+        stream_put(os, uint64_t(entries_.size()));
+        for (const auto& it : entries_) {
+            const Entry& e = it.second;
+            os << it.first << '\0';
+            stream_put(os, e.file_size, e.mtime,
+                       static_cast<uint8_t>(e.type), e.data_pos);
+
+            if (e.type == IndexFileType::Classic) {
+                const ClassicIndexHeader& h = e.classic;
+                stream_put(os, h.term_size_, h.canonicalize_,
+                           h.signature_size_, h.num_hashes_,
+                           h.row_bits(), h.name_table_pos_,
+                           h.data_alignment_, h.block_rows_,
+                           static_cast<uint8_t>(h.hash_scheme_));
+            }
+            else {
+                const CompactIndexHeader& h = e.compact;
+                stream_put(os, h.term_size_, h.canonicalize_, h.page_size_,
+                           h.num_documents(), h.name_table_pos_,
+                           h.data_alignment_, h.block_rows_,
+                           static_cast<uint8_t>(h.hash_scheme_),
+                           uint64_t(h.parameters_.size()));
+                for (const auto& p : h.parameters_)
+                    stream_put(os, p.signature_size, p.num_hashes);
+            }
+        }
+
+        serialize_magic_end(os, magic_word);
+    }
+    fs::rename(tmp_path, path);
+    LOG1 << "IndexManifest: saved " << path
+         << " [" << entries_.size() << " index files]";
+}
+
+const IndexManifest::Entry* IndexManifest::lookup(const fs::path& path) const {
+    auto it = entries_.find(path.string());
+    if (it == entries_.end())
+        return nullptr;
+    uint64_t size, mtime;
+    if (!stat_index_file(path.string(), size, mtime))
+        return nullptr;
+    if (it->second.file_size != size || it->second.mtime != mtime)
+        return nullptr;
+    return &it->second;
+}
+
+void IndexManifest::put(const fs::path& path, const IndexSearchFile& index) {
+    Entry e;
+    if (!stat_index_file(path.string(), e.file_size, e.mtime))
+        return;
+    e.data_pos = index.stream_pos_.curr_pos;
+
+    if (auto* c = dynamic_cast<const ClassicIndexSearchFile*>(&index)) {
+        e.type = IndexFileType::Classic;
+        e.classic = c->header();
+        e.classic.num_lazy_names_ = e.classic.row_bits();
+        e.classic.file_names_.clear();
+        // version 1 files have no name table, names cannot be cached
+        if (e.classic.name_table_pos_ == 0)
+            return;
+    }
+    else if (auto* c = dynamic_cast<const CompactIndexSearchFile*>(&index)) {
+        e.type = IndexFileType::Compact;
+        e.compact = c->header();
+        e.compact.num_lazy_names_ = e.compact.num_documents();
+        e.compact.file_names_.clear();
+        if (e.compact.name_table_pos_ == 0)
+            return;
+    }
+    else {
+        return;
+    }
+
+    entries_[path.string()] = std::move(e);
+    dirty_ = true;
+}
+
+/******************************************************************************/
+
+//! attach the tombstone sidecar of an index file, if it exists
+static inline
+void load_tombstones(const fs::path& path, IndexSearchFile& index) {
+    Tombstones tombstones;
+    if (!tombstones.load(path, index.num_documents()))
+        return;
+    index.set_tombstones(tombstones);
+    LOG1 << "open_index_file: " << path << " has "
+         << tombstones.count() << " deleted documents";
+}
+
+//! open a classic or compact index file whose type was already identified
+static std::shared_ptr<IndexSearchFile> open_index_file(
+    const fs::path& path, IndexFileType type) {
+    std::shared_ptr<IndexSearchFile> index;
+    switch (type) {
+    case IndexFileType::Classic:
+        index = std::make_shared<ClassicIndexMMapSearchFile>(path);
+        break;
+    case IndexFileType::Compact:
+        index = std::make_shared<CompactIndexMMapSearchFile>(path);
+        break;
+    default:
+        die("Could not open index path \"" << path << "\"");
+    }
+    load_tombstones(path, *index);
+    return index;
+}
+
+std::shared_ptr<IndexSearchFile> open_index_file(const fs::path& path) {
+    return open_index_file(path, identify_index_file(path));
+}
+
+std::vector<std::shared_ptr<IndexSearchFile> > open_index_bundle(
+    const fs::path& path) {
+    std::ifstream ifs;
+    IndexBundleHeader bh = deserialize_header<IndexBundleHeader>(ifs, path);
+
+    std::shared_ptr<MMapHandle> handle = share_mmap(initialize_mmap(path));
+    die_unless(bh.members_.empty() ||
+               bh.members_.back().offset + bh.members_.back().size
+               <= handle->size);
+
+    std::vector<std::shared_ptr<IndexSearchFile> > indices;
+    indices.reserve(bh.members_.size());
+    for (const IndexBundleHeader::Member& m : bh.members_) {
+        ifs.seekg(m.offset);
+        ClassicIndexHeader h;
+        h.deserialize(ifs, /* load_file_names */ false);
+        indices.emplace_back(
+            std::make_shared<ClassicIndexMMapSearchFile>(
+                handle, h, m.offset, m.size));
+    }
+    return indices;
+}
+
+std::vector<std::shared_ptr<IndexSearchFile> > open_index_files(
+    const std::vector<fs::path>& paths, const fs::path& manifest_path) {
+
+    IndexManifest manifest;
+    if (!manifest_path.empty())
+        manifest.load(manifest_path);
+
+    std::vector<std::shared_ptr<IndexSearchFile> > indices(paths.size());
+    std::vector<std::vector<std::shared_ptr<IndexSearchFile> > > bundles(
+        paths.size());
+    // flags are written concurrently, hence not std::vector<bool>
+    std::vector<uint8_t> cached(paths.size()), bundled(paths.size());
+
+    parallel_for(
+        0, paths.size(), gopt_threads,
+        [&](size_t i) {
+            const IndexManifest::Entry* e = manifest.lookup(paths[i]);
+            if (e && e->type == IndexFileType::Classic) {
+                indices[i] = std::make_shared<ClassicIndexMMapSearchFile>(
+                    paths[i], e->classic,
+                    StreamPos { e->data_pos, e->file_size });
+            }
+            else if (e && e->type == IndexFileType::Compact) {
+                indices[i] = std::make_shared<CompactIndexMMapSearchFile>(
+                    paths[i], e->compact,
+                    StreamPos { e->data_pos, e->file_size });
+            }
+            else {
+                // identify the file only if the manifest has no entry
+                IndexFileType type = identify_index_file(paths[i]);
+                if (type == IndexFileType::Bundle) {
+                    bundles[i] = open_index_bundle(paths[i]);
+                    bundled[i] = true;
+                }
+                else {
+                    indices[i] = open_index_file(paths[i], type);
+                }
+                return;
+            }
+            load_tombstones(paths[i], *indices[i]);
+            cached[i] = true;
+        });
+
+    if (!manifest_path.empty()) {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (!cached[i] && !bundled[i])
+                manifest.put(paths[i], *indices[i]);
+        }
+        if (manifest.dirty())
+            manifest.save(manifest_path);
+    }
+
+    // expand bundles into their members, keeping the order of paths
+    std::vector<std::shared_ptr<IndexSearchFile> > result;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!bundled[i]) {
+            result.emplace_back(std::move(indices[i]));
+            continue;
+        }
+        for (auto& index : bundles[i])
+            result.emplace_back(std::move(index));
+    }
+    return result;
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * cobs/query/index_manifest.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_QUERY_INDEX_MANIFEST_HEADER
+#define COBS_QUERY_INDEX_MANIFEST_HEADER
+
+#include <cobs/file/classic_index_header.hpp>
+#include <cobs/file/compact_index_header.hpp>
+#include <cobs/file/index_bundle_header.hpp>
+#include <cobs/query/index_file.hpp>
+#include <cobs/util/fs.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cobs {
+
+//! type of an index file, identified by its magic word
+enum class IndexFileType : uint8_t {
+    Unknown = 0, Classic = 1, Compact = 2, Bundle = 3
+};
+
+//! identify the type of an index file by reading only its magic word
+IndexFileType identify_index_file(const fs::path& path);
+
+/*!
+ * Cache of the header metadata of a set of index files. With a manifest,
+ * reopening thousands of index files only requires mapping them, the headers
+ * are not read again. Entries are validated using file size and modification
+ * time. Only files with a document name table (version >= 2) are cached,
+ * since the names are resolved lazily from the mapping.
+ */
+class IndexManifest
+{
+public:
+    static const std::string magic_word;
+    static const uint32_t version;
+    static const std::string file_extension;
+
+    struct Entry {
+        //! file size and modification time for validation
+        uint64_t file_size = 0, mtime = 0;
+        //! type of index file
+        IndexFileType type = IndexFileType::Unknown;
+        //! position of the data section
+        uint64_t data_pos = 0;
+        //! headers without file names
+        ClassicIndexHeader classic;
+        CompactIndexHeader compact;
+    };
+
+    //! load manifest from file, returns false if it does not exist.
+    bool load(const fs::path& path);
+    //! save manifest to file, atomically replacing it.
+    void save(const fs::path& path) const;
+
+    //! look up a valid entry for the index file, or return nullptr.
+    const Entry* lookup(const fs::path& path) const;
+    //! store the header of an opened index file
+    void put(const fs::path& path, const IndexSearchFile& index);
+
+    //! number of entries
+    size_t size() const { return entries_.size(); }
+    //! true if entries were added since loading
+    bool dirty() const { return dirty_; }
+
+private:
+    std::unordered_map<std::string, Entry> entries_;
+    //! true if entries were added
+    bool dirty_ = false;
+};
+
+//! open a classic or compact index file using mmap, deleted documents are
+//! loaded from its tombstone sidecar file if it exists.
+std::shared_ptr<IndexSearchFile> open_index_file(const fs::path& path);
+
+//! open all classic indices in an index bundle using one shared mmap
+std::vector<std::shared_ptr<IndexSearchFile> > open_index_bundle(
+    const fs::path& path);
+
+//! open a list of index files in parallel using gopt_threads. If a manifest
+//! path is given, headers are taken from it and it is updated if necessary.
+//! Index bundles are expanded into their members, which are not cached.
+std::vector<std::shared_ptr<IndexSearchFile> > open_index_files(
+    const std::vector<fs::path>& paths,
+    const fs::path& manifest_path = fs::path());
+
+} // namespace cobs
+
+#endif // !COBS_QUERY_INDEX_MANIFEST_HEADER
+
+/******************************************************************************/
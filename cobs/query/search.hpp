@@ -19,6 +19,7 @@
 #include <cobs/file/classic_index_header.hpp>
 #include <cobs/query/compact_index/mmap_search_file.hpp>
 #include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/query/index_manifest.hpp>
 #include <zlib.h>
 #include <kseq.h>
 KSEQ_INIT(gzFile, gzread)
@@ -58,26 +59,12 @@ public:
     Timer timer_;
 };
 
+//! open index files in parallel, optionally using a cached IndexManifest
 static inline std::vector<std::shared_ptr<cobs::IndexSearchFile> > get_cobs_indexes_given_files (
-  const std::vector<fs::path> &index_files
+  const std::vector<fs::path> &index_files,
+  const fs::path &manifest_path = fs::path()
   ) {
-  std::vector<std::shared_ptr<cobs::IndexSearchFile> > indices;
-
-  for (auto& path : index_files)
-  {
-    if (cobs::file_has_header<cobs::ClassicIndexHeader>(path)) {
-      indices.push_back(
-        std::make_shared<cobs::ClassicIndexMMapSearchFile>(path));
-    }
-    else if (cobs::file_has_header<cobs::CompactIndexHeader>(path)) {
-      indices.push_back(
-        std::make_shared<cobs::CompactIndexMMapSearchFile>(path));
-    }
-    else
-      die("Could not open index path \"" << path << "\"");
-  }
-
-  return indices;
+  return cobs::open_index_files(index_files, manifest_path);
 }
 
 static inline std::vector<std::shared_ptr<cobs::IndexSearchFile> > get_cobs_indexes_given_streams (
@@ -8,6 +8,8 @@
 
 #include <cobs/settings.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <thread>
 
 namespace cobs {
@@ -18,6 +20,35 @@ bool gopt_load_complete_index = false;
 
 bool gopt_disable_cache = false;
 
+uint64_t gopt_data_alignment = 4096;
+
+unsigned gopt_gzip_threads = gzip_threads_auto;
+
+uint64_t gopt_gzip_index_span = 4 * 1024 * 1024;
+
+//! number of gzipped files currently read, see GzipReaderScope
+static std::atomic<unsigned> s_gzip_readers { 0 };
+
+GzipReaderScope::GzipReaderScope() { ++s_gzip_readers; }
+
+GzipReaderScope::~GzipReaderScope() { --s_gzip_readers; }
+
+unsigned gzip_threads() {
+    if (gopt_gzip_threads != gzip_threads_auto)
+        return gopt_gzip_threads;
+    // a batch with fewer gzipped documents than threads leaves cores idle
+    unsigned readers = std::min(std::max(s_gzip_readers.load(), 1u),
+                                std::max(gopt_threads, 1u));
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    if (hardware <= readers)
+        return 0;
+    // besides its workers, each stream has a reader and a sequencer thread
+    unsigned spare = (hardware - readers) / readers;
+    return spare >= 3 ? std::min(spare - 2, 4u) : 0;
+}
+
+NumaPolicy gopt_numa_policy = NumaPolicy::FirstTouch;
+
 } // namespace cobs
 
 /******************************************************************************/
@@ -24,6 +24,53 @@ extern bool gopt_load_complete_index;
 //! whether to disable FastA/FastQ cache files globally.
 extern bool gopt_disable_cache;
 
+//! alignment of the bit matrix in newly written index files, default: 4 KiB.
+extern uint64_t gopt_data_alignment;
+
+//! number of helper threads inflating each gzipped FastA/FastQ file, zero
+//! inflates inline on the reading thread. Default: gzip_threads_auto.
+extern unsigned gopt_gzip_threads;
+
+//! derive the number of gzip helper threads from the thread budget
+static const unsigned gzip_threads_auto = unsigned(-1);
+
+//! return the number of helper threads per gzipped file: gopt_gzip_threads, or
+//! if automatic, the hardware threads not used by the gzipped files currently
+//! read (at most gopt_threads) divided among them, at most 4. This is zero,
+//! inline inflation, if all hardware threads already read files in parallel.
+unsigned gzip_threads();
+
+//! registers a reader of a gzipped file while it exists, which gzip_threads()
+//! counts as busy. Create it before calling gzip_threads().
+class GzipReaderScope
+{
+public:
+    GzipReaderScope();
+    ~GzipReaderScope();
+
+    //! non-copyable
+    GzipReaderScope(const GzipReaderScope&) = delete;
+    GzipReaderScope& operator = (const GzipReaderScope&) = delete;
+};
+
+//! minimum uncompressed distance between access points of gzip indices of
+//! multi-FASTA files, default: 4 MiB. Smaller spans speed up reading single
+//! subdocuments at the cost of a 32 KiB window per access point.
+extern uint64_t gopt_gzip_index_span;
+
+//! placement of indices loaded into RAM on NUMA machines
+enum class NumaPolicy {
+    //! memory is placed on the node of the loading thread
+    FirstTouch,
+    //! pages are interleaved across all nodes
+    Interleave,
+    //! score ranges are partitioned across nodes, query threads are pinned
+    Partition
+};
+
+//! NUMA placement of indices loaded with gopt_load_complete_index.
+extern NumaPolicy gopt_numa_policy;
+
 } // namespace cobs
 
 #endif // !COBS_SETTINGS_HEADER
@@ -12,12 +12,16 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #include <cobs/util/fs.hpp>
 
 #include <tlx/die.hpp>
 #include <tlx/logger.hpp>
 
+#include <xxhash.h>
+
 namespace cobs {
 
 template <class Header>
@@ -34,13 +38,16 @@ void serialize_header(const fs::path& p, const Header& h) {
     serialize_header<Header>(ofs, p, h);
 }
 
-template <class Header>
-Header deserialize_header(std::ifstream& ifs, const fs::path& p) {
+//! open file and deserialize header, additional arguments are passed to
+//! Header::deserialize().
+template <class Header, typename... Args>
+Header deserialize_header(std::ifstream& ifs, const fs::path& p,
+                          Args&& ... args) {
     ifs.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
     ifs.open(p.string(), std::ios::in | std::ios::binary);
     die_unless(ifs.good());
     Header h;
-    h.deserialize(ifs);
+    h.deserialize(ifs, std::forward<Args>(args) ...);
     return h;
 }
 
@@ -84,6 +91,26 @@ std::string base_name(const fs::path& p) {
     return result.substr(0, pos);
 }
 
+//! checksum of the first and last 64 KiB of a stream of size bytes, which
+//! detects a rebuilt or replaced file without reading all of it. Moves the
+//! read position of the stream.
+static inline
+uint64_t head_tail_checksum(std::istream& is, uint64_t size) {
+    static constexpr uint64_t block_size = 64 * 1024;
+    std::vector<char> data(std::min(size, block_size));
+    is.clear();
+    is.seekg(0);
+    is.read(data.data(), data.size());
+    uint64_t checksum = XXH64(data.data(), data.size(), 0);
+    if (size > block_size) {
+        is.seekg(size - block_size);
+        is.read(data.data(), data.size());
+        checksum = XXH64(data.data(), data.size(), checksum);
+    }
+    die_unless(is.good());
+    return checksum;
+}
+
 } // namespace cobs
 
 #endif // !COBS_UTIL_FILE_HEADER
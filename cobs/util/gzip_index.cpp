@@ -0,0 +1,279 @@
+/*******************************************************************************
+ * cobs/util/gzip_index.cpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/util/fs.hpp>
+#include <cobs/util/file.hpp>
+#include <cobs/util/gzip_index.hpp>
+#include <cobs/util/serialization.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <tlx/die.hpp>
+#include <tlx/logger.hpp>
+
+#include <zlib.h>
+
+namespace cobs {
+
+//! size of the deflate window
+static const size_t window_size = 32768;
+
+const std::string GzipIndex::file_extension = ".cobs_gzi";
+
+const GzipIndex::AccessPoint* GzipIndex::find(uint64_t offset) const {
+    auto it = std::upper_bound(
+        points_.begin(), points_.end(), offset,
+        [](uint64_t o, const AccessPoint& p) { return o < p.out; });
+    if (it == points_.begin())
+        return nullptr;
+    return &*(--it);
+}
+
+void GzipIndex::identify(std::istream& is, uint64_t size) {
+    compressed_size_ = size;
+    checksum_ = head_tail_checksum(is, size);
+}
+
+void GzipIndex::write_file(const std::string& path) const {
+    std::ofstream os(path + ".tmp", std::ios::out | std::ios::binary);
+    stream_put_pod(os, compressed_size_);
+    stream_put_pod(os, checksum_);
+    stream_put_pod(os, span_);
+    stream_put_pod(os, points_.size());
+    for (const AccessPoint& p : points_) {
+        stream_put(os, p.out, p.in, p.bits, uint64_t(p.window.size()));
+        os.write(p.window.data(), p.window.size());
+    }
+    os.close();
+    fs::rename(path + ".tmp", path);
+    LOG1 << "GzipIndex: saved " << points_.size() << " access points as "
+         << path;
+}
+
+bool GzipIndex::read_file(const std::string& path) {
+    std::ifstream is(path, std::ios::in | std::ios::binary);
+    if (!is.good()) return false;
+    uint64_t compressed_size, checksum, num_points, span;
+    stream_get_pod(is, compressed_size);
+    stream_get_pod(is, checksum);
+    stream_get_pod(is, span);
+    stream_get_pod(is, num_points);
+    if (!is.good() || compressed_size != compressed_size_ ||
+        checksum != checksum_ || span != span_)
+        return false;
+    points_.resize(num_points);
+    for (AccessPoint& p : points_) {
+        uint64_t size;
+        stream_get(is, p.out, p.in, p.bits, size);
+        if (!is.good() || size > 2 * window_size)
+            return false;
+        p.window.resize(size);
+        is.read(&p.window[0], size);
+    }
+    return is.good() && (is.get() == EOF);
+}
+
+/******************************************************************************/
+
+struct GzipIndexStreambuf::Inflater {
+    z_stream zs;
+    //! compressed input buffer
+    std::vector<uint8_t> in = std::vector<uint8_t>(64 * 1024);
+    //! uncompressed output buffer, used as get area
+    std::vector<char> out = std::vector<char>(64 * 1024);
+    //! ring buffer of the last uncompressed bytes, only when building
+    std::vector<char> window;
+    size_t window_pos = 0;
+    //! true if the next input byte starts a gzip member
+    bool member_start = true;
+};
+
+GzipIndexStreambuf::GzipIndexStreambuf(std::istream& is, GzipIndex& index)
+    : is_(is), build_(&index), inflater_(std::make_unique<Inflater>()) {
+    z_stream& zs = inflater_->zs;
+    std::memset(&zs, 0, sizeof(zs));
+    die_unless(inflateInit2(&zs, 15 + 16) == Z_OK);
+    inflater_->window.resize(window_size);
+    index.points_.clear();
+}
+
+GzipIndexStreambuf::GzipIndexStreambuf(
+    std::istream& is, const GzipIndex& index, uint64_t offset)
+    : is_(is), inflater_(std::make_unique<Inflater>()) {
+    z_stream& zs = inflater_->zs;
+    std::memset(&zs, 0, sizeof(zs));
+
+    const GzipIndex::AccessPoint* p = index.find(offset);
+    is_.clear();
+    if (p == nullptr) {
+        // no access point, start at the beginning
+        die_unless(inflateInit2(&zs, 15 + 16) == Z_OK);
+        is_.seekg(0);
+    }
+    else {
+        die_unless(inflateInit2(&zs, -15) == Z_OK);
+        raw_ = true;
+        inflater_->member_start = false;
+        out_ = p->out;
+        is_.seekg(p->in - (p->bits ? 1 : 0));
+        if (p->bits) {
+            int c = is_.get();
+            die_unless(c != EOF);
+            inflatePrime(&zs, p->bits, c >> (8 - p->bits));
+        }
+        std::vector<char> window(window_size);
+        uLongf window_len = window_size;
+        die_unless(
+            uncompress(reinterpret_cast<Bytef*>(window.data()), &window_len,
+                       reinterpret_cast<const Bytef*>(p->window.data()),
+                       p->window.size()) == Z_OK &&
+            window_len == window_size);
+        inflateSetDictionary(
+            &zs, reinterpret_cast<const Bytef*>(window.data()), window_size);
+    }
+    die_unless(is_.good());
+
+    // inflate and discard data up to the offset
+    while (out_ < offset) {
+        size_t n = inflate_some();
+        if (n == 0)
+            break;
+        if (out_ > offset) {
+            char* out = inflater_->out.data();
+            setg(out, out + n - (out_ - offset), out + n);
+            break;
+        }
+    }
+}
+
+GzipIndexStreambuf::~GzipIndexStreambuf() {
+    inflateEnd(&inflater_->zs);
+}
+
+GzipIndexStreambuf::int_type GzipIndexStreambuf::underflow() {
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+    size_t n = inflate_some();
+    if (n == 0)
+        return traits_type::eof();
+    char* out = inflater_->out.data();
+    setg(out, out, out + n);
+    return traits_type::to_int_type(*gptr());
+}
+
+bool GzipIndexStreambuf::fill() {
+    z_stream& zs = inflater_->zs;
+    is_.read(reinterpret_cast<char*>(inflater_->in.data()),
+             inflater_->in.size());
+    zs.next_in = inflater_->in.data();
+    zs.avail_in = static_cast<uInt>(is_.gcount());
+    return zs.avail_in != 0;
+}
+
+void GzipIndexStreambuf::update_window(const char* data, size_t size) {
+    std::vector<char>& window = inflater_->window;
+    size_t& pos = inflater_->window_pos;
+    if (size >= window_size) {
+        std::copy(data + size - window_size, data + size, window.begin());
+        pos = 0;
+        return;
+    }
+    size_t first = std::min(size, window_size - pos);
+    std::copy(data, data + first, window.begin() + pos);
+    std::copy(data + first, data + size, window.begin());
+    pos = (pos + size) % window_size;
+}
+
+size_t GzipIndexStreambuf::inflate_some() {
+    z_stream& zs = inflater_->zs;
+    std::vector<char>& out = inflater_->out;
+
+    while (!eof_) {
+        if (zs.avail_in == 0 && !fill()) {
+            if (!inflater_->member_start || skip_ != 0)
+                die("GzipIndexStreambuf: unexpected end of gzip stream");
+            eof_ = true;
+            break;
+        }
+        if (skip_ != 0) {
+            // skip trailer of a member inflated raw
+            size_t s = std::min<size_t>(skip_, zs.avail_in);
+            zs.next_in += s, zs.avail_in -= s;
+            in_ += s, skip_ -= s;
+            continue;
+        }
+        if (inflater_->member_start && zs.next_in[0] != 0x1F) {
+            // ignore trailing garbage like gzip does
+            eof_ = true;
+            break;
+        }
+
+        zs.next_out = reinterpret_cast<Bytef*>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+        uInt avail_in = zs.avail_in;
+        int r = inflate(&zs, build_ ? Z_BLOCK : Z_NO_FLUSH);
+        if (r != Z_OK && r != Z_STREAM_END && r != Z_BUF_ERROR) {
+            die("GzipIndexStreambuf: gzip data error: "
+                << (zs.msg ? zs.msg : "unknown"));
+        }
+        in_ += avail_in - zs.avail_in;
+        size_t n = out.size() - zs.avail_out;
+        out_ += n;
+        inflater_->member_start = false;
+
+        if (build_) {
+            update_window(out.data(), n);
+            // add access point at block boundaries, but not before the last
+            // block of a member.
+            if ((zs.data_type & 128) && !(zs.data_type & 64) &&
+                (build_->points_.empty() || out_ - last_ > build_->span_)) {
+                std::vector<char> window(window_size);
+                const std::vector<char>& ring = inflater_->window;
+                size_t pos = inflater_->window_pos;
+                std::copy(ring.begin() + pos, ring.end(), window.begin());
+                std::copy(ring.begin(), ring.begin() + pos,
+                          window.begin() + (window_size - pos));
+
+                GzipIndex::AccessPoint p;
+                p.out = out_, p.in = in_;
+                p.bits = zs.data_type & 7;
+                uLongf size = compressBound(window_size);
+                p.window.resize(size);
+                die_unless(
+                    compress(reinterpret_cast<Bytef*>(&p.window[0]), &size,
+                             reinterpret_cast<const Bytef*>(window.data()),
+                             window_size) == Z_OK);
+                p.window.resize(size);
+                build_->points_.emplace_back(std::move(p));
+                last_ = out_;
+            }
+        }
+
+        if (r == Z_STREAM_END) {
+            if (raw_) {
+                // skip the trailer and continue with the next gzip member
+                skip_ = 8;
+                raw_ = false;
+                inflateReset2(&zs, 15 + 16);
+            }
+            else {
+                inflateReset(&zs);
+            }
+            inflater_->member_start = true;
+        }
+        if (n != 0)
+            return n;
+    }
+    return 0;
+}
+
+} // namespace cobs
+
+/******************************************************************************/
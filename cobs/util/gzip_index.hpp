@@ -0,0 +1,146 @@
+/*******************************************************************************
+ * cobs/util/gzip_index.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_GZIP_INDEX_HEADER
+#define COBS_UTIL_GZIP_INDEX_HEADER
+
+#include <cobs/settings.hpp>
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Index of access points into a gzip file, as in zlib's zran.c example. An
+ * access point is a deflate block boundary with the uncompressed and
+ * compressed offsets, the number of bits of the block in the preceding byte,
+ * and the 32 KiB window of uncompressed data before it. With the index,
+ * decompression can start at the access point before any uncompressed
+ * offset. Windows are stored deflated, since they are mostly sequence data.
+ */
+class GzipIndex
+{
+public:
+    static const std::string file_extension;
+
+    struct AccessPoint {
+        //! uncompressed and compressed offset
+        uint64_t out, in;
+        //! number of bits of the block in the byte at in - 1, or zero
+        uint8_t bits;
+        //! deflated window of 32 KiB preceding the access point
+        std::string window;
+    };
+
+    //! minimum uncompressed distance between access points, the maximum
+    //! amount inflated and discarded to reach an offset
+    uint64_t span_ = gopt_gzip_index_span;
+    //! size and head_tail_checksum() of the compressed file, used to detect
+    //! stale index files
+    uint64_t compressed_size_ = 0, checksum_ = 0;
+    //! access points ordered by offsets
+    std::vector<AccessPoint> points_;
+
+    //! return the last access point at or before the uncompressed offset, or
+    //! nullptr if there is none.
+    const AccessPoint* find(uint64_t offset) const;
+
+    //! set compressed_size_ and checksum_ from the compressed stream of size
+    //! bytes, moves its read position.
+    void identify(std::istream& is, uint64_t size);
+
+    //! write index file
+    void write_file(const std::string& path) const;
+    //! read index file, returns false if it is missing, was built for a
+    //! compressed file of a different size or checksum than set by
+    //! identify(), or with a different span_.
+    bool read_file(const std::string& path);
+};
+
+/*!
+ * Stream buffer inflating a gzip stream, possibly with multiple members,
+ * using a GzipIndex. It either inflates the complete stream and adds access
+ * points to the index, or it starts at an uncompressed offset by seeking to
+ * the preceding access point.
+ */
+class GzipIndexStreambuf : public std::streambuf
+{
+public:
+    //! inflate the complete gzip stream is and build index
+    GzipIndexStreambuf(std::istream& is, GzipIndex& index);
+    //! inflate gzip stream is starting at the uncompressed offset
+    GzipIndexStreambuf(std::istream& is, const GzipIndex& index,
+                       uint64_t offset);
+
+    //! non-copyable: delete copy-constructor
+    GzipIndexStreambuf(const GzipIndexStreambuf&) = delete;
+    //! non-copyable: delete assignment operator
+    GzipIndexStreambuf& operator = (const GzipIndexStreambuf&) = delete;
+
+    ~GzipIndexStreambuf();
+
+protected:
+    int_type underflow() final;
+
+private:
+    struct Inflater;
+
+    //! input stream of compressed data
+    std::istream& is_;
+    //! index to add access points to, only when building
+    GzipIndex* build_ = nullptr;
+    //! zlib state and buffers
+    std::unique_ptr<Inflater> inflater_;
+    //! uncompressed and compressed offset of the decompressor
+    uint64_t out_ = 0, in_ = 0;
+    //! uncompressed offset of last access point
+    uint64_t last_ = 0;
+    //! true if the deflate data of the current member is inflated raw
+    bool raw_ = false;
+    //! bytes of a gzip trailer still to skip after raw inflation
+    size_t skip_ = 0;
+    //! true at the end of the gzip stream
+    bool eof_ = false;
+
+    //! refill input buffer, returns false at end of input
+    bool fill();
+    //! add uncompressed data to the window
+    void update_window(const char* data, size_t size);
+    //! inflate into output buffer, returns number of bytes
+    size_t inflate_some();
+};
+
+//! input stream using GzipIndexStreambuf
+class GzipIndexIstream : public std::istream
+{
+public:
+    //! inflate the complete gzip stream is and build index
+    GzipIndexIstream(std::istream& is, GzipIndex& index)
+        : std::istream(nullptr), buf_(is, index) {
+        rdbuf(&buf_);
+    }
+    //! inflate gzip stream is starting at the uncompressed offset
+    GzipIndexIstream(std::istream& is, const GzipIndex& index, uint64_t offset)
+        : std::istream(nullptr), buf_(is, index, offset) {
+        rdbuf(&buf_);
+    }
+
+private:
+    GzipIndexStreambuf buf_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_GZIP_INDEX_HEADER
+
+/******************************************************************************/
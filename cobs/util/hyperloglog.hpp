@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * cobs/util/hyperloglog.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_HYPERLOGLOG_HEADER
+#define COBS_UTIL_HYPERLOGLOG_HEADER
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <tlx/die.hpp>
+#include <tlx/math/clz.hpp>
+
+namespace cobs {
+
+/*!
+ * HyperLogLog sketch estimating the number of distinct 64-bit hashes added to
+ * it. With 2^precision registers the standard error is about
+ * 1.04 / sqrt(2^precision), i.e. 0.8% for the default of 14, using 16 KiB.
+ * Small cardinalities are estimated by linear counting of empty registers.
+ * Sketches of equal precision can be merged, e.g. when parts of a document are
+ * processed by several threads.
+ */
+class HyperLogLog
+{
+public:
+    explicit HyperLogLog(unsigned precision = 14)
+        : precision_(precision), registers_(size_t(1) << precision, 0) {
+        die_unless(precision >= 4 && precision <= 18);
+    }
+
+    //! mix a 2-bit k-mer word into a hash with the murmur3 finalizer
+    static uint64_t hash_word(uint64_t word) {
+        uint64_t h = word;
+        h ^= h >> 33, h *= 0xFF51AFD7ED558CCDllu;
+        h ^= h >> 33, h *= 0xC4CEB9FE1A85EC53llu;
+        h ^= h >> 33;
+        return h;
+    }
+
+    //! add a hash value, which must be uniformly distributed
+    void add(uint64_t hash) {
+        uint64_t index = hash >> (64 - precision_);
+        // the sentinel bit bounds the rank if all remaining bits are zero
+        uint64_t rest = (hash << precision_) |
+                        (uint64_t(1) << (precision_ - 1));
+        uint8_t rank = static_cast<uint8_t>(tlx::clz(rest) + 1);
+        if (registers_[index] < rank)
+            registers_[index] = rank;
+    }
+
+    //! merge another sketch into this one
+    void merge(const HyperLogLog& other) {
+        die_unequal(precision_, other.precision_);
+        for (size_t i = 0; i < registers_.size(); ++i)
+            registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+
+    //! return estimated number of distinct hashes added
+    uint64_t estimate() const {
+        const double m = static_cast<double>(registers_.size());
+        double sum = 0;
+        uint64_t zeros = 0;
+        for (uint8_t r : registers_) {
+            sum += std::ldexp(1.0, -static_cast<int>(r));
+            zeros += (r == 0);
+        }
+        double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double e = alpha * m * m / sum;
+        // linear counting is more accurate for small cardinalities
+        if (e <= 2.5 * m && zeros != 0)
+            e = m * std::log(m / static_cast<double>(zeros));
+        return static_cast<uint64_t>(std::llround(e));
+    }
+
+private:
+    //! number of index bits
+    unsigned precision_;
+    //! maximum rank of the hashes of each register
+    std::vector<uint8_t> registers_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_HYPERLOGLOG_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * cobs/util/kmer_count_sketch.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_KMER_COUNT_SKETCH_HEADER
+#define COBS_UTIL_KMER_COUNT_SKETCH_HEADER
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tlx/die.hpp>
+#include <tlx/logger.hpp>
+#include <tlx/math/round_to_power_of_two.hpp>
+
+namespace cobs {
+
+/*!
+ * Count-min sketch of k-mers given as 2-bit words (k <= 32), used to find the
+ * solid k-mers of a read set, which occur at least max_count times. Counters
+ * are 8-bit, saturate at max_count and are raised by conservative update. The
+ * estimates never undercount, hence all solid k-mers are found, while a rare
+ * k-mer may be overcounted if it collides in all rows with more frequent ones.
+ *
+ * The width is chosen for each document from its number of terms, but is
+ * limited by max_bytes, which callers derive from their share of the memory
+ * budget. Very large read sets then fill the sketch and are filtered less
+ * effectively, which warn_overloaded() reports.
+ */
+class KMerCountSketch
+{
+public:
+    //! number of counters per k-mer
+    static constexpr size_t num_rows = 3;
+    //! default memory limit, 16 Mi counters per row
+    static constexpr uint64_t default_max_bytes = num_rows * 16 * 1024 * 1024;
+
+    explicit KMerCountSketch(unsigned max_count,
+                             uint64_t max_bytes = default_max_bytes)
+        : max_count_(max_count),
+          max_width_(tlx::round_down_to_power_of_two(
+                         std::max<uint64_t>(max_bytes / num_rows, 4096))) {
+        die_unless(max_count >= 1 && max_count <= 255);
+    }
+
+    //! clear the sketch and size it for about num_terms k-mers
+    void reset(uint64_t num_terms) {
+        width_ = std::min<uint64_t>(
+            tlx::round_up_to_power_of_two(std::max<uint64_t>(num_terms, 4096)),
+            max_width_);
+        counters_.assign(num_rows * width_, 0);
+    }
+
+    //! estimated fraction of k-mers seen once which collide in all rows with
+    //! counted ones: the product of the fractions of used counters per row.
+    double collision_rate() const {
+        double rate = width_ != 0 ? 1.0 : 0.0;
+        for (size_t r = 0; r < num_rows; ++r) {
+            const uint8_t* row = counters_.data() + r * width_;
+            uint64_t used = width_ - std::count(row, row + width_, 0);
+            rate *= static_cast<double>(used) / width_;
+        }
+        return rate;
+    }
+
+    //! log a warning about document name if the sketch is too small for the
+    //! k-mers counted since reset(), such that many erroneous k-mers pass the
+    //! filter.
+    void warn_overloaded(const std::string& name) const {
+        double rate = collision_rate();
+        if (rate < 0.1)
+            return;
+        LOG1 << "KMerCountSketch: " << name << " fills the sketch of "
+             << width_ << " counters per row, min_count passes about "
+             << static_cast<int>(100 * rate) << "% of the k-mers seen once. "
+             << "Increase the memory or reduce the threads.";
+    }
+
+    //! count an occurrence of word, returns the estimated count before it,
+    //! which is at most max_count.
+    unsigned add(uint64_t word) {
+        // murmur3 finalizer, then double hashing for the rows
+        uint64_t h = word;
+        h ^= h >> 33, h *= 0xFF51AFD7ED558CCDllu;
+        h ^= h >> 33, h *= 0xC4CEB9FE1A85EC53llu;
+        h ^= h >> 33;
+        uint64_t h2 = (h >> 32) | 1;
+
+        uint8_t* counter[num_rows];
+        unsigned estimate = max_count_;
+        for (size_t r = 0; r < num_rows; ++r) {
+            counter[r] = &counters_[r * width_ + ((h + r * h2) & (width_ - 1))];
+            estimate = std::min<unsigned>(estimate, *counter[r]);
+        }
+        if (estimate < max_count_) {
+            // conservative update: raise only the smallest counters
+            for (size_t r = 0; r < num_rows; ++r) {
+                if (*counter[r] == estimate)
+                    *counter[r] = static_cast<uint8_t>(estimate + 1);
+            }
+        }
+        return estimate;
+    }
+
+private:
+    //! saturation value of counters
+    unsigned max_count_;
+    //! maximum and current number of counters per row, a power of two
+    size_t max_width_, width_ = 0;
+    //! counters, row-major
+    std::vector<uint8_t> counters_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_KMER_COUNT_SKETCH_HEADER
+
+/******************************************************************************/
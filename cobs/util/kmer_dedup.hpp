@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * cobs/util/kmer_dedup.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_KMER_DEDUP_HEADER
+#define COBS_UTIL_KMER_DEDUP_HEADER
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Filter of repeated k-mers given as 2-bit words (k <= 32), used to skip
+ * hashing terms which were already inserted into the current document. It is
+ * an open addressing hash set with linear probing, which grows up to
+ * max_capacity words. When it is full, it is cleared and the document
+ * continues as a new chunk, such that memory stays bounded and only repeats
+ * within a chunk are removed.
+ *
+ * All ones is used to mark empty slots. It is never a canonical word, since the
+ * reverse complement of all T is all A.
+ */
+class KMerDedup
+{
+public:
+    explicit KMerDedup(size_t max_capacity = 4 * 1024 * 1024)
+        : max_capacity_(std::max<size_t>(max_capacity, min_capacity)),
+          table_(min_capacity, empty) { }
+
+    //! insert word, returns false if it was already contained.
+    bool insert(uint64_t word) {
+        size_t mask = table_.size() - 1;
+        size_t i = hash(word) & mask;
+        while (table_[i] != empty) {
+            if (table_[i] == word)
+                return false;
+            i = (i + 1) & mask;
+        }
+        table_[i] = word;
+        if (++size_ > table_.size() / 2)
+            grow();
+        return true;
+    }
+
+    //! forget all words to start a new document. Shrinks the table if the
+    //! previous document needed much less space.
+    void clear() {
+        if (size_ < table_.size() / 8 && table_.size() > min_capacity)
+            table_.assign(std::max(table_.size() / 8, min_capacity), empty);
+        else
+            std::fill(table_.begin(), table_.end(), empty);
+        size_ = 0;
+    }
+
+private:
+    static constexpr uint64_t empty = ~uint64_t(0);
+    static constexpr size_t min_capacity = 4096;
+
+    //! maximum number of slots
+    size_t max_capacity_;
+    //! slots, a power of two
+    std::vector<uint64_t> table_;
+    //! number of words in table
+    size_t size_ = 0;
+
+    static size_t hash(uint64_t word) {
+        // Fibonacci hashing, the high bits are well mixed
+        return (word * 0x9E3779B97F4A7C15llu) >> 20;
+    }
+
+    //! double the table, or start a new chunk if at maximum capacity
+    void grow() {
+        if (table_.size() * 2 > max_capacity_) {
+            std::fill(table_.begin(), table_.end(), empty);
+            size_ = 0;
+            return;
+        }
+        std::vector<uint64_t> old(table_.size() * 2, empty);
+        old.swap(table_);
+        size_t mask = table_.size() - 1;
+        for (const uint64_t& word : old) {
+            if (word == empty)
+                continue;
+            size_t i = hash(word) & mask;
+            while (table_[i] != empty)
+                i = (i + 1) & mask;
+            table_[i] = word;
+        }
+    }
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_KMER_DEDUP_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,141 @@
+/*******************************************************************************
+ * cobs/util/line_reader.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_LINE_READER_HEADER
+#define COBS_UTIL_LINE_READER_HEADER
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <vector>
+
+#include <tlx/container/string_view.hpp>
+
+namespace cobs {
+
+/*!
+ * Reads lines from an input stream using large blocks. Newlines are found
+ * using memchr() and lines are returned as string_views into the block
+ * buffer, hence no line is copied or allocated. A view is valid until the
+ * next call to next().
+ */
+class LineReader
+{
+public:
+    explicit LineReader(std::istream& is, size_t block_size = 1024 * 1024)
+        : is_(is), buf_(block_size) { }
+
+    //! read the next line without the '\n', returns false at end of input.
+    bool next(tlx::string_view& line) {
+        while (true) {
+            const char* nl = static_cast<const char*>(
+                std::memchr(buf_.data() + begin_, '\n', end_ - begin_));
+            if (nl != nullptr) {
+                line = tlx::string_view(buf_.data() + begin_,
+                                        nl - buf_.data() - begin_);
+                begin_ = nl - buf_.data() + 1;
+                return true;
+            }
+            if (eof_) {
+                // last line without '\n'
+                if (begin_ == end_)
+                    return false;
+                line = tlx::string_view(buf_.data() + begin_, end_ - begin_);
+                begin_ = end_;
+                return true;
+            }
+            fill();
+        }
+    }
+
+private:
+    //! input stream
+    std::istream& is_;
+    //! block buffer
+    std::vector<char> buf_;
+    //! unread area of buffer
+    size_t begin_ = 0, end_ = 0;
+    //! true if the input stream is exhausted
+    bool eof_ = false;
+
+    //! move unread partial line to the front and read more data
+    void fill() {
+        std::memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+        // grow buffer for lines longer than a block
+        if (end_ == buf_.size())
+            buf_.resize(2 * buf_.size());
+        is_.read(buf_.data() + end_, buf_.size() - end_);
+        end_ += is_.gcount();
+        if (!is_.good())
+            eof_ = true;
+    }
+};
+
+/*!
+ * Buffer collecting the lines of a sequence such that terms spanning line
+ * breaks are contiguous. When the buffer is full, all terms in it are passed
+ * to the callback and the last term_size - 1 characters are carried over. All
+ * terms of a sequence hence lie consecutively in one buffer, which lets
+ * callers canonicalize them rolling.
+ */
+class TermBuffer
+{
+public:
+    explicit TermBuffer(uint64_t term_size, size_t capacity = 64 * 1024)
+        : term_size_(term_size),
+          buf_(std::max<size_t>(capacity, 2 * term_size)) { }
+
+    //! append sequence data, emitting terms when the buffer is full
+    template <typename Callback>
+    void append(const char* data, size_t size, Callback& callback) {
+        while (size != 0) {
+            size_t n = std::min(size, buf_.size() - fill_);
+            std::memcpy(buf_.data() + fill_, data, n);
+            fill_ += n, data += n, size -= n;
+            if (fill_ == buf_.size())
+                flush(callback);
+        }
+    }
+
+    //! emit all complete terms and keep the last term_size - 1 characters
+    template <typename Callback>
+    void flush(Callback& callback) {
+        if (fill_ < term_size_)
+            return;
+        for (uint64_t i = 0; i + term_size_ <= fill_; ++i) {
+            callback(tlx::string_view(buf_.data() + i, term_size_));
+        }
+        std::memmove(buf_.data(), buf_.data() + fill_ - (term_size_ - 1),
+                     term_size_ - 1);
+        fill_ = term_size_ - 1;
+    }
+
+    //! emit all complete terms and end the sequence
+    template <typename Callback>
+    void finish(Callback& callback) {
+        flush(callback);
+        fill_ = 0;
+    }
+
+private:
+    //! length of terms
+    uint64_t term_size_;
+    //! sequence buffer
+    std::vector<char> buf_;
+    //! number of characters in buffer
+    size_t fill_ = 0;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_LINE_READER_HEADER
+
+/******************************************************************************/
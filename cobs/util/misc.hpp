@@ -9,14 +9,18 @@
 #ifndef COBS_UTIL_MISC_HEADER
 #define COBS_UTIL_MISC_HEADER
 
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <random>
+#include <string>
+#include <vector>
 
 #include <xxhash.h>
 
+#include <tlx/die.hpp>
 #include <tlx/string/ssprintf.hpp>
 
 namespace cobs {
@@ -59,16 +63,172 @@ std::string pad_index(uint64_t index, int size = 6) {
     return tlx::ssprintf("%0*lu", size, index);
 }
 
+/*!
+ * OR num_bits bits starting at bit in_pos of in into out at bit out_pos. Bits
+ * are numbered in the column order of the index rows: bit i is (1 << i % 8) of
+ * byte i / 8.
+ */
+static inline
+void copy_bits(const uint8_t* in, uint64_t in_pos,
+               uint8_t* out, uint64_t out_pos, uint64_t num_bits) {
+    while (num_bits > 0) {
+        uint64_t in_off = in_pos % 8, out_off = out_pos % 8;
+        uint64_t m = std::min(
+            num_bits, std::min<uint64_t>(8 - in_off, 8 - out_off));
+        uint8_t bits = (in[in_pos / 8] >> in_off) & ((1u << m) - 1);
+        out[out_pos / 8] |= static_cast<uint8_t>(bits << out_off);
+        in_pos += m, out_pos += m, num_bits -= m;
+    }
+}
+
+/*!
+ * Transpose an 8x8 bit matrix, in which bit 8 * i + j is entry (i, j), using
+ * three delta swaps on a 64-bit word. Byte i of the input, holding bits of
+ * row i, becomes the bits i of all output bytes.
+ */
+static inline
+uint64_t transpose_bits_8x8(uint64_t x) {
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAllu;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCllu;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0llu;
+    x = x ^ t ^ (t << 28);
+    return x;
+}
+
+/*!
+ * Hash functions used to map a term to its Bloom filter rows. The scheme is
+ * recorded in the index header, indices written before version 5 use XXH64.
+ */
+enum class HashScheme : uint8_t {
+    //! one XXH64 of the term per hash, seeded with the hash index
+    XXH64 = 0,
+    //! one XXH3 128-bit hash of the term, expanded by double hashing h1 + i *
+    //! h2 (Kirsch-Mitzenmacher), hence independent of the number of hashes.
+    XXH3 = 1,
+    //! like XXH3, but of the canonical k-mer's 2-bit word (A=0, C=1, G=2, T=3,
+    //! first base in the highest bits) as 8 little-endian bytes instead of its
+    //! text. Packed k-mers of .cobs_doc and Cortex files are hashed without
+    //! unpacking them. Requires canonicalization and terms of at most 32 bases.
+    XXH3_2Bit = 2,
+};
+
+//! parse the name of a hash scheme: "xxh64", "xxh3" or "xxh3-2bit"
+static inline
+HashScheme parse_hash_scheme(const std::string& name) {
+    if (name == "xxh64")
+        return HashScheme::XXH64;
+    if (name == "xxh3-2bit")
+        return HashScheme::XXH3_2Bit;
+    if (name != "xxh3")
+        die("Unknown hash scheme \"" << name
+            << "\", use xxh64, xxh3 or xxh3-2bit");
+    return HashScheme::XXH3;
+}
+
+//! return the name of a hash scheme
+static inline
+const char * hash_scheme_name(HashScheme scheme) {
+    switch (scheme) {
+    case HashScheme::XXH3:
+        return "xxh3";
+    case HashScheme::XXH3_2Bit:
+        return "xxh3-2bit";
+    default:
+        return "xxh64";
+    }
+}
+
+//! true if the value read from an index header is a known hash scheme
+static inline
+bool valid_hash_scheme(uint8_t scheme) {
+    return scheme <= static_cast<uint8_t>(HashScheme::XXH3_2Bit);
+}
+
+//! byte order of a 2-bit word as hashed by HashScheme::XXH3_2Bit
+static inline
+uint64_t word_to_little_endian(uint64_t word) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(word);
+#else
+    return word;
+#endif
+}
+
+/*!
+ * Computes the num_hashes hashes of the term input[0, size) into hashes using
+ * the given scheme. Rows are selected by taking the hashes modulo the
+ * signature size.
+ */
+static inline
+void compute_hashes(uint64_t* hashes, const void* input, uint64_t size,
+                    uint64_t num_hashes, HashScheme scheme) {
+    if (scheme != HashScheme::XXH64) {
+        XXH128_hash_t h = XXH3_128bits(input, size);
+        // an odd step visits distinct rows for power of two signature sizes
+        uint64_t step = h.high64 | 1;
+        for (uint64_t i = 0; i < num_hashes; i++)
+            hashes[i] = h.low64 + i * step;
+        return;
+    }
+    for (uint64_t i = 0; i < num_hashes; i++)
+        hashes[i] = XXH64(input, size, i);
+}
+
+/*!
+ * Transforms the num_hashes hashes of one term for a blocked Bloom filter with
+ * block_rows consecutive rows per block. The first hash selects the block and
+ * its row inside, the others only select a row inside the same block. For
+ * every signature size which is a multiple of block_rows, the transformed
+ * hashes modulo the signature size all fall into one block, hence callers
+ * still apply the signature size using modulo, and folding to such a divisor
+ * remains valid.
+ */
+static inline
+void block_hashes(uint64_t* hashes, uint64_t num_hashes, uint64_t block_rows) {
+    if (block_rows <= 1)
+        return;
+    uint64_t block_begin = hashes[0] - hashes[0] % block_rows;
+    for (uint64_t i = 1; i < num_hashes; i++)
+        hashes[i] = block_begin + hashes[i] % block_rows;
+}
+
 /*!
  * Constructs the hash used by the signatures.
  */
 template <typename Callback>
 void process_hashes(const void* input, uint64_t size, uint64_t signature_size,
-                    uint64_t num_hashes, Callback callback) {
-    for (uint64_t i = 0; i < num_hashes; i++) {
-        uint64_t hash = XXH64(input, size, i);
-        callback(hash % signature_size);
+                    uint64_t num_hashes, Callback callback,
+                    uint64_t block_rows = 0,
+                    HashScheme scheme = HashScheme::XXH64) {
+    // few hashes per term are the rule, avoid allocations for them
+    static constexpr uint64_t kStackHashes = 16;
+    uint64_t stack_hashes[kStackHashes];
+    std::vector<uint64_t> heap_hashes;
+    uint64_t* hashes = stack_hashes;
+    if (num_hashes > kStackHashes) {
+        heap_hashes.resize(num_hashes);
+        hashes = heap_hashes.data();
     }
+    compute_hashes(hashes, input, size, num_hashes, scheme);
+    block_hashes(hashes, num_hashes, block_rows);
+    for (uint64_t i = 0; i < num_hashes; i++)
+        callback(hashes[i] % signature_size);
+}
+
+/*!
+ * Constructs the hashes of a canonical k-mer given as 2-bit word, see
+ * HashScheme::XXH3_2Bit.
+ */
+template <typename Callback>
+void process_word_hashes(uint64_t word, uint64_t signature_size,
+                         uint64_t num_hashes, Callback callback,
+                         uint64_t block_rows = 0) {
+    uint64_t le_word = word_to_little_endian(word);
+    process_hashes(&le_word, sizeof(le_word), signature_size, num_hashes,
+                   callback, block_rows, HashScheme::XXH3_2Bit);
 }
 
 } // namespace cobs
@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * cobs/util/numa.cpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/settings.hpp>
+#include <cobs/util/error_handling.hpp>
+#include <cobs/util/misc.hpp>
+#include <cobs/util/numa.hpp>
+
+#include <exception>
+#include <thread>
+
+#include <tlx/die.hpp>
+
+#if COBS_USE_NUMA
+#include <numa.h>
+#endif
+
+namespace cobs {
+
+//! number of simulated nodes, or zero
+static unsigned s_simulated_nodes = 0;
+
+//! actual number of NUMA nodes of the machine
+static unsigned numa_actual_nodes() {
+#if COBS_USE_NUMA
+    static const unsigned num_nodes =
+        numa_available() < 0 ? 1 : numa_num_configured_nodes();
+    return num_nodes;
+#else
+    return 1;
+#endif
+}
+
+unsigned numa_num_nodes() {
+    return s_simulated_nodes != 0 ? s_simulated_nodes : numa_actual_nodes();
+}
+
+void numa_simulate_nodes(unsigned num_nodes) {
+    s_simulated_nodes = num_nodes;
+}
+
+bool numa_partition_index() {
+    return gopt_load_complete_index &&
+           gopt_numa_policy == NumaPolicy::Partition &&
+           numa_num_nodes() > 1;
+}
+
+void numa_pin_thread(int node) {
+#if COBS_USE_NUMA
+    if (numa_actual_nodes() <= 1)
+        return;
+    if (node >= 0)
+        node %= numa_actual_nodes();
+    if (numa_run_on_node(node) != 0)
+        print_errno("numa_run_on_node()");
+#else
+    (void)node;
+#endif
+}
+
+void numa_interleave(void* data, uint64_t size) {
+#if COBS_USE_NUMA
+    if (numa_actual_nodes() <= 1)
+        return;
+    numa_interleave_memory(data, size, numa_all_nodes_ptr);
+#else
+    (void)data, (void)size;
+#endif
+}
+
+void numa_run_on_nodes(const std::function<void(unsigned node)>& functor) {
+    unsigned num_nodes = numa_num_nodes();
+    std::vector<std::thread> threads;
+    std::exception_ptr eptr;
+    for (unsigned n = 0; n < num_nodes; ++n) {
+        threads.emplace_back(
+            [&, n]() {
+                try {
+                    numa_pin_thread(n);
+                    functor(n);
+                }
+                catch (...) {
+                    eptr = std::current_exception();
+                }
+            });
+    }
+    for (std::thread& t : threads)
+        t.join();
+    if (eptr)
+        std::rethrow_exception(eptr);
+}
+
+NumaBlocks::~NumaBlocks() {
+    for (uint8_t* block : blocks_)
+        deallocate_aligned(block);
+}
+
+void NumaBlocks::allocate(
+    const std::vector<uint64_t>& sizes,
+    const std::function<void(unsigned node, uint8_t* data)>& fill) {
+    die_unless(blocks_.empty());
+    die_unless(sizes.size() <= numa_num_nodes());
+    blocks_.resize(sizes.size());
+    numa_run_on_nodes(
+        [&](unsigned node) {
+            if (node >= sizes.size())
+                return;
+            // allocate_aligned() zeroes the block on this node
+            blocks_[node] = allocate_aligned<uint8_t>(
+                sizes[node], get_page_size());
+            fill(node, blocks_[node]);
+        });
+}
+
+} // namespace cobs
+
+/******************************************************************************/
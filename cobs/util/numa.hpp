@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * cobs/util/numa.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_NUMA_HEADER
+#define COBS_UTIL_NUMA_HEADER
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace cobs {
+
+//! number of NUMA nodes, 1 if libnuma is unavailable or not compiled in.
+unsigned numa_num_nodes();
+
+//! use num_nodes nodes for partitioning, even if the machine has fewer, such
+//! that placement across several nodes can be tested on any machine. Threads
+//! of missing nodes are pinned to node (node % actual nodes). Zero restores
+//! the actual number.
+void numa_simulate_nodes(unsigned num_nodes);
+
+//! true if indices loaded into RAM are partitioned across NUMA nodes by score
+//! range, which requires gopt_load_complete_index, NumaPolicy::Partition, and
+//! more than one node.
+bool numa_partition_index();
+
+//! bind the calling thread to the CPUs of a NUMA node, or release it to all
+//! nodes if node is -1.
+void numa_pin_thread(int node);
+
+//! interleave the pages of a memory area across all NUMA nodes. Must be called
+//! before the memory is first touched.
+void numa_interleave(void* data, uint64_t size);
+
+//! run functor(node) on a thread pinned to each NUMA node, in parallel. Memory
+//! first touched by the functor is allocated on its node.
+void numa_run_on_nodes(const std::function<void(unsigned node)>& functor);
+
+/*!
+ * Memory areas allocated and filled by threads on each NUMA node, used to hold
+ * a loaded index partitioned by score range.
+ */
+class NumaBlocks
+{
+public:
+    NumaBlocks() = default;
+    NumaBlocks(const NumaBlocks&) = delete;
+    NumaBlocks& operator = (const NumaBlocks&) = delete;
+    ~NumaBlocks();
+
+    //! allocate sizes[n] bytes on each node n and fill them with
+    //! fill(node, data) on a thread pinned to the node.
+    void allocate(const std::vector<uint64_t>& sizes,
+                  const std::function<void(unsigned node, uint8_t* data)>& fill);
+
+    //! memory block on node n
+    uint8_t* operator [] (size_t n) const { return blocks_[n]; }
+
+    //! number of blocks
+    size_t size() const { return blocks_.size(); }
+
+private:
+    std::vector<uint8_t*> blocks_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_NUMA_HEADER
+
+/******************************************************************************/
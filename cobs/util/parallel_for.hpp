@@ -9,6 +9,7 @@
 #ifndef COBS_UTIL_PARALLEL_FOR_HEADER
 #define COBS_UTIL_PARALLEL_FOR_HEADER
 
+#include <algorithm>
 #include <atomic>
 #include <exception>
 
@@ -24,6 +25,8 @@ extern std::unique_ptr<tlx::ThreadPool> g_thread_pool;
 template <typename Functor>
 void parallel_for(uint64_t begin, uint64_t end, uint64_t num_threads,
                   Functor functor) {
+    // a single item runs inline, which also avoids nesting in the pool
+    num_threads = std::min(num_threads, end > begin ? end - begin : 0);
     if (num_threads <= 1) {
         for (uint64_t i = begin; i < end; ++i) {
             functor(i);
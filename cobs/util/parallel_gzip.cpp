@@ -0,0 +1,480 @@
+/*******************************************************************************
+ * cobs/util/parallel_gzip.cpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#include <cobs/util/parallel_gzip.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <tlx/die.hpp>
+#include <tlx/logger.hpp>
+
+#include <zlib.h>
+
+namespace cobs {
+
+//! size of chunks delivered by the sequencer when inflating sequentially
+static const size_t sequential_chunk_size = 1024 * 1024;
+
+//! size of a gzip member header without optional fields
+static const size_t gzip_header_size = 10;
+
+//! check if p points to a plausible gzip member header: magic bytes, deflate
+//! method, no reserved flags, known extra flags and operating system.
+static inline
+bool is_gzip_header(const uint8_t* p) {
+    return p[0] == 0x1F && p[1] == 0x8B && p[2] == 8 && (p[3] & 0xE0) == 0 &&
+           (p[8] == 0 || p[8] == 2 || p[8] == 4) && (p[9] <= 13 || p[9] == 255);
+}
+
+//! return the extra field length of a gzip header with FEXTRA, or 0.
+static inline
+size_t gzip_extra_length(const uint8_t* p) {
+    if (p[0] != 0x1F || p[1] != 0x8B || p[2] != 8 || (p[3] & 0x04) == 0)
+        return 0;
+    return p[10] | (p[11] << 8);
+}
+
+//! return the total size of the BGZF block whose header (including the extra
+//! field) is at p, or 0 if the extra field has no "BC" subfield.
+static inline
+size_t bgzf_block_size(const uint8_t* p) {
+    size_t xlen = gzip_extra_length(p);
+    const uint8_t* x = p + gzip_header_size + 2;
+    for (size_t i = 0; i + 4 <= xlen; ) {
+        size_t slen = x[i + 2] | (x[i + 3] << 8);
+        if (x[i] == 'B' && x[i + 1] == 'C' && slen == 2 && i + 6 <= xlen)
+            return (x[i + 4] | (x[i + 5] << 8)) + 1;
+        i += 4 + slen;
+    }
+    return 0;
+}
+
+//! inflate data consisting of complete gzip members, returns false if the
+//! data does not start or end at a member boundary or is corrupt.
+static
+bool inflate_members(const std::vector<uint8_t>& data, std::vector<char>& out) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK)
+        return false;
+
+    zs.next_in = const_cast<Bytef*>(data.data());
+    zs.avail_in = static_cast<uInt>(data.size());
+
+    out.resize(std::max<size_t>(4 * data.size(), 4096));
+    size_t pos = 0;
+    bool ok = false;
+    while (true) {
+        if (pos == out.size())
+            out.resize(2 * out.size());
+        zs.next_out = reinterpret_cast<Bytef*>(out.data() + pos);
+        zs.avail_out = static_cast<uInt>(out.size() - pos);
+        int r = inflate(&zs, Z_NO_FLUSH);
+        pos = out.size() - zs.avail_out;
+        if (r == Z_STREAM_END) {
+            if (zs.avail_in == 0) {
+                ok = true;
+                break;
+            }
+            // next member must follow immediately
+            inflateReset(&zs);
+            continue;
+        }
+        // errors and members truncated at the end of the span
+        if (r != Z_OK || (zs.avail_in == 0 && zs.avail_out != 0))
+            break;
+    }
+    inflateEnd(&zs);
+
+    if (ok)
+        out.resize(pos);
+    else
+        std::vector<char>().swap(out);
+    return ok;
+}
+
+/******************************************************************************/
+
+struct ParallelGzipStreambuf::Inline {
+    //! inflater, continued across members
+    z_stream zs;
+    //! compressed input buffer
+    std::vector<uint8_t> in = std::vector<uint8_t>(64 * 1024);
+    //! whether the input stream is exhausted
+    bool eof = false;
+    //! whether the inflater is inside a member
+    bool in_member = false;
+    //! whether non-gzip data follows the last member
+    bool trailing = false;
+};
+
+ParallelGzipStreambuf::ParallelGzipStreambuf(
+    std::istream& is, unsigned num_threads, size_t span_size)
+    : is_(is), span_size_(span_size) {
+    if (num_threads == 0) {
+        inline_ = std::make_unique<Inline>();
+        std::memset(&inline_->zs, 0, sizeof(inline_->zs));
+        die_unless(inflateInit2(&inline_->zs, 15 + 16) == Z_OK);
+        return;
+    }
+    max_spans_ = 2 * num_threads + 2;
+    max_chunks_ = num_threads + 2;
+
+    threads_.emplace_back([this]() { reader(); });
+    threads_.emplace_back([this]() { sequencer(); });
+    for (unsigned i = 0; i < num_threads; ++i)
+        threads_.emplace_back([this]() { worker(); });
+}
+
+ParallelGzipStreambuf::~ParallelGzipStreambuf() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+        cv_.notify_all();
+    }
+    for (std::thread& t : threads_)
+        t.join();
+    if (inline_)
+        inflateEnd(&inline_->zs);
+}
+
+bool ParallelGzipStreambuf::inflate_inline() {
+    Inline& in = *inline_;
+    z_stream& zs = in.zs;
+    current_.resize(sequential_chunk_size);
+    size_t pos = 0;
+    while (pos == 0 && !in.trailing) {
+        if (zs.avail_in == 0 && !in.eof) {
+            is_.read(reinterpret_cast<char*>(in.in.data()), in.in.size());
+            zs.next_in = in.in.data();
+            zs.avail_in = static_cast<uInt>(is_.gcount());
+            if (!is_.good())
+                in.eof = true;
+        }
+        if (zs.avail_in == 0) {
+            if (in.in_member)
+                die("ParallelGzipStreambuf: unexpected end of gzip stream");
+            break;
+        }
+        if (!in.in_member) {
+            if (zs.next_in[0] != 0x1F ||
+                (zs.avail_in >= 2 && zs.next_in[1] != 0x8B)) {
+                LOG1 << "ParallelGzipStreambuf: trailing garbage ignored";
+                in.trailing = true;
+                break;
+            }
+            inflateReset(&zs);
+            in.in_member = true;
+        }
+        zs.next_out = reinterpret_cast<Bytef*>(current_.data() + pos);
+        zs.avail_out = static_cast<uInt>(current_.size() - pos);
+        int r = inflate(&zs, Z_NO_FLUSH);
+        pos = current_.size() - zs.avail_out;
+        if (r == Z_STREAM_END) {
+            in.in_member = false;
+        }
+        else if (r != Z_OK && r != Z_BUF_ERROR) {
+            die("ParallelGzipStreambuf: gzip data error: "
+                << (zs.msg ? zs.msg : "unknown"));
+        }
+    }
+    current_.resize(pos);
+    return pos != 0;
+}
+
+ParallelGzipStreambuf::int_type ParallelGzipStreambuf::underflow() {
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    if (inline_) {
+        if (!inflate_inline())
+            return traits_type::eof();
+        setg(current_.data(), current_.data(),
+             current_.data() + current_.size());
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() {
+                 return !chunks_.empty() || sequencer_done_ || stop_;
+             });
+    if (!error_.empty())
+        die("ParallelGzipStreambuf: " << error_);
+    if (chunks_.empty())
+        return traits_type::eof();
+
+    current_ = std::move(chunks_.front());
+    chunks_.pop_front();
+    cv_.notify_all();
+
+    setg(current_.data(), current_.data(), current_.data() + current_.size());
+    return traits_type::to_int_type(*gptr());
+}
+
+bool ParallelGzipStreambuf::push_span(
+    std::vector<uint8_t>&& data, bool candidate) {
+    std::unique_ptr<Span> span = std::make_unique<Span>();
+    span->data = std::move(data);
+    span->candidate = candidate;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return stop_ || spans_.size() < max_spans_; });
+    if (stop_)
+        return false;
+    spans_.emplace_back(std::move(span));
+    cv_.notify_all();
+    return true;
+}
+
+bool ParallelGzipStreambuf::push_chunk(std::vector<char>&& chunk) {
+    if (chunk.empty())
+        return true;
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return stop_ || chunks_.size() < max_chunks_; });
+    if (stop_)
+        return false;
+    chunks_.emplace_back(std::move(chunk));
+    cv_.notify_all();
+    return true;
+}
+
+void ParallelGzipStreambuf::fail(const std::string& error) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (error_.empty())
+        error_ = error;
+    stop_ = true;
+    cv_.notify_all();
+}
+
+void ParallelGzipStreambuf::reader() {
+    try {
+        // compressed data not yet cut into spans
+        std::vector<uint8_t> buf;
+        bool eof = false;
+        // read until buf contains at least n bytes, false if input ends before
+        auto fill = [&](size_t n) {
+            while (buf.size() < n && !eof) {
+                size_t old = buf.size();
+                buf.resize(std::max(n, old + 64 * 1024));
+                is_.read(reinterpret_cast<char*>(buf.data() + old),
+                         buf.size() - old);
+                buf.resize(old + is_.gcount());
+                if (!is_.good())
+                    eof = true;
+            }
+            return buf.size() >= n;
+        };
+        // cut span buf[0,size) and push it
+        auto cut = [&](size_t size, bool candidate) {
+            std::vector<uint8_t> rest(buf.begin() + size, buf.end());
+            buf.resize(size);
+            bool more = push_span(std::move(buf), candidate);
+            buf = std::move(rest);
+            return more;
+        };
+
+        // end of complete BGZF blocks in buf, while the input is BGZF
+        size_t pos = 0;
+        bool bgzf = true;
+        // whether buf starts at a member boundary
+        bool candidate = true;
+        while (bgzf) {
+            size_t xlen = 0, block = 0;
+            if (fill(pos + gzip_header_size + 2))
+                xlen = gzip_extra_length(buf.data() + pos);
+            if (xlen != 0 && fill(pos + gzip_header_size + 2 + xlen))
+                block = bgzf_block_size(buf.data() + pos);
+            if (block == 0 || !fill(pos + block)) {
+                // no BGZF block at pos: continue with plain gzip members
+                bgzf = false;
+                break;
+            }
+            pos += block;
+            if (pos >= span_size_) {
+                if (!cut(pos, true))
+                    return;
+                pos = 0;
+            }
+        }
+
+        // plain gzip: cut spans at candidate member headers
+        while (fill(1)) {
+            fill(4 * span_size_);
+            size_t size = buf.size();
+            bool next_candidate = false;
+            size_t i = std::max(pos, span_size_);
+            while (i + gzip_header_size <= buf.size()) {
+                const uint8_t* p = static_cast<const uint8_t*>(
+                    std::memchr(buf.data() + i, 0x1F,
+                                buf.size() - gzip_header_size + 1 - i));
+                if (p == nullptr)
+                    break;
+                i = p - buf.data();
+                if (is_gzip_header(p)) {
+                    size = i, next_candidate = true;
+                    break;
+                }
+                ++i;
+            }
+            if (!cut(size, candidate))
+                return;
+            pos = 0;
+            candidate = next_candidate;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        reader_done_ = true;
+        cv_.notify_all();
+    }
+    catch (std::exception& e) {
+        fail(e.what());
+    }
+}
+
+void ParallelGzipStreambuf::worker() {
+    try {
+        while (true) {
+            Span* span;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() {
+                             return stop_ || reader_done_ ||
+                             spans_next_ < spans_front_ + spans_.size();
+                         });
+                if (stop_)
+                    return;
+                if (spans_next_ >= spans_front_ + spans_.size())
+                    return;
+                span = spans_[spans_next_ - spans_front_].get();
+                ++spans_next_;
+            }
+
+            bool ok = span->candidate && inflate_members(span->data, span->output);
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            span->ok = ok;
+            span->done = true;
+            cv_.notify_all();
+        }
+    }
+    catch (std::exception& e) {
+        fail(e.what());
+    }
+}
+
+void ParallelGzipStreambuf::sequencer() {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        fail("inflateInit2 failed");
+        std::unique_lock<std::mutex> lock(mutex_);
+        sequencer_done_ = true;
+        cv_.notify_all();
+        return;
+    }
+
+    // whether the sequential inflater is inside a member
+    bool in_member = false;
+    // whether non-gzip data follows the last member
+    bool trailing = false;
+
+    std::vector<char> chunk;
+    size_t chunk_pos = 0;
+
+    try {
+        while (true) {
+            Span* span;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() {
+                             return stop_ || (reader_done_ && spans_.empty()) ||
+                             (!spans_.empty() && spans_.front()->done);
+                         });
+                if (stop_ || spans_.empty())
+                    break;
+                span = spans_.front().get();
+            }
+
+            if (trailing) {
+                // skip remaining input
+            }
+            else if (!in_member && span->ok) {
+                // speculation succeeded: the span starts at a member boundary
+                if (!push_chunk(std::move(span->output)))
+                    break;
+            }
+            else {
+                // inflate span sequentially, continuing the previous member
+                zs.next_in = span->data.data();
+                zs.avail_in = static_cast<uInt>(span->data.size());
+                bool full = false;
+                while (zs.avail_in > 0 || full) {
+                    if (!in_member) {
+                        if (zs.avail_in == 0)
+                            break;
+                        if (zs.next_in[0] != 0x1F ||
+                            (zs.avail_in >= 2 && zs.next_in[1] != 0x8B)) {
+                            LOG1 << "ParallelGzipStreambuf: "
+                                 << "trailing garbage ignored";
+                            trailing = true;
+                            break;
+                        }
+                        inflateReset(&zs);
+                        in_member = true;
+                    }
+                    if (chunk.empty())
+                        chunk.resize(sequential_chunk_size);
+                    zs.next_out = reinterpret_cast<Bytef*>(
+                        chunk.data() + chunk_pos);
+                    zs.avail_out = static_cast<uInt>(chunk.size() - chunk_pos);
+                    int r = inflate(&zs, Z_NO_FLUSH);
+                    chunk_pos = chunk.size() - zs.avail_out;
+                    full = (zs.avail_out == 0);
+                    if (r == Z_STREAM_END) {
+                        in_member = false;
+                    }
+                    else if (r != Z_OK && r != Z_BUF_ERROR) {
+                        die("gzip data error: " << (zs.msg ? zs.msg : "unknown"));
+                    }
+                    if (full) {
+                        if (!push_chunk(std::move(chunk)))
+                            break;
+                        chunk.clear(), chunk_pos = 0;
+                    }
+                }
+                // deliver partial chunk to keep the order with accepted spans
+                chunk.resize(chunk_pos);
+                if (!push_chunk(std::move(chunk)))
+                    break;
+                chunk.clear(), chunk_pos = 0;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            spans_.pop_front();
+            ++spans_front_;
+            cv_.notify_all();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!stop_ && in_member)
+            die("unexpected end of gzip stream");
+    }
+    catch (std::exception& e) {
+        fail(e.what());
+    }
+    inflateEnd(&zs);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    sequencer_done_ = true;
+    cv_.notify_all();
+}
+
+} // namespace cobs
+
+/******************************************************************************/
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * cobs/util/parallel_gzip.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_PARALLEL_GZIP_HEADER
+#define COBS_UTIL_PARALLEL_GZIP_HEADER
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cobs {
+
+/*!
+ * Stream buffer which decompresses a gzip stream using helper threads.
+ *
+ * A reader thread cuts the compressed input into spans which start at gzip
+ * member boundaries. For BGZF files, as written by bgzip and samtools, the
+ * boundaries are exact since each block header contains its size. For other
+ * gzip files, spans start at candidate member headers found by scanning the
+ * input. Worker threads speculatively inflate spans independently, and a
+ * sequencer thread accepts a span's output only if the previous member ended
+ * exactly at its start, otherwise it inflates the span sequentially. Single
+ * member files are hence inflated by the sequencer, which still overlaps
+ * decompression with parsing.
+ *
+ * Decompressed chunks are passed in order through a bounded queue, such that
+ * memory is limited to a few spans per thread. With zero threads, the stream
+ * is inflated inline by the reading thread, without any helper threads.
+ */
+class ParallelGzipStreambuf : public std::streambuf
+{
+public:
+    //! start decompressing the gzip stream is using num_threads workers,
+    //! spans are cut at member boundaries after about span_size bytes. If
+    //! num_threads is zero, the stream is inflated inline in underflow().
+    ParallelGzipStreambuf(std::istream& is, unsigned num_threads,
+                          size_t span_size = 1024 * 1024);
+
+    //! non-copyable: delete copy-constructor
+    ParallelGzipStreambuf(const ParallelGzipStreambuf&) = delete;
+    //! non-copyable: delete assignment operator
+    ParallelGzipStreambuf& operator = (const ParallelGzipStreambuf&) = delete;
+
+    //! stop and join all helper threads
+    ~ParallelGzipStreambuf();
+
+protected:
+    int_type underflow() final;
+
+private:
+    //! compressed span of the input and its speculative output
+    struct Span {
+        std::vector<uint8_t> data;
+        //! true if data starts with a (possibly false) member header
+        bool candidate;
+        //! true if a worker finished the span
+        bool done = false;
+        //! true if the span inflated to complete members
+        bool ok = false;
+        //! decompressed data if ok
+        std::vector<char> output;
+    };
+
+    //! input stream of compressed data
+    std::istream& is_;
+    //! minimum compressed span size
+    size_t span_size_;
+    //! maximum number of spans and output chunks in flight
+    size_t max_spans_, max_chunks_;
+
+    //! mutex protecting all following fields
+    std::mutex mutex_;
+    //! condition variable signaled on all state changes
+    std::condition_variable cv_;
+    //! spans in input order, front is the next span for the sequencer
+    std::deque<std::unique_ptr<Span> > spans_;
+    //! number of spans popped from the front of spans_
+    uint64_t spans_front_ = 0;
+    //! index of next span to inflate speculatively
+    uint64_t spans_next_ = 0;
+    //! decompressed chunks in output order
+    std::deque<std::vector<char> > chunks_;
+    //! flags set when the reader or the sequencer are finished
+    bool reader_done_ = false, sequencer_done_ = false;
+    //! flag to stop all threads
+    bool stop_ = false;
+    //! error message of a failed helper thread
+    std::string error_;
+
+    //! chunk currently used as get area
+    std::vector<char> current_;
+
+    //! helper threads
+    std::vector<std::thread> threads_;
+
+    //! state of inline inflation, if there are no helper threads
+    struct Inline;
+    std::unique_ptr<Inline> inline_;
+    //! inflate the next chunk into current_ on the calling thread, returns
+    //! false at the end of the stream.
+    bool inflate_inline();
+
+    //! reader thread: cut input into spans
+    void reader();
+    //! worker thread: inflate spans speculatively
+    void worker();
+    //! sequencer thread: validate spans and deliver chunks in order
+    void sequencer();
+
+    //! append a span, blocks while too many spans are in flight. Returns false
+    //! if the threads are stopping.
+    bool push_span(std::vector<uint8_t>&& data, bool candidate);
+    //! append a decompressed chunk, blocks while the queue is full. Returns
+    //! false if the threads are stopping.
+    bool push_chunk(std::vector<char>&& chunk);
+    //! record error of a helper thread and stop all threads
+    void fail(const std::string& error);
+};
+
+//! input stream decompressing a gzip stream using ParallelGzipStreambuf
+class ParallelGzipIstream : public std::istream
+{
+public:
+    ParallelGzipIstream(std::istream& is, unsigned num_threads,
+                        size_t span_size = 1024 * 1024)
+        : std::istream(nullptr), buf_(is, num_threads, span_size) {
+        rdbuf(&buf_);
+    }
+
+private:
+    ParallelGzipStreambuf buf_;
+};
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_PARALLEL_GZIP_HEADER
+
+/******************************************************************************/
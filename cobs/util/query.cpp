@@ -9,6 +9,7 @@
 #include <cobs/settings.hpp>
 #include <cobs/util/error_handling.hpp>
 #include <cobs/util/fs.hpp>
+#include <cobs/util/numa.hpp>
 #include <cobs/util/query.hpp>
 
 #include <algorithm>
@@ -38,11 +39,16 @@ void close_file(int fd) {
 }
 
 MMapHandle initialize_mmap(const fs::path& path)
+{
+    return initialize_mmap(path, gopt_load_complete_index);
+}
+
+MMapHandle initialize_mmap(const fs::path& path, bool load_complete)
 {
     int fd = open_file(path, O_RDONLY);
     off_t size = lseek(fd, 0, SEEK_END);
 
-    if (!gopt_load_complete_index) {
+    if (!load_complete) {
         void* mmap_ptr = mmap(nullptr, size, PROT_READ,
                               MAP_PRIVATE, fd, /* offset */ 0);
         if (mmap_ptr == MAP_FAILED) {
@@ -52,7 +58,8 @@ MMapHandle initialize_mmap(const fs::path& path)
             print_errno("madvise failed for MADV_RANDOM");
         }
         return MMapHandle {
-                   fd, reinterpret_cast<uint8_t*>(mmap_ptr), uint64_t(size)
+                   fd, reinterpret_cast<uint8_t*>(mmap_ptr), uint64_t(size),
+                   /* allocated */ false
         };
     }
     else {
@@ -62,6 +69,10 @@ MMapHandle initialize_mmap(const fs::path& path)
             print_errno("posix_memalign()");
         }
         uint8_t* data_ptr = reinterpret_cast<uint8_t*>(ptr);
+        // spread pages over NUMA nodes before the read below touches them,
+        // index files which partition by score range do not load here.
+        if (gopt_numa_policy != NumaPolicy::FirstTouch)
+            numa_interleave(data_ptr, size);
 #if defined(MADV_HUGEPAGE)
         if (madvise(data_ptr, size, MADV_HUGEPAGE)) {
             print_errno("madvise failed for MADV_HUGEPAGE");
@@ -85,7 +96,7 @@ MMapHandle initialize_mmap(const fs::path& path)
         }
         LOG1 << "Index loaded into RAM.";
         return MMapHandle {
-                   fd, data_ptr, uint64_t(size)
+                   fd, data_ptr, uint64_t(size), /* allocated */ true
         };
     }
 }
@@ -123,13 +134,14 @@ MMapHandle initialize_stream(std::ifstream& is, int64_t index_file_size)
   }
   LOG1 << "Index loaded into RAM.";
   return MMapHandle {
-    -1 /* not a valid fd, won't be closed */, reinterpret_cast<uint8_t*>(data_ptr), uint64_t(size)
+    -1 /* not a valid fd, won't be closed */, reinterpret_cast<uint8_t*>(data_ptr), uint64_t(size),
+    /* allocated */ true
   };
 }
 
 void destroy_mmap(MMapHandle& handle)
 {
-    if (!gopt_load_complete_index) {
+    if (!handle.allocated) {
         if (munmap(handle.data, handle.size)) {
             print_errno("could not unmap index file");
         }
@@ -140,6 +152,16 @@ void destroy_mmap(MMapHandle& handle)
     close_file(handle.fd);
 }
 
+std::shared_ptr<MMapHandle> share_mmap(const MMapHandle& handle)
+{
+    return std::shared_ptr<MMapHandle>(
+        new MMapHandle(handle),
+        [](MMapHandle* h) {
+            destroy_mmap(*h);
+            delete h;
+        });
+}
+
 //! forward character map. A -> A, C -> C, G -> G, T -> T. rest also maps to A to handle non-ACGT bases and not error out.
 static const char canonicalize_basepair_forward_map[256] = {
     65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
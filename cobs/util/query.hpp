@@ -12,6 +12,7 @@
 #include <cstdint>
 #include <cstring>
 #include <fcntl.h>
+#include <memory>
 #include <sys/mman.h>
 #include <utility>
 
@@ -27,12 +28,21 @@ struct MMapHandle {
     int fd;
     uint8_t* data;
     uint64_t size;
+    //! true if data was allocated and read instead of memory mapped
+    bool allocated;
 };
 
+//! memory map file, or read it into RAM if load_complete is true.
+MMapHandle initialize_mmap(const fs::path& path, bool load_complete);
+//! memory map file, or read it into RAM if gopt_load_complete_index is set.
 MMapHandle initialize_mmap(const fs::path& path);
 MMapHandle initialize_stream(std::ifstream& is, int64_t index_file_size);
 void destroy_mmap(MMapHandle& handle);
 
+//! wrap handle into a shared_ptr which calls destroy_mmap() when the last
+//! reference is released, e.g. for index files sharing one mapping.
+std::shared_ptr<MMapHandle> share_mmap(const MMapHandle& handle);
+
 //! Canonicalize a k-mer. Given an input k-mer of length size, checks if should
 //! be canonicalized into its reverse complement. If any letter other than ACGT
 //! occurs, the letter is replaced with a binary zero, and the function returns
@@ -0,0 +1,218 @@
+/*******************************************************************************
+ * cobs/util/rolling_kmer.hpp
+ *
+ * Copyright (c) 2019 Timo Bingmann
+ *
+ * All rights reserved. Published under the MIT License in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef COBS_UTIL_ROLLING_KMER_HEADER
+#define COBS_UTIL_ROLLING_KMER_HEADER
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <tlx/container/string_view.hpp>
+#include <tlx/die.hpp>
+
+namespace cobs {
+
+//! 2-bit code of a base: A = 0, C = 1, G = 2, T = 3. All other characters map
+//! to A, like in canonicalize_kmer().
+extern const uint8_t rolling_base_code[256];
+//! one for all characters other than A, C, G, T.
+extern const uint8_t rolling_base_invalid[256];
+
+//! extra space in the reverse complement buffer, which is moved once for every
+//! this many bases.
+static constexpr uint64_t rolling_buffer_size = 4096;
+
+/*!
+ * Rolling canonicalization of the overlapping k-mers of a sequence. The
+ * forward and reverse complement k-mers are kept as 2-bit words, which are
+ * updated in O(1) per base and compared as integers to pick the canonical
+ * form. The result is the same text as produced by canonicalize_kmer(), hence
+ * hashes and existing indices are unchanged. Like it, k-mers of odd length
+ * which differ from their reverse complement only in the middle base are kept
+ * as they are. The result points either into the input or into a buffer, in
+ * which the reverse complement is written backwards one character per base.
+ * Words are only used for k <= 32, longer k-mers are compared as text.
+ *
+ * A term starting one character after the previous term is taken as its
+ * continuation, hence the characters of the previous term must not be
+ * modified in between. Call reset() when the input buffer is refilled.
+ *
+ * K != 0 fixes the term size at compile time, see dispatch_term_size().
+ */
+template <uint64_t K = 0>
+class RollingCanonicalKMer
+{
+    static_assert(K <= 32, "fixed term sizes must fit into a 2-bit word");
+
+public:
+    explicit RollingCanonicalKMer(uint64_t term_size = K)
+        : k_(term_size),
+          mask_(term_size >= 32 ? ~uint64_t(0)
+                : (uint64_t(1) << (2 * term_size)) - 1),
+          rc_shift_(term_size <= 32 ? 2 * (term_size - 1) : 0),
+          cmp_mask_(term_size % 2 == 1 && term_size <= 32
+                    ? ~(uint64_t(3) << (term_size - 1)) : ~uint64_t(0)),
+          rc_text_(rolling_buffer_size + term_size),
+          fw_text_(term_size) {
+        die_unless(term_size != 0);
+        die_unless(K == 0 || term_size == K);
+    }
+
+    //! term size, a constant if K != 0
+    uint64_t term_size() const { return K != 0 ? K : k_; }
+
+    //! forget the previous term, the next one is canonicalized from scratch.
+    void reset() { prev_ = nullptr; }
+
+    //! return canonical form of term[0, term_size). The view is valid until
+    //! the next call or until term is modified.
+    tlx::string_view canonicalize(const char* term) {
+        const uint64_t k = term_size();
+        if (prev_ != nullptr && term == prev_ + 1) {
+            num_invalid_ -= rolling_base_invalid[uint8_t(prev_[0])];
+            push(term[k - 1]);
+        }
+        else {
+            restart(term);
+        }
+        prev_ = term;
+
+        const char* rc = rc_text_.data() + rc_pos_;
+        if (k <= 32) {
+            uint64_t cmp_mask = K != 0 ? fixed_cmp_mask() : cmp_mask_;
+            if ((fw_ & cmp_mask) > (rc_ & cmp_mask)) {
+                word_ = rc_;
+                return tlx::string_view(rc, k);
+            }
+            word_ = fw_;
+            return tlx::string_view(forward_text(term), k);
+        }
+        const char* fw = forward_text(term);
+        return tlx::string_view(
+            std::memcmp(fw, rc, k / 2) <= 0 ? fw : rc, k);
+    }
+
+    //! 2-bit word of the canonical form returned by the last canonicalize(),
+    //! only for term_size <= 32.
+    uint64_t word() const { return word_; }
+
+private:
+    //! term size
+    uint64_t k_;
+    //! 2-bit words of the forward and reverse complement k-mer (k <= 32)
+    uint64_t fw_ = 0, rc_ = 0;
+    //! 2-bit word of the last canonical k-mer
+    uint64_t word_ = 0;
+    //! mask of the forward word and shift of a new reverse complement base
+    uint64_t mask_, rc_shift_;
+    //! mask of the words for comparison, without the middle base if k is odd
+    uint64_t cmp_mask_;
+    //! number of characters other than ACGT in the current k-mer
+    uint64_t num_invalid_ = 0;
+    //! previous term
+    const char* prev_ = nullptr;
+    //! reverse complement text written backwards, the k-mer starts at rc_pos_
+    std::vector<char> rc_text_;
+    uint64_t rc_pos_ = 0;
+    //! forward text with invalid characters replaced
+    std::vector<char> fw_text_;
+
+    //! constant masks and shift for K != 0
+    static constexpr uint64_t fixed_mask() {
+        return K >= 32 ? ~uint64_t(0) : (uint64_t(1) << (2 * K)) - 1;
+    }
+    static constexpr uint64_t fixed_rc_shift() {
+        return K == 0 ? 0 : 2 * (K - 1);
+    }
+    static constexpr uint64_t fixed_cmp_mask() {
+        return K % 2 == 1 ? ~(uint64_t(3) << (K - 1)) : ~uint64_t(0);
+    }
+
+    //! append a base to the k-mer
+    void push(char c) {
+        const uint64_t k = term_size();
+        uint8_t x = static_cast<uint8_t>(c);
+        uint64_t code = rolling_base_code[x];
+        num_invalid_ += rolling_base_invalid[x];
+        uint64_t mask = K != 0 ? fixed_mask() : mask_;
+        uint64_t rc_shift = K != 0 ? fixed_rc_shift() : rc_shift_;
+        fw_ = ((fw_ << 2) | code) & mask;
+        rc_ = (rc_ >> 2) | ((3 - code) << rc_shift);
+        if (rc_pos_ == 0) {
+            // keep the last k-1 characters and continue from the end
+            std::memmove(rc_text_.data() + rc_text_.size() - (k - 1),
+                         rc_text_.data(), k - 1);
+            rc_pos_ = rc_text_.size() - (k - 1);
+        }
+        rc_text_[--rc_pos_] = "TGCA"[code];
+    }
+
+    //! canonicalize term without using the previous one
+    void restart(const char* term) {
+        fw_ = rc_ = 0;
+        num_invalid_ = 0;
+        rc_pos_ = rc_text_.size();
+        for (uint64_t i = 0; i < term_size(); ++i)
+            push(term[i]);
+    }
+
+    //! forward k-mer text, which is the term itself if it is valid
+    const char * forward_text(const char* term) {
+        if (num_invalid_ == 0)
+            return term;
+        for (uint64_t i = 0; i < term_size(); ++i)
+            fw_text_[i] = "ACGT"[rolling_base_code[uint8_t(term[i])]];
+        return fw_text_.data();
+    }
+};
+
+/*!
+ * Canonical form of a k-mer given as forward 2-bit word with k <= 32, chosen
+ * by the same rule as RollingCanonicalKMer::word(). The reverse complement is
+ * computed by complementing, reversing the 2-bit groups and shifting.
+ */
+static inline
+uint64_t canonical_word(uint64_t fw, uint64_t k) {
+    uint64_t rc = ~fw;
+    rc = ((rc >> 2) & 0x3333333333333333llu)
+         | ((rc & 0x3333333333333333llu) << 2);
+    rc = ((rc >> 4) & 0x0F0F0F0F0F0F0F0Fllu)
+         | ((rc & 0x0F0F0F0F0F0F0F0Fllu) << 4);
+    rc = __builtin_bswap64(rc) >> (64 - 2 * k);
+    uint64_t cmp_mask =
+        k % 2 == 1 ? ~(uint64_t(3) << (k - 1)) : ~uint64_t(0);
+    return (fw & cmp_mask) > (rc & cmp_mask) ? rc : fw;
+}
+
+/*!
+ * Calls functor with std::integral_constant<uint64_t, K> for the commonly used
+ * term sizes K = 31, 25 and 21, such that kernels templated on K use fixed
+ * length loops, masks and hashing, and with K = 0 for all other term sizes.
+ * The dispatch is done once when a construction batch or query starts.
+ */
+template <typename Functor>
+auto dispatch_term_size(uint64_t term_size, Functor functor) {
+    switch (term_size) {
+    case 31:
+        return functor(std::integral_constant<uint64_t, 31>());
+    case 25:
+        return functor(std::integral_constant<uint64_t, 25>());
+    case 21:
+        return functor(std::integral_constant<uint64_t, 21>());
+    default:
+        return functor(std::integral_constant<uint64_t, 0>());
+    }
+}
+
+} // namespace cobs
+
+#endif // !COBS_UTIL_ROLLING_KMER_HEADER
+
+/******************************************************************************/
@@ -208,6 +208,20 @@ PYBIND11_MODULE(cobs_index, m) {
          // essential: keep object alive while iterator exists
          py::keep_alive<0, 1>());
 
+    /**************************************************************************/
+    // HashScheme
+
+    using cobs::HashScheme;
+    py::enum_<HashScheme>(
+        m, "HashScheme", "Enum of hash functions mapping terms to rows")
+    .value("XXH64", HashScheme::XXH64,
+           "one XXH64 per hash function, used by all older indices")
+    .value("XXH3", HashScheme::XXH3,
+           "one XXH3 128-bit hash expanded by double hashing")
+    .value("XXH3_2Bit", HashScheme::XXH3_2Bit,
+           "XXH3 of the canonical k-mer's 2-bit word instead of its text")
+    .export_values();
+
     /**************************************************************************/
     // ClassicIndexParameters
 
@@ -226,6 +240,13 @@ PYBIND11_MODULE(cobs_index, m) {
     .def_readwrite(
         "num_hashes", &ClassicIndexParameters::num_hashes,
         "number of hash functions, provided by user, default 1")
+    .def_readwrite(
+        "block_rows", &ClassicIndexParameters::block_rows,
+        "number of consecutive rows holding all probes of one term "
+        "(blocked Bloom filter), zero for independent rows, default 0")
+    .def_readwrite(
+        "hash_scheme", &ClassicIndexParameters::hash_scheme,
+        "hash functions mapping terms to rows, default XXH64")
     .def_readwrite(
         "false_positive_rate", &ClassicIndexParameters::false_positive_rate,
         "false positive rate, provided by user, default 0.3")
@@ -338,6 +359,13 @@ Construct a COBS Classic Index from a pre-populated DocumentList object.
     .def_readwrite(
         "num_hashes", &CompactIndexParameters::num_hashes,
         "number of hash functions, provided by user, default 1")
+    .def_readwrite(
+        "block_rows", &CompactIndexParameters::block_rows,
+        "number of consecutive rows holding all probes of one term "
+        "(blocked Bloom filter), zero for independent rows, default 0")
+    .def_readwrite(
+        "hash_scheme", &CompactIndexParameters::hash_scheme,
+        "hash functions mapping terms to rows, default XXH64")
     .def_readwrite(
         "false_positive_rate", &CompactIndexParameters::false_positive_rate,
         "false positive rate, provided by user, default 0.3")
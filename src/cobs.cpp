@@ -12,7 +12,9 @@
 #include <cobs/cortex_file.hpp>
 #include <cobs/query/classic_index/mmap_search_file.hpp>
 #include <cobs/query/classic_search.hpp>
+#include <cobs/file/tombstones.hpp>
 #include <cobs/query/compact_index/mmap_search_file.hpp>
+#include <cobs/query/index_manifest.hpp>
 #include <cobs/query/search.hpp>
 #include <cobs/settings.hpp>
 #include <cobs/util/calc_signature_size.hpp>
@@ -24,7 +26,9 @@
 #include <tlx/cmdline_parser.hpp>
 #include <tlx/string.hpp>
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <map>
 #include <random>
 #include <unordered_map>
@@ -41,6 +45,18 @@ static const char* s_help_file_type =
     "\"list\" to read a file list, or "
     "filter documents by file type (any, text, cortex, fasta, fastq, etc)";
 
+static const char* s_help_gzip_threads =
+    "number of threads inflating each gzipped input file, 0 inflates inline, "
+    "default: auto = hardware threads left over by the files read in "
+    "parallel, at most 4";
+
+//! set gopt_gzip_threads from the --gzip-threads option
+static void parse_gzip_threads(const std::string& gzip_threads) {
+    cobs::gopt_gzip_threads =
+        gzip_threads == "auto" ? cobs::gzip_threads_auto
+        : static_cast<unsigned>(std::stoul(gzip_threads));
+}
+
 /******************************************************************************/
 // Document List and Dump
 
@@ -193,6 +209,28 @@ int classic_construct(int argc, char** argv) {
         "number of hash functions, default: "
         + std::to_string(index_params.num_hashes));
 
+    cp.add_size_t(
+        "block-rows", index_params.block_rows,
+        "place all hash probes of a term in a block of this many consecutive "
+        "rows (blocked Bloom filter), one random access per term at a small "
+        "false positive cost, default: 0 = independent rows");
+
+    std::string hash_scheme = "xxh64";
+    cp.add_string(
+        "hash-scheme", hash_scheme,
+        "hash functions mapping terms to rows: xxh64 (one hash per probe), "
+        "xxh3 (one 128-bit hash, double hashing for all probes) or "
+        "xxh3-2bit (xxh3 of the canonical k-mer's 2-bit word, hashes packed "
+        "k-mers of .cobs_doc and Cortex files directly), default: xxh64");
+
+    std::string engine = "scatter";
+    cp.add_string(
+        "engine", engine,
+        "method to fill the bit matrix: scatter (set bits in the shared "
+        "matrix), transpose (per-document Bloom filters transposed in "
+        "8x8 bit blocks) or partition (per-thread bits partitioned by row "
+        "range, each applied by one thread), default: scatter");
+
     cp.add_double(
         'f', "false-positive-rate", index_params.false_positive_rate,
         "false positive rate, default: "
@@ -213,6 +251,21 @@ int classic_construct(int argc, char** argv) {
         "no-canonicalize", no_canonicalize,
         "don't canonicalize DNA k-mers, default: false");
 
+    cp.add_flag(
+        "dedup", index_params.dedup,
+        "skip repeated k-mers of each document before hashing them, "
+        "saves work on high-coverage FASTQ and repetitive assemblies");
+
+    cp.add_unsigned(
+        "min-count", index_params.min_count,
+        "index only k-mers occurring at least this many times in a FASTQ "
+        "document, which drops most sequencing errors, default: 1 = all");
+
+    cp.add_flag(
+        "distinct", index_params.distinct,
+        "size signatures by the distinct k-mers of each document, estimated "
+        "with HyperLogLog and cached, instead of all k-mer positions");
+
     cp.add_flag(
         'C', "clobber", index_params.clobber,
         "erase output directory if it exists");
@@ -229,6 +282,20 @@ int classic_construct(int argc, char** argv) {
         "keep-temporary", index_params.keep_temporary,
         "keep temporary files during construction");
 
+    cp.add_bytes(
+        "align", cobs::gopt_data_alignment,
+        "alignment of the index data in the file, use 2Mi for huge pages, "
+        "default: 4Ki");
+
+    std::string gzip_threads = "auto";
+    cp.add_string(
+        "gzip-threads", gzip_threads, s_help_gzip_threads);
+
+    cp.add_bytes(
+        "gzip-index-span", cobs::gopt_gzip_index_span,
+        "distance of access points in gzip indices of .mfasta.gz files, "
+        "default: 4Mi");
+
     std::string tmp_path;
     cp.add_string(
         "tmp-path", tmp_path,
@@ -239,8 +306,14 @@ int classic_construct(int argc, char** argv) {
 
     cp.print_result(std::cerr);
 
+    // the gzip helper threads are derived from the construction threads
+    cobs::gopt_threads = index_params.num_threads;
+    parse_gzip_threads(gzip_threads);
+
     // bool to uint8_t
     index_params.canonicalize = !no_canonicalize;
+    index_params.hash_scheme = cobs::parse_hash_scheme(hash_scheme);
+    index_params.engine = cobs::parse_classic_engine(engine);
 
     // read file list
     cobs::DocumentList filelist(input, cobs::StringToFileType(file_type));
@@ -331,6 +404,20 @@ int compact_construct(int argc, char** argv) {
         "number of hash functions, default: "
         + std::to_string(index_params.num_hashes));
 
+    cp.add_size_t(
+        "block-rows", index_params.block_rows,
+        "place all hash probes of a term in a block of this many consecutive "
+        "rows (blocked Bloom filter), one random access per term at a small "
+        "false positive cost, default: 0 = independent rows");
+
+    std::string hash_scheme = "xxh64";
+    cp.add_string(
+        "hash-scheme", hash_scheme,
+        "hash functions mapping terms to rows: xxh64 (one hash per probe), "
+        "xxh3 (one 128-bit hash, double hashing for all probes) or "
+        "xxh3-2bit (xxh3 of the canonical k-mer's 2-bit word, hashes packed "
+        "k-mers of .cobs_doc and Cortex files directly), default: xxh64");
+
     cp.add_double(
         'f', "false-positive-rate", index_params.false_positive_rate,
         "false positive rate, default: "
@@ -351,6 +438,26 @@ int compact_construct(int argc, char** argv) {
         "no-canonicalize", no_canonicalize,
         "don't canonicalize DNA k-mers, default: false");
 
+    cp.add_flag(
+        "dedup", index_params.dedup,
+        "skip repeated k-mers of each document before hashing them, "
+        "saves work on high-coverage FASTQ and repetitive assemblies");
+
+    cp.add_unsigned(
+        "min-count", index_params.min_count,
+        "index only k-mers occurring at least this many times in a FASTQ "
+        "document, which drops most sequencing errors, default: 1 = all");
+
+    cp.add_flag(
+        "distinct", index_params.distinct,
+        "size signatures by the distinct k-mers of each document, estimated "
+        "with HyperLogLog and cached, instead of all k-mer positions");
+
+    cp.add_flag(
+        "optimize-pages", index_params.optimize_pages,
+        "order documents into pages to minimize the index size, and choose "
+        "the page size by a query cost model if it is not given");
+
     cp.add_flag(
         'C', "clobber", index_params.clobber,
         "erase output directory if it exists");
@@ -367,6 +474,20 @@ int compact_construct(int argc, char** argv) {
         "keep-temporary", index_params.keep_temporary,
         "keep temporary files during construction");
 
+    cp.add_bytes(
+        "align", cobs::gopt_data_alignment,
+        "alignment of the index data in the file, use 2Mi for huge pages, "
+        "default: 4Ki");
+
+    std::string gzip_threads = "auto";
+    cp.add_string(
+        "gzip-threads", gzip_threads, s_help_gzip_threads);
+
+    cp.add_bytes(
+        "gzip-index-span", cobs::gopt_gzip_index_span,
+        "distance of access points in gzip indices of .mfasta.gz files, "
+        "default: 4Mi");
+
     std::string tmp_path;
     cp.add_string(
         "tmp-path", tmp_path,
@@ -377,8 +498,13 @@ int compact_construct(int argc, char** argv) {
 
     cp.print_result(std::cerr);
 
+    // the gzip helper threads are derived from the construction threads
+    cobs::gopt_threads = index_params.num_threads;
+    parse_gzip_threads(gzip_threads);
+
     // bool to uint8_t
     index_params.canonicalize = !no_canonicalize;
+    index_params.hash_scheme = cobs::parse_hash_scheme(hash_scheme);
 
     // read file list
     cobs::DocumentList filelist(input, cobs::StringToFileType(file_type));
@@ -416,6 +542,130 @@ int compact_construct_combine(int argc, char** argv) {
     return 0;
 }
 
+int compact_merge(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::vector<std::string> in_files;
+    cp.add_param_stringlist(
+        "in-files", in_files, "paths to the compact index files");
+
+    std::string out_file;
+    cp.add_string(
+        'o', "out-file", out_file,
+        "path to the output .cobs_compact file, may be one of the inputs");
+
+    uint64_t mem_bytes = cobs::get_memory_size(80);
+    cp.add_bytes(
+        'm', "memory", mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(mem_bytes));
+
+    cp.add_bytes(
+        "align", cobs::gopt_data_alignment,
+        "alignment of the index data in the file, use 2Mi for huge pages, "
+        "default: 4Ki");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    die_unless(!out_file.empty());
+
+    std::vector<cobs::fs::path> in_paths(in_files.begin(), in_files.end());
+    cobs::compact_merge(in_paths, out_file, mem_bytes);
+
+    return 0;
+}
+
+int classic_to_compact(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    cobs::CompactIndexParameters index_params;
+
+    std::string in_file;
+    cp.add_param_string(
+        "index", in_file, "path to the .cobs_classic index file");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file, "path to the output .cobs_compact index file");
+
+    cp.add_bytes(
+        'm', "memory", index_params.mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(index_params.mem_bytes));
+
+    cp.add_double(
+        'f', "false-positive-rate", index_params.false_positive_rate,
+        "false positive rate of the folded pages, default: "
+        + std::to_string(index_params.false_positive_rate));
+
+    cp.add_unsigned(
+        'p', "page-size", index_params.page_size,
+        "the page size of the compact the index, "
+        "default: sqrt(#documents)");
+
+    cp.add_flag(
+        'C', "clobber", index_params.clobber,
+        "erase output file if it exists");
+
+    cp.add_bytes(
+        "align", cobs::gopt_data_alignment,
+        "alignment of the index data in the file, use 2Mi for huge pages, "
+        "default: 4Ki");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    cobs::classic_to_compact(in_file, out_file, index_params);
+
+    return 0;
+}
+
+int compact_split(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::string in_file;
+    cp.add_param_string(
+        "index", in_file, "path to the .cobs_compact index file");
+
+    std::string out_dir;
+    cp.add_param_string(
+        "out_dir", out_dir, "directory for the shard index files");
+
+    unsigned num_shards = 2;
+    cp.add_unsigned(
+        'n', "shards", num_shards,
+        "number of shards, balanced by size, default: 2");
+
+    uint64_t mem_bytes = cobs::get_memory_size(80);
+    cp.add_bytes(
+        'm', "memory", mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(mem_bytes));
+
+    cp.add_bytes(
+        "align", cobs::gopt_data_alignment,
+        "alignment of the index data in the file, use 2Mi for huge pages, "
+        "default: 4Ki");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    // print the shard paths, they are queried together with -i
+    for (const auto& p : cobs::compact_split(
+             in_file, out_dir, num_shards, mem_bytes)) {
+        std::cout << p.string() << std::endl;
+    }
+
+    return 0;
+}
+
 int classic_combine(int argc, char** argv) {
     tlx::CmdlineParser cp;
 
@@ -468,6 +718,193 @@ int classic_combine(int argc, char** argv) {
 }
 
 /******************************************************************************/
+int classic_append(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    cobs::ClassicIndexParameters index_params;
+
+    std::string in_file;
+    cp.add_param_string(
+        "index", in_file, "path to the existing .cobs_classic index file");
+
+    std::string input;
+    cp.add_param_string(
+        "input", input, "path to the new documents, directory or file");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file,
+        "path to the output .cobs_classic index file, may be the input index");
+
+    std::string file_type = "any";
+    cp.add_string(
+        "file-type", file_type, s_help_file_type);
+
+    cp.add_bytes(
+        'm', "memory", index_params.mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(index_params.mem_bytes));
+
+    cp.add_flag(
+        'C', "clobber", index_params.clobber,
+        "erase output file and temporary directory if they exist");
+
+    cp.add_unsigned(
+        'T', "threads", index_params.num_threads,
+        "number of threads to use, default: max cores");
+
+    cp.add_flag(
+        "keep-temporary", index_params.keep_temporary,
+        "keep temporary files during construction");
+
+    cp.add_bytes(
+        "align", cobs::gopt_data_alignment,
+        "alignment of the index data in the file, use 2Mi for huge pages, "
+        "default: 4Ki");
+
+    std::string gzip_threads = "auto";
+    cp.add_string(
+        "gzip-threads", gzip_threads, s_help_gzip_threads);
+
+    cp.add_bytes(
+        "gzip-index-span", cobs::gopt_gzip_index_span,
+        "distance of access points in gzip indices of .mfasta.gz files, "
+        "default: 4Mi");
+
+    std::string tmp_path;
+    cp.add_string(
+        "tmp-path", tmp_path,
+        "directory for intermediate index files, default: out_file + \".tmp\")");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    // the gzip helper threads are derived from the construction threads
+    cobs::gopt_threads = index_params.num_threads;
+    parse_gzip_threads(gzip_threads);
+
+    // read file list, the term size is taken from the index
+    auto header = cobs::deserialize_header<cobs::ClassicIndexHeader>(in_file);
+    cobs::DocumentList filelist(input, cobs::StringToFileType(file_type));
+    print_document_list(filelist, header.term_size_);
+
+    cobs::classic_append(in_file, filelist, out_file, tmp_path, index_params);
+
+    return 0;
+}
+
+int classic_bundle(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::vector<std::string> in_files;
+    cp.add_param_stringlist(
+        "in-files", in_files, "paths to the classic index files");
+
+    std::string out_file;
+    cp.add_string(
+        'o', "out-file", out_file,
+        "path to the output .cobs_bundle file");
+
+    cp.add_bytes(
+        "align", cobs::gopt_data_alignment,
+        "alignment of the bundled indices, default: 4 KiB");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    die_unless(!out_file.empty());
+
+    std::vector<cobs::fs::path> in_paths(in_files.begin(), in_files.end());
+    cobs::classic_bundle(in_paths, out_file);
+
+    return 0;
+}
+
+/******************************************************************************/
+
+int tombstone(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::string index_file;
+    cp.add_param_string(
+        "index", index_file, "path to the classic or compact index file");
+
+    std::vector<std::string> doc_names;
+    cp.add_param_stringlist(
+        "doc-names", doc_names, "names of the documents to delete");
+
+    bool undelete = false;
+    cp.add_flag(
+        'u', "undelete", undelete,
+        "remove the tombstones of the documents instead");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    auto index = cobs::open_index_file(index_file);
+
+    std::unordered_map<std::string, uint64_t> doc_ids;
+    for (uint64_t i = 0; i < index->num_documents(); ++i)
+        doc_ids.emplace(index->doc_name(i), i);
+
+    // keep the existing tombstones, unless they belong to a different index
+    cobs::Tombstones tombstones;
+    tombstones.load(index_file, index->num_documents());
+
+    for (const std::string& name : doc_names) {
+        auto it = doc_ids.find(name);
+        if (it == doc_ids.end())
+            die("Document \"" << name << "\" not found in index");
+        tombstones.set_deleted(it->second, !undelete);
+    }
+
+    tombstones.save(index_file);
+    std::cerr << "Index has " << tombstones.count() << " of "
+              << tombstones.num_documents() << " documents deleted"
+              << std::endl;
+
+    return 0;
+}
+
+int classic_purge(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    std::string in_file;
+    cp.add_param_string(
+        "index", in_file, "path to the .cobs_classic index file");
+
+    std::string out_file;
+    cp.add_param_string(
+        "out_file", out_file,
+        "path to the output .cobs_classic index file, may be the input index");
+
+    uint64_t mem_bytes = cobs::get_memory_size(80);
+    cp.add_bytes(
+        'm', "memory", mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(mem_bytes));
+
+    cp.add_bytes(
+        "align", cobs::gopt_data_alignment,
+        "alignment of the index data in the file, use 2Mi for huge pages, "
+        "default: 4Ki");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    cobs::classic_purge(in_file, out_file, mem_bytes);
+
+    return 0;
+}
+
 int query(int argc, char** argv) {
     tlx::CmdlineParser cp;
 
@@ -497,10 +934,23 @@ int query(int argc, char** argv) {
         "load-complete", cobs::gopt_load_complete_index,
         "load complete index into RAM for batch queries");
 
+    std::string numa_policy = "first-touch";
+    cp.add_string(
+        "numa", numa_policy,
+        "placement of a loaded index on NUMA machines: first-touch, "
+        "interleave, or partition (score ranges per node, pinned threads), "
+        "default: first-touch");
+
     cp.add_unsigned(
         'T', "threads", cobs::gopt_threads,
         "number of threads to use, default: max cores");
 
+    std::string manifest;
+    cp.add_string(
+        "manifest", manifest,
+        "cache file of index headers (.cobs_manifest) to speed up opening "
+        "many index files, created or updated if necessary");
+
     std::vector<std::string> index_sizes_str;
     cp.add_stringlist(
       "index-sizes", index_sizes_str, "WARNING: HIDDEN OPTION. USE ONLY IF YOU KNOW WHAT YOU ARE DOING. "
@@ -512,6 +962,15 @@ int query(int argc, char** argv) {
     if (!cp.sort().process(argc, argv))
         return -1;
 
+    if (numa_policy == "first-touch")
+        cobs::gopt_numa_policy = cobs::NumaPolicy::FirstTouch;
+    else if (numa_policy == "interleave")
+        cobs::gopt_numa_policy = cobs::NumaPolicy::Interleave;
+    else if (numa_policy == "partition")
+        cobs::gopt_numa_policy = cobs::NumaPolicy::Partition;
+    else
+        die("Unknown NUMA policy \"" << numa_policy << "\"");
+
     std::vector<cobs::fs::path> index_paths;
     for (const std::string &file : index_files) {
         index_paths.push_back(cobs::fs::path(file));
@@ -535,7 +994,7 @@ int query(int argc, char** argv) {
         indices = cobs::get_cobs_indexes_given_streams(streams, index_sizes);
     }
     else {
-        indices = cobs::get_cobs_indexes_given_files(index_paths);
+        indices = cobs::get_cobs_indexes_given_files(index_paths, manifest);
     }
 
     cobs::ClassicSearch s(indices);
@@ -753,6 +1212,111 @@ int benchmark_fpr(int argc, char** argv) {
     return 0;
 }
 
+int benchmark_construct(int argc, char** argv) {
+    tlx::CmdlineParser cp;
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.clobber = true;
+
+    std::string input;
+    cp.add_param_string(
+        "input", input, "path to the input directory or file");
+
+    std::string tmp_path;
+    cp.add_param_string(
+        "tmp_path", tmp_path,
+        "directory in which a temporary subdirectory for the benchmark "
+        "indices is created and removed afterwards");
+
+    std::string file_type = "any";
+    cp.add_string(
+        "file-type", file_type, s_help_file_type);
+
+    cp.add_bytes(
+        'm', "memory", index_params.mem_bytes,
+        "memory in bytes to use, default: " +
+        tlx::format_iec_units(index_params.mem_bytes));
+
+    cp.add_unsigned(
+        'h', "num-hashes", index_params.num_hashes,
+        "number of hash functions, default: "
+        + std::to_string(index_params.num_hashes));
+
+    cp.add_double(
+        'f', "false-positive-rate", index_params.false_positive_rate,
+        "false positive rate, default: "
+        + std::to_string(index_params.false_positive_rate));
+
+    cp.add_unsigned(
+        'k', "term-size", index_params.term_size,
+        "term size (k-mer size), default: "
+        + std::to_string(index_params.term_size));
+
+    cp.add_bytes(
+        's', "sig-size", index_params.signature_size,
+        "signature size, default: "
+        + std::to_string(index_params.signature_size));
+
+    cp.add_unsigned(
+        'T', "threads", index_params.num_threads,
+        "number of threads to use, default: max cores");
+
+    if (!cp.sort().process(argc, argv))
+        return -1;
+
+    cp.print_result(std::cerr);
+
+    cobs::DocumentList filelist(input, cobs::StringToFileType(file_type));
+
+    // work in a fresh subdirectory, tmp_path may contain other files
+    std::default_random_engine rng(std::random_device { } ());
+    cobs::fs::path bench_dir;
+    do {
+        bench_dir = cobs::fs::path(tmp_path) /
+                    ("cobs_benchmark_" + std::to_string(rng() % 1000000));
+    } while (!cobs::fs::create_directories(bench_dir));
+
+    cobs::Timer t;
+    std::vector<cobs::fs::path> out_files;
+    for (const char* engine : { "scatter", "transpose", "partition" }) {
+        index_params.engine = cobs::parse_classic_engine(engine);
+        cobs::fs::path out_file =
+            bench_dir / (std::string(engine) + ".cobs_classic");
+
+        t.active(engine);
+        cobs::classic_construct(
+            filelist, out_file,
+            bench_dir / (std::string(engine) + ".tmp"),
+            index_params);
+        t.stop();
+        out_files.push_back(out_file);
+
+        std::cout << "RESULT"
+                  << " name=benchmark_construct"
+                  << " engine=" << engine
+                  << " documents=" << filelist.size()
+                  << " signature_size=" << index_params.signature_size
+                  << " num_hashes=" << index_params.num_hashes
+                  << " threads=" << index_params.num_threads
+                  << " time=" << t.get(engine)
+                  << std::endl;
+    }
+
+    // all engines must construct the same index
+    for (size_t i = 1; i < out_files.size(); ++i) {
+        std::ifstream is0(out_files[0].string(), std::ios::binary);
+        std::ifstream is1(out_files[i].string(), std::ios::binary);
+        die_unless(std::equal(std::istreambuf_iterator<char>(is0),
+                              std::istreambuf_iterator<char>(),
+                              std::istreambuf_iterator<char>(is1),
+                              std::istreambuf_iterator<char>()));
+    }
+
+    cobs::fs::remove_all(bench_dir);
+
+    return 0;
+}
+
 /******************************************************************************/
 
 int generate_queries(int argc, char** argv) {
@@ -1023,10 +1587,38 @@ struct SubTool subtools[] = {
         "compact-construct-combine", &compact_construct_combine, true,
         "combines the classic indices in <in_dir> to form a compact index"
     },
+    {
+        "compact-merge", &compact_merge, true,
+        "merges compact indices with equal page size into one"
+    },
+    {
+        "classic-to-compact", &classic_to_compact, true,
+        "converts a classic index into a compact index by folding pages"
+    },
+    {
+        "compact-split", &compact_split, true,
+        "splits a compact index into shards along page boundaries"
+    },
     {
             "classic-combine", &classic_combine, true,
             "combines the classic indices in <in_dir>"
     },
+    {
+        "classic-append", &classic_append, true,
+        "appends the documents in <input> to a classic index"
+    },
+    {
+        "classic-bundle", &classic_bundle, true,
+        "packs many classic indices into one index bundle"
+    },
+    {
+        "tombstone", &tombstone, true,
+        "marks documents of an index as deleted for queries"
+    },
+    {
+        "classic-purge", &classic_purge, true,
+        "rewrites a classic index without its deleted documents"
+    },
     {
         "query", &query, true,
         "query an index"
@@ -1043,6 +1635,10 @@ struct SubTool subtools[] = {
         "benchmark-fpr", &benchmark_fpr, true,
         "run benchmark and false positive measurement"
     },
+    {
+        "benchmark-construct", &benchmark_construct, true,
+        "compare the classic index construction engines"
+    },
     {
         "generate-queries", &generate_queries, true,
         "select queries randomly from documents"
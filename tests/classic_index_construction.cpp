@@ -233,6 +233,154 @@ TEST_F(classic_index_construction, combined_index_same_as_classic_constructed) {
     ASSERT_TRUE(compare_files(combined_index.string(), classic_constructed_index));
 }
 
+TEST_F(classic_index_construction, append_same_as_classic_constructed) {
+    // Construct an index of 20 documents, append 13 further documents, and
+    // compare it with the index of all 33 documents built at once using the
+    // same signature size.
+    using cobs::pad_index;
+    fs::create_directories(index_dir);
+    std::string query = cobs::random_sequence(10000, 1);
+    auto documents = generate_documents_all(query, /* num_documents */ 33);
+    std::vector<cobs::KMerBuffer<31> > documents1(
+        documents.begin(), documents.begin() + 20);
+    std::vector<cobs::KMerBuffer<31> > documents2(
+        documents.begin() + 20, documents.end());
+    generate_test_case(documents1, "a_", input_dir / pad_index(0));
+    generate_test_case(documents2, "b_", input_dir / pad_index(1));
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.signature_size = 123457;
+    index_params.mem_bytes = 4096;
+    index_params.num_threads = 1;
+
+    fs::path all_file = index_dir / "all.cobs_classic";
+    cobs::classic_construct(cobs::DocumentList(input_dir), all_file,
+                            tmp_path, index_params);
+
+    fs::path append_file = index_dir / "append.cobs_classic";
+    cobs::classic_construct(cobs::DocumentList(input_dir / pad_index(0)),
+                            append_file, tmp_path, index_params);
+    cobs::classic_append(append_file,
+                         cobs::DocumentList(input_dir / pad_index(1)),
+                         append_file, tmp_path, index_params);
+
+    auto header = cobs::deserialize_header<cobs::ClassicIndexHeader>(
+        append_file);
+    ASSERT_EQ(33u, header.file_names_.size());
+    ASSERT_EQ("a_document_000000", header.file_names_[0]);
+    ASSERT_EQ("b_document_000000", header.file_names_[20]);
+    ASSERT_TRUE(compare_files(all_file.string(), append_file.string()));
+}
+
+TEST_F(classic_index_construction, split_documents_same_as_unsplit) {
+    // Large documents are split into byte ranges processed as separate work
+    // items, which must produce the same index as processing them whole.
+    fs::create_directories(index_dir);
+    for (const char* dir : { "data/fasta", "data/fastq" }) {
+        cobs::ClassicIndexParameters index_params;
+        index_params.num_hashes = 3;
+        index_params.signature_size = 12345;
+        // ranges are at least a quarter of the total size per thread, many
+        // threads let them drop to about 100 bytes, such that the larger
+        // FASTA and FASTQ documents of a few KiB are split
+        index_params.num_threads = 16;
+
+        fs::path whole_file = index_dir / "whole.cobs_classic";
+        cobs::classic_construct(cobs::DocumentList(dir), whole_file,
+                                tmp_path, index_params);
+
+        index_params.split_size = 1;
+        fs::path split_file = index_dir / "split.cobs_classic";
+        cobs::classic_construct(cobs::DocumentList(dir), split_file,
+                                tmp_path, index_params);
+
+        ASSERT_TRUE(compare_files(whole_file.string(), split_file.string()));
+        fs::remove(whole_file);
+        fs::remove(split_file);
+    }
+}
+
+TEST_F(classic_index_construction, transpose_engine_same_as_scatter) {
+    // per-document Bloom filters transposed into the matrix must produce the
+    // same index as setting the bits in the matrix directly.
+    std::string query = cobs::random_sequence(10000, 1);
+    auto documents = generate_documents_all(query, /* num_documents */ 37);
+    generate_test_case(documents, input_dir.string());
+    fs::create_directories(index_dir);
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.signature_size = 12347;
+    index_params.num_threads = 1;
+
+    fs::path scatter_file = index_dir / "scatter.cobs_classic";
+    cobs::classic_construct(cobs::DocumentList(input_dir), scatter_file,
+                            tmp_path, index_params);
+
+    index_params.engine = cobs::ClassicEngine::Transpose;
+    fs::path transpose_file = index_dir / "transpose.cobs_classic";
+    cobs::classic_construct(cobs::DocumentList(input_dir), transpose_file,
+                            tmp_path, index_params);
+
+    ASSERT_TRUE(compare_files(scatter_file.string(), transpose_file.string()));
+}
+
+TEST_F(classic_index_construction, partition_engine_same_as_scatter) {
+    // bits partitioned by row range and applied by the owner threads must
+    // produce the same index as setting them in the matrix directly.
+    std::string query = cobs::random_sequence(10000, 1);
+    auto documents = generate_documents_all(query, /* num_documents */ 37);
+    generate_test_case(documents, input_dir.string());
+    fs::create_directories(index_dir);
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.signature_size = 12347;
+    index_params.num_threads = 1;
+
+    fs::path scatter_file = index_dir / "scatter.cobs_classic";
+    cobs::classic_construct(cobs::DocumentList(input_dir), scatter_file,
+                            tmp_path, index_params);
+
+    // several threads with row ranges of one row and many exchange rounds
+    index_params.engine = cobs::ClassicEngine::Partition;
+    index_params.num_threads = 3;
+    index_params.slice_size = 1;
+    index_params.partition_buffer = 1000;
+    fs::path partition_file = index_dir / "partition.cobs_classic";
+    cobs::classic_construct(cobs::DocumentList(input_dir), partition_file,
+                            tmp_path, index_params);
+
+    ASSERT_TRUE(compare_files(scatter_file.string(), partition_file.string()));
+}
+
+TEST_F(classic_index_construction, dedup_same_as_without) {
+    // skipping repeated k-mers of documents must not change the index
+    fs::create_directories(index_dir);
+    for (cobs::ClassicEngine engine :
+         { cobs::ClassicEngine::Scatter, cobs::ClassicEngine::Transpose }) {
+        cobs::ClassicIndexParameters index_params;
+        index_params.num_hashes = 3;
+        index_params.signature_size = 12345;
+        index_params.num_threads = 1;
+        index_params.engine = engine;
+
+        fs::path plain_file = index_dir / "plain.cobs_classic";
+        cobs::classic_construct(cobs::DocumentList("data/fastq"), plain_file,
+                                tmp_path, index_params);
+
+        index_params.dedup = true;
+        fs::path dedup_file = index_dir / "dedup.cobs_classic";
+        cobs::classic_construct(cobs::DocumentList("data/fastq"), dedup_file,
+                                tmp_path, index_params);
+
+        ASSERT_TRUE(compare_files(plain_file.string(), dedup_file.string()));
+        fs::remove(plain_file);
+        fs::remove(dedup_file);
+    }
+}
+
 TEST_F(classic_index_construction, same_documents_combined_into_same_index) {
     // This test starts with 18 copies of the same randomly generated document.
     // These documents are split in 4 groups: g1 with 1 copy, g2 with 2 copies,
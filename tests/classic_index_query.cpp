@@ -7,10 +7,15 @@
  ******************************************************************************/
 
 #include "test_util.hpp"
+#include <cobs/file/tombstones.hpp>
 #include <cobs/query/classic_index/mmap_search_file.hpp>
+#include <cobs/query/index_manifest.hpp>
 #include <cobs/util/calc_signature_size.hpp>
+#include <cobs/util/numa.hpp>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <set>
+#include <tlx/die.hpp>
 
 namespace fs = cobs::fs;
 
@@ -196,4 +201,333 @@ TEST_F(classic_index_query, one_included_large_batch_multi_index) {
     }
 }
 
+TEST_F(classic_index_query, multi_index_manifest) {
+    // construct classic index and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    // generate index 1 and 2
+    auto documents1 = generate_documents_one(query, /* documents */ 33);
+    generate_test_case(documents1, input1_dir.string());
+    cobs::classic_construct(
+        cobs::DocumentList(input1_dir), index1_path, tmp_path, index_params);
+
+    auto documents2 = generate_documents_one(query, /* documents */ 44);
+    generate_test_case(documents2, input2_dir.string());
+    cobs::classic_construct(
+        cobs::DocumentList(input2_dir), index2_path, tmp_path, index_params);
+
+    std::vector<fs::path> paths = { index1_path, index2_path };
+    fs::path manifest_path = base_dir / "index.cobs_manifest";
+
+    // first open reads headers and writes manifest
+    std::vector<cobs::SearchResult> result1;
+    cobs::ClassicSearch s_files(
+        cobs::get_cobs_indexes_given_files(paths, manifest_path));
+    s_files.search(query, result1);
+    ASSERT_TRUE(fs::exists(manifest_path));
+
+    cobs::IndexManifest manifest;
+    ASSERT_TRUE(manifest.load(manifest_path));
+    ASSERT_EQ(2u, manifest.size());
+    ASSERT_TRUE(manifest.lookup(index1_path) != nullptr);
+
+    // second open uses manifest
+    std::vector<cobs::SearchResult> result2;
+    cobs::ClassicSearch s_base(
+        cobs::get_cobs_indexes_given_files(paths, manifest_path));
+    s_base.search(query, result2);
+
+    ASSERT_EQ(33u + 44u, result1.size());
+    ASSERT_EQ(result1.size(), result2.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result1[i].doc_name), result2[i].doc_name);
+        ASSERT_EQ(result1[i].score, result2[i].score);
+    }
+}
+
+TEST_F(classic_index_query, index_bundle) {
+    // construct classic index and mmap query
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    // generate three indices, the second one needs several score batches
+    std::vector<size_t> num_documents = { 13, 200, 5 };
+    std::vector<fs::path> input_dirs = { input1_dir, input2_dir, input3_dir };
+    std::vector<fs::path> paths = { index1_path, index2_path, index3_path };
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto documents = generate_documents_one(query, num_documents[i]);
+        generate_test_case(documents, input_dirs[i].string());
+        cobs::classic_construct(
+            cobs::DocumentList(input_dirs[i]), paths[i], tmp_path,
+            index_params);
+    }
+
+    fs::path bundle_path = base_dir / "index.cobs_bundle";
+    cobs::classic_bundle(paths, bundle_path);
+    ASSERT_EQ(cobs::IndexFileType::Bundle,
+              cobs::identify_index_file(bundle_path));
+
+    std::vector<cobs::SearchResult> result1;
+    cobs::ClassicSearch s_files(cobs::get_cobs_indexes_given_files(paths));
+    s_files.search(query, result1);
+
+    auto indices = cobs::get_cobs_indexes_given_files({ bundle_path });
+    ASSERT_EQ(3u, indices.size());
+    std::vector<cobs::SearchResult> result2;
+    cobs::ClassicSearch s_bundle(indices);
+    s_bundle.search(query, result2);
+
+    ASSERT_EQ(13u + 200u + 5u, result1.size());
+    ASSERT_EQ(result1.size(), result2.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result1[i].doc_name), result2[i].doc_name);
+        ASSERT_EQ(result1[i].score, result2[i].score);
+    }
+}
+
+TEST_F(classic_index_query, numa_partition) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 500);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+
+    std::vector<cobs::SearchResult> result1;
+    cobs::ClassicSearch s_mmap(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+    s_mmap.search(query, result1);
+
+    // load the index partitioned by score range, which falls back to a plain
+    // loaded index on machines with one NUMA node
+    cobs::gopt_load_complete_index = true;
+    cobs::gopt_numa_policy = cobs::NumaPolicy::Partition;
+    std::vector<cobs::SearchResult> result2;
+    cobs::ClassicSearch s_numa(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+    s_numa.search(query, result2);
+    cobs::gopt_load_complete_index = false;
+    cobs::gopt_numa_policy = cobs::NumaPolicy::FirstTouch;
+
+    ASSERT_EQ(documents.size(), result1.size());
+    ASSERT_EQ(result1.size(), result2.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result1[i].doc_name), result2[i].doc_name);
+        ASSERT_EQ(result1[i].score, result2[i].score);
+    }
+
+    // place the index on three simulated nodes: 63 bytes per row are split
+    // into column blocks at multiples of 16 bytes.
+    cobs::numa_simulate_nodes(3);
+    cobs::gopt_load_complete_index = true;
+    cobs::gopt_numa_policy = cobs::NumaPolicy::Partition;
+    auto numa_file =
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path);
+    std::vector<cobs::SearchResult> result3;
+    cobs::ClassicSearch s_nodes(numa_file);
+    s_nodes.search(query, result3);
+    cobs::gopt_load_complete_index = false;
+    cobs::gopt_numa_policy = cobs::NumaPolicy::FirstTouch;
+    cobs::numa_simulate_nodes(0);
+
+    ASSERT_EQ(std::vector<uint64_t>({ 0, 8 * 32, 8 * 48, 8 * 63 }),
+              numa_file->numa_bounds());
+    ASSERT_EQ(result1.size(), result3.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result1[i].doc_name), result3[i].doc_name);
+        ASSERT_EQ(result1[i].score, result3[i].score);
+    }
+}
+
+TEST_F(classic_index_query, tombstones_and_purge) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 2000);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+
+    // delete a leading range, which skips whole batches, and scattered ones
+    auto index = cobs::open_index_file(index_path);
+    cobs::Tombstones tombstones(index->num_documents());
+    std::set<std::string> deleted;
+    for (uint64_t i = 0; i < index->num_documents(); ++i) {
+        if (i < 1000 || i % 7 == 0) {
+            tombstones.set_deleted(i);
+            deleted.insert(index->doc_name(i));
+        }
+    }
+    tombstones.save(index_path);
+
+    std::vector<cobs::SearchResult> result1;
+    cobs::ClassicSearch s_tomb(index_path.string());
+    s_tomb.search(query, result1);
+    ASSERT_EQ(documents.size() - deleted.size(), result1.size());
+    for (auto& r : result1) {
+        ASSERT_EQ(deleted.count(r.doc_name), 0u);
+        ASSERT_EQ(r.score, 1);
+    }
+
+    // rewrite the index without the deleted documents
+    fs::path purged_path = base_dir / "purged.cobs_classic";
+    cobs::classic_purge(index_path, purged_path, 1024 * 1024);
+
+    std::vector<cobs::SearchResult> result2;
+    cobs::ClassicSearch s_purged(purged_path.string());
+    s_purged.search(query, result2);
+    ASSERT_EQ(result1.size(), result2.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result1[i].doc_name), result2[i].doc_name);
+        ASSERT_EQ(result1[i].score, result2[i].score);
+    }
+
+    // a sidecar of another index is ignored
+    fs::copy_file(cobs::Tombstones::sidecar_path(index_path),
+                  cobs::Tombstones::sidecar_path(purged_path));
+    std::vector<cobs::SearchResult> result3;
+    cobs::ClassicSearch s_other(purged_path.string());
+    s_other.search(query, result3);
+    ASSERT_EQ(result2.size(), result3.size());
+
+    // as is the sidecar of a rebuilt index with the same documents
+    index_params.num_hashes = 2;
+    index_params.clobber = true;
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    std::vector<cobs::SearchResult> result4;
+    cobs::ClassicSearch s_rebuilt(index_path.string());
+    s_rebuilt.search(query, result4);
+    ASSERT_EQ(documents.size(), result4.size());
+}
+
+TEST_F(classic_index_query, blocked_bloom) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index with all probes of a term in 16 rows
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.block_rows = 16;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    auto header = cobs::deserialize_header<cobs::ClassicIndexHeader>(index_path);
+    ASSERT_EQ(16u, header.block_rows_);
+    ASSERT_EQ(0u, header.signature_size_ % 16);
+
+    cobs::ClassicSearch s_base(index_path.string());
+
+    // execute query and check results, the blocked filter has no false
+    // negatives
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(documents.size(), result.size());
+    for (auto& r : result) {
+        std::string doc = r.doc_name;
+        int index = std::stoi(doc.substr(doc.size() - 2));
+        ASSERT_GE(r.score, documents[index].data().size());
+    }
+}
+
+TEST_F(classic_index_query, xxh3_hash_scheme) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index using XXH3 double hashing
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.hash_scheme = cobs::HashScheme::XXH3;
+    index_params.false_positive_rate = 0.1;
+    index_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+    auto header = cobs::deserialize_header<cobs::ClassicIndexHeader>(index_path);
+    ASSERT_EQ(cobs::HashScheme::XXH3, header.hash_scheme_);
+
+    cobs::ClassicSearch s_base(index_path.string());
+
+    // execute query and check results
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(documents.size(), result.size());
+    for (auto& r : result) {
+        std::string doc = r.doc_name;
+        int index = std::stoi(doc.substr(doc.size() - 2));
+        ASSERT_GE(r.score, documents[index].data().size());
+    }
+}
+
+TEST_F(classic_index_query, xxh3_2bit_hash_scheme) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // the .cobs_doc k-mers are hashed as packed words by all engines, queries
+    // hash the words of the rolling canonicalization
+    for (cobs::ClassicEngine engine :
+         { cobs::ClassicEngine::Scatter, cobs::ClassicEngine::Transpose,
+           cobs::ClassicEngine::Partition }) {
+        cobs::ClassicIndexParameters index_params;
+        index_params.num_hashes = 3;
+        index_params.hash_scheme = cobs::HashScheme::XXH3_2Bit;
+        index_params.false_positive_rate = 0.1;
+        index_params.canonicalize = 1;
+        index_params.engine = engine;
+
+        cobs::error_code ec;
+        fs::remove(index_path, ec);
+        fs::remove_all(tmp_path, ec);
+        cobs::classic_construct(
+            cobs::DocumentList(input_dir), index_path, tmp_path, index_params);
+        auto header =
+            cobs::deserialize_header<cobs::ClassicIndexHeader>(index_path);
+        ASSERT_EQ(cobs::HashScheme::XXH3_2Bit, header.hash_scheme_);
+
+        cobs::ClassicSearch s_base(index_path.string());
+
+        // execute query and check results
+        std::vector<cobs::SearchResult> result;
+        s_base.search(query, result);
+        ASSERT_EQ(documents.size(), result.size());
+        for (auto& r : result) {
+            std::string doc = r.doc_name;
+            int index = std::stoi(doc.substr(doc.size() - 2));
+            ASSERT_GE(r.score, documents[index].data().size());
+        }
+    }
+
+    // the scheme hashes canonical words only
+    cobs::ClassicIndexParameters index_params;
+    index_params.hash_scheme = cobs::HashScheme::XXH3_2Bit;
+    index_params.canonicalize = 0;
+    bool d = tlx::set_die_with_exception(true);
+    ASSERT_THROW(
+        cobs::classic_construct(
+            cobs::DocumentList(input_dir), index_path, tmp_path, index_params),
+        tlx::DieException);
+    tlx::set_die_with_exception(d);
+}
+
 /******************************************************************************/
@@ -7,6 +7,7 @@
  ******************************************************************************/
 
 #include "test_util.hpp"
+#include <cobs/construction/compact_index.hpp>
 #include <cobs/settings.hpp>
 #include <cobs/util/calc_signature_size.hpp>
 #include <cobs/util/file.hpp>
@@ -57,6 +58,32 @@ TEST_F(compact_index_construction, padding) {
     ASSERT_EQ(sp.curr_pos % index_params.page_size, 0U);
 }
 
+TEST_F(compact_index_construction, padding_page_size_not_power_of_two) {
+    // generate
+    auto documents = generate_documents_all(query, /* num_documents */ 200);
+    generate_test_case(documents, input_dir.string());
+
+    // construct compact index with a page size which is not a power of two
+    cobs::CompactIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 1000;
+
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    // only the start of the data is aligned, pages are packed
+    std::ifstream ifs;
+    auto h = cobs::deserialize_header<cobs::CompactIndexHeader>(
+        ifs, index_file);
+    cobs::StreamPos sp = cobs::get_stream_pos(ifs);
+    ASSERT_EQ(sp.curr_pos % h.data_alignment_, 0U);
+    uint64_t data_size = 0;
+    for (const auto& p : h.parameters_)
+        data_size += h.page_size_ * p.signature_size;
+    ASSERT_EQ(sp.curr_pos + data_size, cobs::fs::file_size(index_file));
+}
+
 TEST_F(compact_index_construction, deserialization) {
     // generate
     auto documents = generate_documents_all(query);
@@ -169,4 +196,72 @@ TEST_F(compact_index_construction, deserialization) {
     }
 }
 
+TEST_F(compact_index_construction, partition_pages) {
+    // 8 documents per page, the two smallest form the partial last page
+    std::vector<uint64_t> doc_terms = {
+        50, 10, 90, 30, 70, 20, 80, 60, 40, 100
+    };
+    std::vector<uint64_t> order = cobs::partition_pages(doc_terms, 1);
+    std::vector<uint64_t> terms;
+    for (uint64_t i : order)
+        terms.push_back(doc_terms[i]);
+    ASSERT_EQ(
+        std::vector<uint64_t>({ 30, 40, 50, 60, 70, 80, 90, 100, 10, 20 }),
+        terms);
+
+    // which is smaller than cutting the sorted documents into pages
+    cobs::CompactIndexParameters params;
+    params.false_positive_rate = 0.1;
+    std::vector<uint64_t> sorted = doc_terms;
+    std::sort(sorted.begin(), sorted.end());
+    ASSERT_LT(cobs::compact_index_size(terms, 1, params),
+              cobs::compact_index_size(sorted, 1, params));
+}
+
+TEST_F(compact_index_construction, choose_page_size) {
+    cobs::CompactIndexParameters params;
+    params.false_positive_rate = 0.1;
+    // equal documents: the largest page size without padding overhead, which
+    // puts all 1024 documents into one page.
+    ASSERT_EQ(128u, cobs::choose_page_size(
+                  std::vector<uint64_t>(1024, 10000), params));
+    // a few large documents: the large pages would mix them with small ones
+    std::vector<uint64_t> doc_terms(4096, 1000);
+    for (size_t i = 0; i < 64; ++i)
+        doc_terms[i] = 1000000;
+    ASSERT_EQ(8u, cobs::choose_page_size(doc_terms, params));
+}
+
+TEST_F(compact_index_construction, optimize_pages) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    cobs::CompactIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 2;
+
+    auto index_size = [&](const fs::path& path) {
+        std::vector<std::vector<uint8_t> > data;
+        cobs::CompactIndexHeader h;
+        h.read_file(path, data);
+        EXPECT_EQ(33u, h.file_names_.size());
+        uint64_t size = 0;
+        for (const auto& p : h.parameters_)
+            size += h.page_size_ * p.signature_size;
+        return size;
+    };
+
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+    uint64_t size = index_size(index_file);
+
+    fs::path optimized_file = base_dir / "optimized.cobs_compact";
+    index_params.optimize_pages = true;
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), optimized_file, tmp_path, index_params);
+    ASSERT_LT(index_size(optimized_file), size);
+}
+
 /******************************************************************************/
@@ -7,7 +7,12 @@
  ******************************************************************************/
 
 #include "test_util.hpp"
+#include <cobs/query/index_manifest.hpp>
+#include <cobs/util/numa.hpp>
 #include <gtest/gtest.h>
+#include <tlx/die.hpp>
+#include <map>
+#include <set>
 #ifdef __linux__
 #include <cobs/query/compact_index/aio_search_file.hpp>
 #endif
@@ -180,6 +185,248 @@ TEST_F(compact_index_query, one_included_mmap) {
     }
 }
 
+TEST_F(compact_index_query, numa_partition_mmap) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 2000);
+    generate_test_case(documents, input_dir.string());
+
+    // construct compact index
+    cobs::CompactIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 8;
+    index_params.canonicalize = 1;
+
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    std::vector<cobs::SearchResult> result1;
+    cobs::ClassicSearch s_mmap(
+        std::make_shared<cobs::CompactIndexMMapSearchFile>(index_file));
+    s_mmap.search(query, result1);
+
+    // load the index partitioned by page ranges, which falls back to a plain
+    // loaded index on machines with one NUMA node
+    cobs::gopt_load_complete_index = true;
+    cobs::gopt_numa_policy = cobs::NumaPolicy::Partition;
+    std::vector<cobs::SearchResult> result2;
+    cobs::ClassicSearch s_numa(
+        std::make_shared<cobs::CompactIndexMMapSearchFile>(index_file));
+    s_numa.search(query, result2);
+    cobs::gopt_load_complete_index = false;
+    cobs::gopt_numa_policy = cobs::NumaPolicy::FirstTouch;
+
+    ASSERT_EQ(documents.size(), result1.size());
+    ASSERT_EQ(result1.size(), result2.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result1[i].doc_name), result2[i].doc_name);
+        ASSERT_EQ(result1[i].score, result2[i].score);
+    }
+
+    // place the index on three simulated nodes as contiguous page ranges
+    cobs::numa_simulate_nodes(3);
+    cobs::gopt_load_complete_index = true;
+    cobs::gopt_numa_policy = cobs::NumaPolicy::Partition;
+    auto numa_file =
+        std::make_shared<cobs::CompactIndexMMapSearchFile>(index_file);
+    std::vector<cobs::SearchResult> result3;
+    cobs::ClassicSearch s_nodes(numa_file);
+    s_nodes.search(query, result3);
+    cobs::gopt_load_complete_index = false;
+    cobs::gopt_numa_policy = cobs::NumaPolicy::FirstTouch;
+    cobs::numa_simulate_nodes(0);
+
+    const std::vector<uint64_t>& bounds = numa_file->numa_bounds();
+    ASSERT_EQ(4u, bounds.size());
+    for (size_t n = 0; n + 1 < bounds.size(); ++n) {
+        ASSERT_LT(bounds[n], bounds[n + 1]);
+        ASSERT_EQ(0u, bounds[n] % (8 * index_params.page_size));
+    }
+    ASSERT_EQ(result1.size(), result3.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result1[i].doc_name), result3[i].doc_name);
+        ASSERT_EQ(result1[i].score, result3[i].score);
+    }
+}
+
+TEST_F(compact_index_query, merge_mmap) {
+    // generate two batches of documents with distinct names
+    fs::path input1_dir = base_dir / "input1", input2_dir = base_dir / "input2";
+    fs::path index1_file = base_dir / "index1.cobs_compact";
+    fs::path index2_file = base_dir / "index2.cobs_compact";
+    auto documents1 = generate_documents_one(query, /* num_documents */ 1000);
+    auto documents2 = generate_documents_one(query, /* num_documents */ 600);
+    fs::create_directories(input1_dir);
+    fs::create_directories(input2_dir);
+    generate_test_case(documents1, "a_", input1_dir);
+    generate_test_case(documents2, "b_", input2_dir);
+
+    // construct compact indices, both with a partial last page
+    cobs::CompactIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 2;
+    index_params.canonicalize = 1;
+
+    cobs::compact_construct(
+        cobs::DocumentList(input1_dir), index1_file,
+        base_dir / "tmp1", index_params);
+    cobs::compact_construct(
+        cobs::DocumentList(input2_dir), index2_file,
+        base_dir / "tmp2", index_params);
+
+    // merge and check that all documents are found exactly once
+    cobs::compact_merge({ index1_file, index2_file }, index_file);
+
+    std::vector<cobs::SearchResult> result;
+    cobs::ClassicSearch s_merged(index_file.string());
+    s_merged.search(query, result);
+    ASSERT_EQ(documents1.size() + documents2.size(), result.size());
+    std::set<std::string> names;
+    for (auto& r : result) {
+        ASSERT_EQ(r.score, 1);
+        names.insert(r.doc_name);
+    }
+    ASSERT_EQ(result.size(), names.size());
+
+    // merging an index with itself repacks the equal partial last pages
+    fs::path self_file = base_dir / "self.cobs_compact";
+    cobs::compact_merge({ index1_file, index1_file }, self_file);
+    auto h1 = cobs::deserialize_header<cobs::CompactIndexHeader>(index1_file);
+    auto h2 = cobs::deserialize_header<cobs::CompactIndexHeader>(self_file);
+    ASSERT_EQ(2 * h1.num_documents(), h2.num_documents());
+    ASSERT_EQ(2 * h1.parameters_.size() - 1, h2.parameters_.size());
+
+    std::vector<cobs::SearchResult> result2;
+    cobs::ClassicSearch s_self(self_file.string());
+    s_self.search(query, result2);
+    ASSERT_EQ(2 * documents1.size(), result2.size());
+    for (auto& r : result2) {
+        ASSERT_EQ(r.score, 1);
+    }
+
+    // indices with different numbers of hash functions cannot be merged
+    fs::path index3_file = base_dir / "index3.cobs_compact";
+    index_params.num_hashes = 2;
+    cobs::compact_construct(
+        cobs::DocumentList(input2_dir), index3_file,
+        base_dir / "tmp3", index_params);
+    fs::path mixed_file = base_dir / "mixed.cobs_compact";
+    bool die_with_exception = tlx::set_die_with_exception(true);
+    ASSERT_THROW(cobs::compact_merge({ index1_file, index3_file }, mixed_file),
+                 tlx::DieException);
+    tlx::set_die_with_exception(die_with_exception);
+    ASSERT_FALSE(fs::exists(mixed_file));
+}
+
+TEST_F(compact_index_query, split_mmap) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 2000);
+    generate_test_case(documents, input_dir.string());
+
+    // construct compact index
+    cobs::CompactIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 2;
+    index_params.canonicalize = 1;
+
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+
+    std::vector<cobs::SearchResult> result1;
+    cobs::ClassicSearch s_base(index_file.string());
+    s_base.search(query, result1);
+
+    // split into shards and query them together
+    std::vector<fs::path> shards =
+        cobs::compact_split(index_file, base_dir / "shards", 3);
+    ASSERT_EQ(3u, shards.size());
+
+    std::vector<cobs::SearchResult> result2;
+    cobs::ClassicSearch s_shards(cobs::open_index_files(shards));
+    s_shards.search(query, result2);
+
+    ASSERT_EQ(documents.size(), result1.size());
+    ASSERT_EQ(result1.size(), result2.size());
+    for (size_t i = 0; i < result1.size(); ++i) {
+        ASSERT_EQ(std::string(result1[i].doc_name), result2[i].doc_name);
+        ASSERT_EQ(result1[i].score, result2[i].score);
+    }
+}
+
+TEST_F(compact_index_query, from_classic_mmap) {
+    // generate
+    auto documents = generate_documents_one(query, /* num_documents */ 2000);
+    generate_test_case(documents, input_dir.string());
+
+    // construct classic index
+    fs::path classic_file = base_dir / "index.cobs_classic";
+    cobs::ClassicIndexParameters classic_params;
+    classic_params.num_hashes = 3;
+    classic_params.false_positive_rate = 0.1;
+    classic_params.canonicalize = 1;
+
+    cobs::classic_construct(
+        cobs::DocumentList(input_dir), classic_file, tmp_path, classic_params);
+
+    // fold into a compact index, the documents have only one distinct term
+    cobs::CompactIndexParameters index_params;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 2;
+    cobs::classic_to_compact(classic_file, index_file, index_params);
+    ASSERT_LT(fs::file_size(index_file), fs::file_size(classic_file));
+
+    std::vector<cobs::SearchResult> result1;
+    cobs::ClassicSearch s_classic(classic_file.string());
+    s_classic.search(query, result1);
+
+    std::vector<cobs::SearchResult> result2;
+    cobs::ClassicSearch s_compact(index_file.string());
+    s_compact.search(query, result2);
+
+    // folding has no false negatives
+    ASSERT_EQ(documents.size(), result1.size());
+    ASSERT_EQ(result1.size(), result2.size());
+    std::map<std::string, uint32_t> scores;
+    for (auto& r : result1)
+        scores[r.doc_name] = r.score;
+    for (auto& r : result2) {
+        ASSERT_EQ(1u, scores.count(r.doc_name));
+        ASSERT_GE(r.score, scores[r.doc_name]);
+    }
+}
+
+TEST_F(compact_index_query, blocked_bloom_mmap) {
+    // generate
+    auto documents = generate_documents_all(query);
+    generate_test_case(documents, input_dir.string());
+
+    // construct compact index with all probes of a term in 8 rows
+    cobs::CompactIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.block_rows = 8;
+    index_params.false_positive_rate = 0.1;
+    index_params.page_size = 2;
+    index_params.canonicalize = 1;
+
+    cobs::compact_construct(
+        cobs::DocumentList(input_dir), index_file, tmp_path, index_params);
+    auto header = cobs::deserialize_header<cobs::CompactIndexHeader>(index_file);
+    ASSERT_EQ(8u, header.block_rows_);
+
+    cobs::ClassicSearch s_base(index_file.string());
+
+    std::vector<cobs::SearchResult> result;
+    s_base.search(query, result);
+    ASSERT_EQ(documents.size(), result.size());
+    for (auto& r : result) {
+        std::string doc_name = r.doc_name;
+        int index = std::stoi(doc_name.substr(doc_name.size() - 2));
+        ASSERT_GE(r.score, documents[index].data().size());
+    }
+}
+
 TEST_F(compact_index_query, false_positive_mmap) {
     // generate
     auto documents = generate_documents_all(query);
@@ -85,4 +85,28 @@ TEST(cortex, sample1) {
     ASSERT_FALSE(std::getline(txt31, line));
 }
 
+TEST(cortex, process_words) {
+    // the 2-bit words of the packed k-mers equal those of the unpacked terms
+    cobs::CortexFile ctx(in_dir / "sample1-k31.ctx");
+    for (uint64_t k : { 31, 19, 15 }) {
+        std::vector<uint64_t> words;
+        cobs::RollingCanonicalKMer<> canonicalizer(k);
+        ctx.process_terms(
+            k,
+            [&](const tlx::string_view& v) {
+                canonicalizer.canonicalize(v.data());
+                words.push_back(canonicalizer.word());
+            });
+
+        size_t i = 0;
+        ctx.process_words(
+            k,
+            [&](uint64_t fw) {
+                ASSERT_LT(i, words.size());
+                ASSERT_EQ(words[i++], cobs::canonical_word(fw, k));
+            });
+        ASSERT_EQ(words.size(), i);
+    }
+}
+
 /******************************************************************************/
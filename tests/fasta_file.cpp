@@ -13,6 +13,8 @@
 #include <cobs/query/classic_search.hpp>
 #include <gtest/gtest.h>
 
+#include <set>
+
 namespace fs = cobs::fs;
 
 static fs::path input_dir = "data/fasta/";
@@ -52,6 +54,57 @@ TEST_F(fasta, process_kmers) {
     die_unequal(nterms, check);
 }
 
+TEST_F(fasta, process_terms_range) {
+    // consecutive byte ranges must produce the terms of the whole file
+    std::string path = (input_dir / "sample1.fasta").string();
+    cobs::FastaFile file(path);
+    std::vector<std::string> terms;
+    file.process_terms(
+        31, [&](const tlx::string_view& s) { terms.push_back(s.to_string()); });
+
+    uint64_t size = fs::file_size(path);
+    for (uint64_t range_size : { 1, 7, 100, 1000 }) {
+        std::vector<std::string> range_terms;
+        for (uint64_t begin = 0; begin < size; begin += range_size) {
+            cobs::FastaFile::process_terms_range(
+                path, begin, begin + range_size, 31,
+                [&](const tlx::string_view& s) {
+                    range_terms.push_back(s.to_string());
+                });
+        }
+        ASSERT_EQ(terms, range_terms) << range_size;
+    }
+}
+
+TEST_F(fasta, num_distinct_terms) {
+    cobs::DocumentList doc_list(input_dir / "sample1.fasta");
+    const cobs::DocumentEntry& de = doc_list[0];
+    fs::remove(de.distinct_cache_path());
+
+    // count distinct canonical k-mers exactly
+    std::set<std::string> kmers;
+    cobs::RollingCanonicalKMer<> canonicalizer(31);
+    de.process_terms(
+        31, [&](const tlx::string_view& term) {
+            kmers.insert(canonicalizer.canonicalize(term.data()).to_string());
+        });
+
+    uint64_t estimate = de.num_distinct_terms(31, 1);
+    ASSERT_NEAR(double(kmers.size()), double(estimate), 0.03 * kmers.size());
+    ASSERT_LE(estimate, de.num_terms(31));
+
+    // the estimate is cached for the parameters it was computed with
+    ASSERT_TRUE(fs::exists(de.distinct_cache_path()));
+    uint64_t cached;
+    ASSERT_TRUE(de.read_distinct_cache(
+                    31, 1, fs::file_size(de.path_), cached));
+    ASSERT_EQ(estimate, cached);
+    ASSERT_FALSE(de.read_distinct_cache(
+                     21, 1, fs::file_size(de.path_), cached));
+    ASSERT_EQ(estimate, de.num_distinct_terms(31, 1));
+    fs::remove(de.distinct_cache_path());
+}
+
 TEST_F(fasta, document_list) {
     static constexpr bool debug = false;
 
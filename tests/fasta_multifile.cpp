@@ -12,6 +12,7 @@
 #include <cobs/query/classic_index/mmap_search_file.hpp>
 #include <cobs/query/classic_search.hpp>
 #include <gtest/gtest.h>
+#include <zlib.h>
 
 namespace fs = cobs::fs;
 
@@ -52,6 +53,41 @@ TEST_F(fasta_multi, process_kmers2) {
     die_unequal(fasta_multi.size(0) - 30, count);
 }
 
+TEST_F(fasta_multi, gzip) {
+    // compress sample into base_dir, with cache files next to it
+    fs::create_directories(base_dir);
+    fs::path gz_path = base_dir / "sample2.mfasta.gz";
+    {
+        std::ifstream is((input_dir / "sample2.mfasta").string());
+        std::string data((std::istreambuf_iterator<char>(is)),
+                         std::istreambuf_iterator<char>());
+        gzFile gz = gzopen(gz_path.string().c_str(), "wb");
+        gzwrite(gz, data.data(), data.size());
+        gzclose(gz);
+    }
+
+    cobs::FastaMultifile plain(input_dir / "sample2.mfasta", false);
+    for (bool use_cache : { true, true, false }) {
+        cobs::FastaMultifile gzip(gz_path, use_cache);
+        die_unequal(gzip.num_documents(), plain.num_documents());
+
+        for (size_t d = 0; d < plain.num_documents(); ++d) {
+            die_unequal(gzip.size(d), plain.size(d));
+            std::vector<std::string> terms1, terms2;
+            plain.process_terms(
+                d, 31, [&](const tlx::string_view& s) {
+                    terms1.emplace_back(s.to_string());
+                });
+            gzip.process_terms(
+                d, 31, [&](const tlx::string_view& s) {
+                    terms2.emplace_back(s.to_string());
+                });
+            ASSERT_EQ(terms1, terms2);
+        }
+    }
+    ASSERT_TRUE(fs::exists(gz_path.string() + cobs::GzipIndex::file_extension));
+}
+
 TEST_F(fasta_multi, document_list) {
     static constexpr bool debug = false;
 
@@ -9,10 +9,14 @@
 #include <cobs/construction/classic_index.hpp>
 #include <cobs/document_list.hpp>
 #include <cobs/fastq_file.hpp>
+#include <cobs/file/classic_index_header.hpp>
 #include <cobs/query/classic_index/mmap_search_file.hpp>
 #include <cobs/query/classic_search.hpp>
+#include <cobs/util/calc_signature_size.hpp>
 #include <gtest/gtest.h>
 
+#include <fstream>
+
 namespace fs = cobs::fs;
 
 static fs::path input_dir = "data/fastq/";
@@ -52,6 +56,103 @@ TEST_F(fastq, process_kmers) {
     die_unequal(nterms, check);
 }
 
+TEST_F(fastq, process_terms_range) {
+    // consecutive byte ranges must produce the terms of the whole file
+    std::string path = (input_dir / "sample1.fastq").string();
+    cobs::FastqFile file(path);
+    std::vector<std::string> terms;
+    file.process_terms(
+        31, [&](const tlx::string_view& s) { terms.push_back(s.to_string()); });
+
+    uint64_t size = fs::file_size(path);
+    for (uint64_t range_size : { 1, 7, 100, 1000 }) {
+        std::vector<std::string> range_terms;
+        for (uint64_t begin = 0; begin < size; begin += range_size) {
+            cobs::FastqFile::process_terms_range(
+                path, begin, begin + range_size, 31,
+                [&](const tlx::string_view& s) {
+                    range_terms.push_back(s.to_string());
+                });
+        }
+        ASSERT_EQ(terms, range_terms) << range_size;
+    }
+}
+
+TEST_F(fastq, min_count) {
+    // read a occurs twice, read b once
+    std::string read_a = cobs::random_sequence(60, 1);
+    std::string read_b = cobs::random_sequence(60, 2);
+    fs::path reads_dir = base_dir / "reads";
+    fs::create_directories(reads_dir);
+    {
+        std::ofstream os((reads_dir / "reads.fastq").string());
+        for (const std::string& read : { read_a, read_b, read_a }) {
+            os << "@read\n" << read << "\n+\n"
+               << std::string(read.size(), 'I') << '\n';
+        }
+    }
+
+    cobs::FastqFile file(reads_dir / "reads.fastq");
+    ASSERT_EQ(60u, file.num_solid_terms(31, 1));
+    ASSERT_EQ(30u, file.num_solid_terms(31, 2));
+
+    // only the k-mers of read a are indexed, the signature is sized for them
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.01;
+    index_params.min_count = 2;
+    cobs::classic_construct(
+        cobs::DocumentList(reads_dir), index_path, tmp_path, index_params);
+    cobs::ClassicSearch s_base(
+        std::make_shared<cobs::ClassicIndexMMapSearchFile>(index_path));
+
+    auto num_found = [&](const std::string& read) {
+        size_t found = 0;
+        for (size_t i = 0; i + 31 <= read.size(); ++i) {
+            std::vector<cobs::SearchResult> result;
+            s_base.search(read.substr(i, 31), result);
+            found += result.size() == 1 && result[0].score == 1;
+        }
+        return found;
+    };
+    ASSERT_EQ(30u, num_found(read_a));
+    ASSERT_LE(num_found(read_b), 3u);
+}
+
+TEST_F(fastq, min_count_signature_size) {
+    // a small high-coverage document has more solid k-mers than a large
+    // low-coverage one, the signature must be sized for the small one.
+    fs::path reads_dir = base_dir / "reads";
+    fs::create_directories(reads_dir);
+    auto write_reads = [&](const std::string& name,
+                           const std::vector<std::string>& reads) {
+        std::ofstream os((reads_dir / name).string());
+        for (const std::string& read : reads) {
+            os << "@read\n" << read << "\n+\n"
+               << std::string(read.size(), 'I') << '\n';
+        }
+    };
+    std::string read_a = cobs::random_sequence(60, 1);
+    write_reads("small.fastq", { read_a, read_a, read_a });
+    std::vector<std::string> reads_b;
+    for (size_t i = 0; i < 20; ++i)
+        reads_b.push_back(cobs::random_sequence(60, 100 + i));
+    write_reads("large.fastq", reads_b);
+    ASSERT_LT(fs::file_size(reads_dir / "small.fastq"),
+              fs::file_size(reads_dir / "large.fastq"));
+
+    cobs::ClassicIndexParameters index_params;
+    index_params.num_hashes = 3;
+    index_params.false_positive_rate = 0.01;
+    index_params.min_count = 2;
+    cobs::classic_construct(
+        cobs::DocumentList(reads_dir), index_path, tmp_path, index_params);
+
+    auto header = cobs::deserialize_header<cobs::ClassicIndexHeader>(
+        index_path);
+    ASSERT_EQ(cobs::calc_signature_size(30, 3, 0.01), header.signature_size_);
+}
+
 TEST_F(fastq, document_list) {
     static constexpr bool debug = false;
 
@@ -11,6 +11,7 @@
 
 #include <cobs/file/classic_index_header.hpp>
 #include <cobs/file/compact_index_header.hpp>
+#include <cobs/file/document_name_table.hpp>
 #include <cobs/file/header.hpp>
 #include <cobs/kmer_buffer.hpp>
 #include <cobs/util/file.hpp>
@@ -60,6 +61,64 @@ TEST(file, classic_index_header) {
     ASSERT_EQ(file_names, h_in.file_names_);
 }
 
+TEST(file, classic_index_header_lazy_names) {
+    std::stringstream buffer;
+
+    // write classic index header
+    std::vector<std::string> file_names = { "n1", "name two", "", "n4" };
+    cobs::ClassicIndexHeader h_out;
+    h_out.term_size_ = 31;
+    h_out.canonicalize_ = 1;
+    h_out.signature_size_ = 321;
+    h_out.num_hashes_ = 21;
+    h_out.file_names_ = file_names;
+    h_out.serialize(buffer);
+    std::string data = buffer.str();
+
+    // read classic index header without names
+    cobs::ClassicIndexHeader h_in;
+    h_in.deserialize(buffer, /* load_file_names */ false);
+    ASSERT_TRUE(h_in.file_names_.empty());
+    ASSERT_EQ(h_out.row_bits(), h_in.row_bits());
+    ASSERT_EQ(h_out.row_size(), h_in.row_size());
+    ASSERT_EQ(data.size(), static_cast<size_t>(h_in.header_size_));
+
+    // resolve names in place
+    cobs::DocumentNameTable table(
+        reinterpret_cast<const uint8_t*>(data.data()) + h_in.name_table_pos_,
+        h_in.num_lazy_names_);
+    ASSERT_EQ(file_names.size(), table.size());
+    for (size_t i = 0; i < file_names.size(); ++i) {
+        ASSERT_EQ(file_names[i], table[i]);
+    }
+}
+
+TEST(file, classic_index_header_version1) {
+    std::stringstream buffer;
+
+    // write version 1 classic index header manually
+    std::vector<std::string> file_names = { "n1", "n2", "n3" };
+    cobs::serialize_magic_begin(
+        buffer, cobs::ClassicIndexHeader::magic_word, 1);
+    cobs::stream_put(buffer, uint32_t(31), uint8_t(1),
+                     uint32_t(file_names.size()), uint64_t(123), uint64_t(2));
+    for (const auto& file_name : file_names) {
+        buffer << file_name << std::endl;
+    }
+    cobs::serialize_magic_end(buffer, cobs::ClassicIndexHeader::magic_word);
+    size_t header_size = buffer.str().size();
+
+    // read classic index header, names must be loaded eagerly
+    cobs::ClassicIndexHeader h_in;
+    h_in.deserialize(buffer, /* load_file_names */ false);
+    ASSERT_EQ(31u, h_in.term_size_);
+    ASSERT_EQ(123u, h_in.signature_size_);
+    ASSERT_EQ(2u, h_in.num_hashes_);
+    ASSERT_EQ(0u, h_in.name_table_pos_);
+    ASSERT_EQ(file_names, h_in.file_names_);
+    ASSERT_EQ(header_size, static_cast<size_t>(h_in.header_size_));
+}
+
 TEST(file, classic_index) {
     std::stringstream buffer;
 
@@ -89,6 +148,33 @@ TEST(file, classic_index) {
     ASSERT_EQ(file_names, h_in.file_names_);
 }
 
+TEST(file, classic_index_data_alignment) {
+    for (uint64_t alignment : { 1u, 4096u, 2u * 1024 * 1024 }) {
+        std::stringstream buffer;
+
+        // write classic index file
+        std::vector<std::string> file_names = { "n1", "n2", "n3" };
+        cobs::ClassicIndexHeader h_out;
+        h_out.term_size_ = 31;
+        h_out.canonicalize_ = 1;
+        h_out.signature_size_ = 123;
+        h_out.num_hashes_ = 1;
+        h_out.file_names_ = file_names;
+        h_out.data_alignment_ = alignment;
+        std::vector<uint8_t> v_out(h_out.row_size() * h_out.signature_size_, 7);
+        h_out.write_file(buffer, v_out);
+
+        // read classic index file, the data must start aligned
+        cobs::ClassicIndexHeader h_in;
+        std::vector<uint8_t> v_in;
+        h_in.read_file(buffer, v_in);
+        ASSERT_EQ(alignment, h_in.data_alignment_);
+        ASSERT_EQ(0u, h_in.header_size_ % alignment);
+        ASSERT_EQ(v_out, v_in);
+        ASSERT_EQ(file_names, h_in.file_names_);
+    }
+}
+
 TEST(file, compact_index_header_values) {
     std::stringstream buffer;
 
@@ -119,6 +205,40 @@ TEST(file, compact_index_header_values) {
     ASSERT_EQ(file_names, h_in.file_names_);
 }
 
+TEST(file, compact_index_header_lazy_names) {
+    std::stringstream buffer;
+
+    // write compact file header
+    std::vector<cobs::CompactIndexHeader::parameter> parameters = {
+        { 100, 1 },
+        { 200, 1 },
+    };
+    std::vector<std::string> file_names = { "file_1", "file_2", "file_3" };
+    cobs::CompactIndexHeader h_out;
+    h_out.term_size_ = 31;
+    h_out.canonicalize_ = 1;
+    h_out.parameters_ = parameters;
+    h_out.file_names_ = file_names;
+    h_out.page_size_ = 4096;
+    h_out.serialize(buffer);
+    std::string data = buffer.str();
+
+    // read compact file header without names
+    cobs::CompactIndexHeader h_in;
+    h_in.deserialize(buffer, /* load_file_names */ false);
+    ASSERT_TRUE(h_in.file_names_.empty());
+    ASSERT_EQ(file_names.size(), h_in.num_documents());
+    ASSERT_EQ(0u, cobs::get_stream_pos(buffer).curr_pos % 4096);
+
+    // resolve names in place
+    cobs::DocumentNameTable table(
+        reinterpret_cast<const uint8_t*>(data.data()) + h_in.name_table_pos_,
+        h_in.num_lazy_names_);
+    for (size_t i = 0; i < file_names.size(); ++i) {
+        ASSERT_EQ(file_names[i], table[i]);
+    }
+}
+
 TEST(file, compact_index_header_padding) {
     std::stringstream buffer;
 
@@ -141,4 +261,52 @@ TEST(file, compact_index_header_padding) {
     ASSERT_EQ(sp.curr_pos % page_size, 0U);
 }
 
+TEST(file, compact_index_header_data_alignment) {
+    std::stringstream buffer;
+
+    // write compact file header with small pages
+    cobs::CompactIndexHeader h_out;
+    h_out.term_size_ = 31;
+    h_out.canonicalize_ = 1;
+    h_out.parameters_ = { { 100, 1 } };
+    h_out.file_names_ = { "file_1", "file_2" };
+    h_out.page_size_ = 64;
+    h_out.data_alignment_ = 2 * 1024 * 1024;
+    h_out.serialize(buffer);
+
+    // read compact file header
+    cobs::CompactIndexHeader h_in;
+    h_in.deserialize(buffer);
+    cobs::StreamPos sp = cobs::get_stream_pos(buffer);
+    ASSERT_EQ(h_out.data_alignment_, h_in.data_alignment_);
+    ASSERT_EQ(sp.curr_pos % h_out.data_alignment_, 0U);
+}
+
+TEST(file, compact_index_header_version5) {
+    std::stringstream buffer;
+
+    // write version 5 compact index header manually, its data is aligned to
+    // lcm(page_size, data_alignment) = 48
+    std::vector<std::string> file_names = { "n1", "n2" };
+    cobs::serialize_magic_begin(
+        buffer, cobs::CompactIndexHeader::magic_word, 5);
+    cobs::stream_put(buffer, uint32_t(31), uint8_t(1), uint32_t(1),
+                     uint32_t(file_names.size()), uint64_t(24), uint64_t(16),
+                     uint64_t(0), uint8_t(0));
+    cobs::stream_put(buffer, uint64_t(100), uint64_t(1));
+    cobs::DocumentNameTable::serialize(buffer, file_names);
+    uint64_t pos = static_cast<uint64_t>(buffer.tellp()) +
+                   cobs::CompactIndexHeader::magic_word.size();
+    buffer << std::string((48 - pos % 48) % 48, '\0');
+    cobs::serialize_magic_end(buffer, cobs::CompactIndexHeader::magic_word);
+
+    cobs::CompactIndexHeader h_in;
+    h_in.deserialize(buffer);
+    cobs::StreamPos sp = cobs::get_stream_pos(buffer);
+    ASSERT_EQ(24u, h_in.page_size_);
+    ASSERT_EQ(16u, h_in.data_alignment_);
+    ASSERT_EQ(file_names, h_in.file_names_);
+    ASSERT_EQ(sp.curr_pos, buffer.str().size());
+}
+
 /******************************************************************************/
@@ -7,10 +7,25 @@
  * All rights reserved. Published under the MIT License in the LICENSE file.
  ******************************************************************************/
 
+#include <cobs/kmer.hpp>
+#include <cobs/settings.hpp>
+#include <cobs/util/fs.hpp>
+#include <cobs/util/gzip_index.hpp>
+#include <cobs/util/hyperloglog.hpp>
+#include <cobs/util/kmer_count_sketch.hpp>
+#include <cobs/util/kmer_dedup.hpp>
 #include <cobs/util/misc.hpp>
+#include <cobs/util/parallel_gzip.hpp>
 #include <cobs/util/query.hpp>
+#include <cobs/util/rolling_kmer.hpp>
+#include <cstring>
 #include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <sstream>
 #include <stdint.h>
+#include <thread>
+#include <zlib.h>
 
 void is_aligned(void* ptr, size_t alignment) {
     ASSERT_EQ((uintptr_t)ptr % alignment, 0);
@@ -35,6 +50,90 @@ void test_kmer(const char* kmer_data,
     die_unequal(good, is_good);
 }
 
+TEST(util, transpose_bits_8x8) {
+    std::mt19937_64 rng(42);
+    for (size_t r = 0; r < 1000; ++r) {
+        uint64_t x = rng(), y = cobs::transpose_bits_8x8(x);
+        for (size_t i = 0; i < 8; ++i) {
+            for (size_t j = 0; j < 8; ++j)
+                ASSERT_EQ((x >> (8 * i + j)) & 1, (y >> (8 * j + i)) & 1);
+        }
+    }
+}
+
+TEST(util, kmer_dedup) {
+    // small maximum capacity to test growing and chunking
+    cobs::KMerDedup dedup(16384);
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> words(5000);
+    for (uint64_t& w : words)
+        w = rng() >> 2;
+
+    for (uint64_t w : words)
+        ASSERT_TRUE(dedup.insert(w));
+    for (uint64_t w : words)
+        ASSERT_FALSE(dedup.insert(w));
+
+    dedup.clear();
+    for (uint64_t w : words)
+        ASSERT_TRUE(dedup.insert(w));
+
+    // beyond the maximum capacity the filter starts a new chunk, which has
+    // forgotten the oldest words
+    dedup.clear();
+    for (uint64_t i = 0; i < 20000; ++i)
+        ASSERT_TRUE(dedup.insert(i));
+    ASSERT_FALSE(dedup.insert(19999));
+    ASSERT_TRUE(dedup.insert(0));
+}
+
+TEST(util, kmer_count_sketch) {
+    cobs::KMerCountSketch sketch(3);
+    sketch.reset(1000);
+    // few new words collide in all rows
+    size_t num_new = 0;
+    for (uint64_t w = 0; w < 1000; ++w)
+        num_new += sketch.add(w) == 0;
+    ASSERT_GE(num_new, 980u);
+    // but counts are never underestimated
+    for (uint64_t w = 0; w < 1000; ++w)
+        ASSERT_GE(sketch.add(w), 1u);
+    // counters saturate at the maximum count
+    for (size_t i = 0; i < 5; ++i)
+        sketch.add(12345678);
+    ASSERT_EQ(3u, sketch.add(12345678));
+    ASSERT_LT(sketch.collision_rate(), 0.1);
+
+    sketch.reset(1000);
+    ASSERT_EQ(0u, sketch.add(12345678));
+
+    // a sketch limited to 4096 counters per row is filled by many words
+    cobs::KMerCountSketch small(3, 3 * 4096);
+    small.reset(100000);
+    for (uint64_t w = 0; w < 100000; ++w)
+        small.add(w);
+    ASSERT_GT(small.collision_rate(), 0.9);
+}
+
+TEST(util, hyperloglog) {
+    for (uint64_t n : { 10, 1000, 100000 }) {
+        cobs::HyperLogLog hll, first, second;
+        // add every word twice, repetitions must not be counted
+        for (size_t r = 0; r < 2; ++r) {
+            for (uint64_t w = 0; w < n; ++w) {
+                hll.add(cobs::HyperLogLog::hash_word(w));
+                (w % 2 == 0 ? first : second).add(
+                    cobs::HyperLogLog::hash_word(w));
+            }
+        }
+        ASSERT_NEAR(double(n), double(hll.estimate()), 0.03 * n) << n;
+        // merging the sketches of two halves gives the same estimate
+        first.merge(second);
+        ASSERT_EQ(hll.estimate(), first.estimate());
+    }
+    ASSERT_EQ(0u, cobs::HyperLogLog().estimate());
+}
+
 TEST(util, kmer_canonicalize) {
     // one already canonical one
     test_kmer("AGGAAAGTCTTTTACGCTGGGGTAAGAGTGA",
@@ -59,4 +158,265 @@ TEST(util, kmer_canonicalize) {
               "AAAAAAAAAAAAAAAATTTTTTTTTTTTTTT", true);
 }
 
+template <uint64_t N>
+void test_kmer_pack(std::mt19937& rng) {
+    for (size_t r = 0; r < 100; ++r) {
+        std::string chars;
+        for (size_t i = 0; i < N; ++i)
+            chars += "ACGT"[rng() % 4];
+        cobs::KMer<N> k(chars.data());
+        ASSERT_EQ(chars, k.string());
+        // first and last base are the highest and lowest bits
+        ASSERT_EQ(std::string("ACGT").find(chars[0]), k.at(0));
+        ASSERT_EQ(std::string("ACGT").find(chars[N - 1]), k.at(N - 1));
+    }
+    std::string invalid(N, 'A');
+    invalid[N / 2] = 'N';
+    ASSERT_THROW(cobs::KMer<N> k(invalid.data()), std::out_of_range);
+}
+
+TEST(util, kmer_pack) {
+    std::mt19937 rng(42);
+    test_kmer_pack<31>(rng);
+    test_kmer_pack<32>(rng);
+    test_kmer_pack<25>(rng);
+    test_kmer_pack<21>(rng);
+    test_kmer_pack<1>(rng);
+}
+
+template <uint64_t K>
+void test_rolling_kmer(const std::string& seq, uint64_t k) {
+    cobs::RollingCanonicalKMer<K> canonicalizer(k);
+    std::vector<char> kmer_buffer(k);
+    for (size_t i = 0; i + k <= seq.size(); ++i) {
+        // restart in between, as done when buffers are refilled
+        if (i % 1000 == 0)
+            canonicalizer.reset();
+        tlx::string_view kmer = canonicalizer.canonicalize(seq.data() + i);
+        cobs::canonicalize_kmer(seq.data() + i, kmer_buffer.data(), k);
+        ASSERT_EQ(std::string(kmer_buffer.data(), k),
+                  std::string(kmer.data(), kmer.size()))
+            << "k=" << k << " i=" << i;
+    }
+}
+
+TEST(util, rolling_kmer_canonicalize) {
+    // random sequence with invalid letters, lower case and long repeats
+    std::mt19937 rng(42);
+    std::string seq;
+    for (size_t i = 0; i < 20000; ++i)
+        seq += "ACGTACGTACGTACGTNacgX"[rng() % 21];
+    seq += std::string(100, 'A') + std::string(100, 'T');
+
+    // generic kernel
+    for (uint64_t k : { 1, 15, 31, 32, 33, 64 })
+        test_rolling_kmer<0>(seq, k);
+
+    // kernels for fixed term sizes
+    for (uint64_t k : { 15, 21, 25, 31 }) {
+        cobs::dispatch_term_size(
+            k, [&](auto fixed_term_size) {
+                test_rolling_kmer<decltype(fixed_term_size)::value>(seq, k);
+            });
+    }
+}
+
+TEST(util, canonical_word_of_packed_kmer) {
+    std::string seq = cobs::random_sequence(5000, 7);
+    // include palindromes and odd k-mers differing only in the middle base
+    seq += "ACGTACGT" + std::string(31, 'A') + "C" + std::string(31, 'T');
+
+    for (uint64_t k : { 1, 4, 15, 16, 21, 31, 32 }) {
+        cobs::RollingCanonicalKMer<> canonicalizer(k);
+        std::vector<uint8_t> packed((k + 3) / 4);
+        for (size_t i = 0; i + k <= seq.size(); ++i) {
+            canonicalizer.canonicalize(seq.data() + i);
+            cobs::kmer_pack(seq.data() + i, k, packed.data());
+            uint64_t fw = cobs::kmer_word(packed.data(), k);
+            ASSERT_EQ(canonicalizer.word(), cobs::canonical_word(fw, k))
+                << "k=" << k << " i=" << i;
+        }
+    }
+}
+
+//! compress data using zlib, window_bits -15 writes raw deflate data
+static std::string deflate_string(const std::string& data, int window_bits) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    die_unless(deflateInit2(&zs, 6, Z_DEFLATED, window_bits, 8,
+                            Z_DEFAULT_STRATEGY) == Z_OK);
+    std::string out(deflateBound(&zs, data.size()) + 64, 0);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = data.size();
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+    die_unless(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+//! compress data as a BGZF block
+static std::string bgzf_block(const std::string& data) {
+    std::string raw = deflate_string(data, -15);
+    uint32_t crc = crc32(0, reinterpret_cast<const Bytef*>(data.data()),
+                         data.size());
+    uint32_t bsize = 18 + raw.size() + 8 - 1;
+    std::string block = {
+        0x1F, char(0x8B), 8, 4, 0, 0, 0, 0, 0, char(0xFF), 6, 0, 'B', 'C', 2, 0,
+        char(bsize & 0xFF), char(bsize >> 8)
+    };
+    block += raw;
+    for (uint32_t v : { crc, uint32_t(data.size()) }) {
+        for (size_t i = 0; i < 4; ++i)
+            block += char((v >> (8 * i)) & 0xFF);
+    }
+    return block;
+}
+
+static std::string parallel_gunzip(const std::string& data, size_t span_size,
+                                   unsigned num_threads = 3) {
+    std::istringstream is(data);
+    cobs::ParallelGzipIstream zis(is, num_threads, span_size);
+    std::ostringstream os;
+    os << zis.rdbuf();
+    return os.str();
+}
+
+TEST(util, parallel_gzip) {
+    std::mt19937 rng(42);
+    std::string text;
+    while (text.size() < 200000) {
+        text += '>';
+        for (size_t i = 0; i < 80; ++i)
+            text += "ACGT"[rng() % 4];
+        text += '\n';
+    }
+
+    // single member
+    std::string single = deflate_string(text, 15 + 16);
+
+    // multiple members and BGZF blocks with empty EOF block
+    std::string multi, bgzf;
+    for (size_t i = 0; i < text.size(); i += 7000)
+        multi += deflate_string(text.substr(i, 7000), 15 + 16);
+    for (size_t i = 0; i < text.size(); i += 16384)
+        bgzf += bgzf_block(text.substr(i, 16384));
+    bgzf += bgzf_block(std::string());
+
+    for (size_t span_size : { 1024, 4096, 1024 * 1024 }) {
+        ASSERT_EQ(text, parallel_gunzip(single, span_size));
+        ASSERT_EQ(text, parallel_gunzip(multi, span_size));
+        ASSERT_EQ(text, parallel_gunzip(bgzf, span_size));
+        ASSERT_EQ(text, parallel_gunzip(multi + std::string(100, 0), span_size));
+    }
+    ASSERT_EQ("", parallel_gunzip("", 4096));
+
+    // inline inflation without helper threads
+    ASSERT_EQ(text, parallel_gunzip(single, 4096, 0));
+    ASSERT_EQ(text, parallel_gunzip(multi, 4096, 0));
+    ASSERT_EQ(text, parallel_gunzip(bgzf, 4096, 0));
+    ASSERT_EQ(text, parallel_gunzip(multi + std::string(100, 0), 4096, 0));
+    ASSERT_EQ("", parallel_gunzip("", 4096, 0));
+}
+
+TEST(util, gzip_threads) {
+    unsigned threads = cobs::gopt_threads;
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    cobs::gopt_threads = hardware;
+    {
+        // a single gzipped file uses the idle hardware threads
+        cobs::GzipReaderScope reader;
+        unsigned spare = hardware - 1;
+        ASSERT_EQ(spare >= 3 ? std::min(spare - 2, 4u) : 0u,
+                  cobs::gzip_threads());
+        // all hardware threads read gzipped files: inflate inline
+        std::vector<cobs::GzipReaderScope> readers(hardware - 1);
+        ASSERT_EQ(0u, cobs::gzip_threads());
+    }
+    // explicitly set number of helper threads
+    cobs::gopt_gzip_threads = 2;
+    ASSERT_EQ(2u, cobs::gzip_threads());
+    cobs::gopt_gzip_threads = cobs::gzip_threads_auto;
+    cobs::gopt_threads = threads;
+}
+
+static void test_gzip_index(const std::string& text, const std::string& data) {
+    std::istringstream is(data);
+    cobs::GzipIndex index;
+    index.span_ = 16384;
+    {
+        cobs::GzipIndexIstream zis(is, index);
+        std::ostringstream os;
+        os << zis.rdbuf();
+        ASSERT_EQ(text, os.str());
+    }
+    ASSERT_GT(index.points_.size(), 4u);
+
+    std::mt19937 rng(42);
+    for (size_t i = 0; i < 100; ++i) {
+        uint64_t offset = rng() % text.size();
+        is.clear();
+        cobs::GzipIndexIstream zis(is, index, offset);
+        std::string part(std::min<size_t>(1000, text.size() - offset), 0);
+        zis.read(&part[0], part.size());
+        ASSERT_EQ(text.substr(offset, part.size()), part) << offset;
+    }
+}
+
+TEST(util, gzip_index) {
+    std::mt19937 rng(42);
+    std::string text;
+    while (text.size() < 400000) {
+        text += '>';
+        for (size_t i = 0; i < 80; ++i)
+            text += "ACGT"[rng() % 4];
+        text += '\n';
+    }
+
+    std::string multi;
+    for (size_t i = 0; i < text.size(); i += 70000)
+        multi += deflate_string(text.substr(i, 70000), 15 + 16);
+
+    test_gzip_index(text, deflate_string(text, 15 + 16));
+    test_gzip_index(text, multi);
+
+    // index files built with another span are stale
+    std::istringstream is(multi);
+    cobs::GzipIndex index;
+    index.span_ = 16384;
+    index.identify(is, multi.size());
+    is.seekg(0);
+    {
+        cobs::GzipIndexIstream zis(is, index);
+        zis.ignore(std::numeric_limits<std::streamsize>::max());
+    }
+    cobs::fs::path dir = "data/util_gzip_index";
+    cobs::fs::create_directories(dir);
+    std::string path =
+        (dir / ("test" + cobs::GzipIndex::file_extension)).string();
+    index.write_file(path);
+
+    std::istringstream is_same(multi);
+    cobs::GzipIndex same;
+    same.span_ = 16384;
+    same.identify(is_same, multi.size());
+    ASSERT_TRUE(same.read_file(path));
+    ASSERT_EQ(index.points_.size(), same.points_.size());
+    cobs::GzipIndex other;
+    other.span_ = 65536;
+    other.identify(is_same, multi.size());
+    ASSERT_FALSE(other.read_file(path));
+
+    // as are index files of a replaced file of the same size
+    std::string replaced = multi;
+    replaced[replaced.size() - 5] ^= 1;
+    std::istringstream is_replaced(replaced);
+    cobs::GzipIndex stale;
+    stale.span_ = 16384;
+    stale.identify(is_replaced, replaced.size());
+    ASSERT_FALSE(stale.read_file(path));
+    cobs::fs::remove_all(dir);
+}
+
 /******************************************************************************/